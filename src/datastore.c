@@ -120,8 +120,16 @@ extern struct nc_shared_info *nc_info;
 API char error_area;
 #define ERROR_POINTER ((void*)(&error_area))
 
-char* server_capabilities;
-pthread_spinlock_t server_cpblt_lock;
+/*
+ * serialized capabilities of the session whose <get> is just being processed
+ * by the thread, they are part of the monitoring state data
+ */
+static pthread_key_t server_cpblt_key;
+static pthread_once_t server_cpblt_once = PTHREAD_ONCE_INIT;
+static void server_cpblt_init(void)
+{
+	pthread_key_create(&server_cpblt_key, free);
+}
 
 struct ncds_ds_list {
 	struct ncds_ds *datastore;
@@ -197,6 +205,9 @@ static struct ncds_ds* ncds_fill_func(NCDS_TYPE type)
 		ds->func.editconfig = ncds_custom_editconfig;
 		break;
 	case NCDS_TYPE_FILE:
+	case NCDS_TYPE_BIN:
+	case NCDS_TYPE_SHM:
+		/* the binary and shared memory datastores differ only in how the content is kept */
 		if ((ds = (struct ncds_ds*) calloc(1, sizeof(struct ncds_ds_file))) == NULL ) {
 			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
 			return (NULL );
@@ -209,9 +220,12 @@ static struct ncds_ds* ncds_fill_func(NCDS_TYPE type)
 		ds->func.lock = ncds_file_lock;
 		ds->func.unlock = ncds_file_unlock;
 		ds->func.getconfig = ncds_file_getconfig;
+		ds->func.getconfig_xml = ncds_file_getconfig_xml;
 		ds->func.copyconfig = ncds_file_copyconfig;
+		ds->func.copyconfig_xml = ncds_file_copyconfig_xml;
 		ds->func.deleteconfig = ncds_file_deleteconfig;
 		ds->func.editconfig = ncds_file_editconfig;
+		ds->func.editconfig_xml = ncds_file_editconfig_xml;
 		break;
 	case NCDS_TYPE_EMPTY:
 		if ((ds = (struct ncds_ds*) calloc(1, sizeof(struct ncds_ds_empty))) == NULL ) {
@@ -345,7 +359,7 @@ int ncds_sysinit(int flags)
 	};
 #endif
 
-	pthread_spin_init(&server_cpblt_lock, PTHREAD_PROCESS_SHARED);
+	pthread_once(&server_cpblt_once, server_cpblt_init);
 
 	internal_ds_count = 0;
 	for (i = 0; i < INTERNAL_DS_COUNT; i++) {
@@ -1476,6 +1490,7 @@ static char* get_state_notifications(const char* UNUSED(model), const char* UNUS
 static char* get_state_monitoring(const char* UNUSED(model), const char* UNUSED(running), struct nc_err** UNUSED(e))
 {
 	char *schemas = NULL, *sessions = NULL, *retval = NULL, *ds_stats = NULL, *ds_startup = NULL, *ds_cand = NULL, *stats = NULL, *aux = NULL;
+	const char *server_capabilities;
 	struct ncds_ds_list* ds = NULL;
 	const struct ncds_lockinfo *info;
 
@@ -1585,7 +1600,7 @@ static char* get_state_monitoring(const char* UNUSED(model), const char* UNUSED(
 	}
 
 	/* get it all together */
-	pthread_spin_lock(&server_cpblt_lock);
+	server_capabilities = pthread_getspecific(server_cpblt_key);
 	if (asprintf(&retval, "<netconf-state xmlns=\"%s\">%s%s%s%s%s</netconf-state>", NC_NS_MONITORING,
 			(server_capabilities != NULL) ? server_capabilities : "",
 			(ds_stats != NULL) ? ds_stats : "",
@@ -1595,7 +1610,6 @@ static char* get_state_monitoring(const char* UNUSED(model), const char* UNUSED(
 		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
 		retval = NULL;
 	}
-	pthread_spin_unlock(&server_cpblt_lock);
 	if (retval == NULL) {
 		retval = strdup("");
 	}
@@ -3851,6 +3865,7 @@ API int ncds_consolidate(void)
 	for (ds_iter = ncds.datastores; ds_iter != NULL; ds_iter = ds_iter->next) {
 		transapis_cleanup(&(ds_iter->datastore->transapis), 0);
 
+		model_index_free(ds_iter->datastore->ext_model);
 		if (ds_iter->datastore->ext_model != ds_iter->datastore->data_model->xml) {
 			xmlFreeDoc(ds_iter->datastore->ext_model);
 			ds_iter->datastore->ext_model = ds_iter->datastore->data_model->xml;
@@ -3905,6 +3920,11 @@ API int ncds_consolidate(void)
 
 	/* parse models to get aux structure for TransAPI's internal purposes */
 	for (ds_iter = ncds.datastores; ds_iter != NULL; ds_iter = ds_iter->next) {
+		/* compile the final model for resolving the data nodes definitions */
+		if (model_index_build(ds_iter->datastore->ext_model) != EXIT_SUCCESS) {
+			WARN("Compiling the data model \"%s\" failed, its definitions will be searched in the YIN.", ds_iter->datastore->data_model->name);
+		}
+
 		/* when using transapi */
 		if (ds_iter->datastore->transapis != NULL) {
 			if (ncds_update_callbacks(ds_iter->datastore) != EXIT_SUCCESS) {
@@ -4004,6 +4024,107 @@ static xmlDocPtr read_datastore_data(ncds_id id, const char *data)
 	}
 }
 
+/**
+ * @brief Get the configuration data of the datastore in the form returned by
+ * read_datastore_data(). The data are not serialized and parsed again when the
+ * datastore implementation provides them as a document.
+ *
+ * @return NULL on error, the error is not filled if the data are invalid.
+ */
+static xmlDocPtr get_datastore_data(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE source, struct nc_err** error)
+{
+	char* data;
+	xmlDocPtr doc;
+
+	if (ds->func.getconfig_xml != NULL) {
+		return (ds->func.getconfig_xml(ds, session, source, error));
+	}
+
+	if ((data = ds->func.getconfig(ds, session, source, error)) == NULL) {
+		if (*error == NULL) {
+			ERROR("%s: Failed to get data from the datastore (%s:%d).", __func__, __FILE__, __LINE__);
+			*error = nc_err_new(NC_ERR_OP_FAILED);
+		}
+		return (NULL);
+	}
+	doc = read_datastore_data(ds->id, data);
+	free(data);
+
+	return (doc);
+}
+
+/**
+ * @brief Serialize the configuration data in the form returned by
+ * read_datastore_data() for the datastore implementations working with
+ * strings.
+ *
+ * @return NULL on error, empty string for an empty document.
+ */
+static char* dump_datastore_data(xmlDocPtr doc)
+{
+	xmlBufferPtr resultbuffer;
+	xmlNodePtr aux_node;
+	char* data;
+
+	if ((resultbuffer = xmlBufferCreate()) == NULL) {
+		ERROR("%s: xmlBufferCreate failed (%s:%d).", __func__, __FILE__, __LINE__);
+		return (NULL);
+	}
+	for (aux_node = doc->children; aux_node != NULL; aux_node = aux_node->next) {
+		xmlNodeDump(resultbuffer, doc, aux_node, 2, 1);
+	}
+	data = strdup((char *) xmlBufferContent(resultbuffer));
+	xmlBufferFree(resultbuffer);
+
+	return (data);
+}
+
+/**
+ * @brief Perform edit-config on the datastore, the serialized configuration
+ * is passed to the datastore implementations without editconfig_xml().
+ */
+static int apply_editconfig(struct ncds_ds* ds, const struct nc_session* session, const nc_rpc* rpc, NC_DATASTORE target, xmlDocPtr config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err** error)
+{
+	char* data;
+	int ret;
+
+	if (ds->func.editconfig_xml != NULL) {
+		return (ds->func.editconfig_xml(ds, session, rpc, target, config, defop, errop, error));
+	}
+
+	if ((data = dump_datastore_data(config)) == NULL) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		return (EXIT_FAILURE);
+	}
+	ret = ds->func.editconfig(ds, session, rpc, target, data, defop, errop, error);
+	free(data);
+
+	return (ret);
+}
+
+/**
+ * @brief Perform copy-config on the datastore, the serialized configuration
+ * is passed to the datastore implementations without copyconfig_xml().
+ */
+static int apply_copyconfig(struct ncds_ds* ds, const struct nc_session* session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, xmlDocPtr config, struct nc_err** error)
+{
+	char* data = NULL;
+	int ret;
+
+	if (ds->func.copyconfig_xml != NULL) {
+		return (ds->func.copyconfig_xml(ds, session, rpc, target, source, config, error));
+	}
+
+	if (config != NULL && (data = dump_datastore_data(config)) == NULL) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		return (EXIT_FAILURE);
+	}
+	ret = ds->func.copyconfig(ds, session, rpc, target, source, data, error);
+	free(data);
+
+	return (ret);
+}
+
 #ifndef DISABLE_VALIDATION
 static void relaxng_error_callback(void *error, const char * msg, ...)
 {
@@ -4188,7 +4309,6 @@ static int validate_ds(struct ncds_ds *ds, xmlDocPtr doc, struct nc_err **error)
 static int apply_rpc_validate_(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE source, const char* config, struct nc_err** e)
 {
 	int ret = EXIT_FAILURE;
-	char *data_cfg = NULL;
 	xmlDocPtr doc = NULL;
 	xmlNodePtr root, node;
 	xmlNsPtr ns;
@@ -4205,11 +4325,7 @@ static int apply_rpc_validate_(struct ncds_ds* ds, const struct nc_session* sess
 	case NC_DATASTORE_RUNNING:
 	case NC_DATASTORE_STARTUP:
 	case NC_DATASTORE_CANDIDATE:
-		if ((data_cfg = ds->func.getconfig(ds, session, source, e)) == NULL ) {
-			if (*e == NULL ) {
-				ERROR("%s: Failed to get data from the datastore (%s:%d).", __func__, __FILE__, __LINE__);
-				*e = nc_err_new(NC_ERR_OP_FAILED);
-			}
+		if ((doc = get_datastore_data(ds, session, source, e)) == NULL && *e != NULL) {
 			return (EXIT_FAILURE);
 		}
 		break;
@@ -4219,7 +4335,7 @@ static int apply_rpc_validate_(struct ncds_ds* ds, const struct nc_session* sess
 		 * cover it with the <config> element to allow the creation of xml
 		 * document
 		 */
-		data_cfg = (char*)config;
+		doc = read_datastore_data(ds->id, config);
 		break;
 	default:
 		*e = nc_err_new(NC_ERR_BAD_ELEM);
@@ -4227,15 +4343,11 @@ static int apply_rpc_validate_(struct ncds_ds* ds, const struct nc_session* sess
 		return (EXIT_FAILURE);
 	}
 
-	doc = read_datastore_data(ds->id, data_cfg);
 	if (doc == NULL || doc->children == NULL) {
 		/* config is empty */
 		xmlFreeDoc(doc);
 		doc = NULL;
 	}
-	if (source != NC_DATASTORE_CONFIG) {
-		free(data_cfg);
-	}
 
 	if (!doc) {
 		/*
@@ -4533,11 +4645,11 @@ static struct ncds_ds* ncds_new_internal(NCDS_TYPE type, const char * model_path
 
 	/* TransAPI structure is set to NULLs */
 
-	ret = pthread_mutex_init(&ds->lock, NULL);
+	ret = pthread_rwlock_init(&ds->lock, NULL);
 	if (ret != 0) {
 		free(ds);
 		ds = NULL;
-		ERROR("Initialization of a mutex failed (%s).", strerror(errno));
+		ERROR("Initialization of a rwlock failed (%s).", strerror(ret));
 		goto cleanup;
 	}
 
@@ -4637,6 +4749,7 @@ static void ncds_ds_model_free(struct data_model* model)
 		free(model->notifs);
 	}
 	if (model->xml != NULL) {
+		model_index_free(model->xml);
 		xmlFreeDoc(model->xml);
 	}
 	if (model->ctxt != NULL) {
@@ -4707,8 +4820,6 @@ void ncds_cleanall()
 	struct model_list *listitem, *listnext;
 	int i;
 
-	pthread_spin_destroy(&server_cpblt_lock);
-
 	ds_item = ncds.datastores;
 	while (ds_item != NULL) {
 		dsnext = ds_item->next;
@@ -4795,6 +4906,7 @@ API void ncds_free(struct ncds_ds* datastore)
 		ds->func.free(ds);
 
 		/* free models */
+		model_index_free(ds->ext_model);
 		if (ds->data_model == NULL || (ds->data_model->xml != ds->ext_model)) {
 			xmlFreeDoc(ds->ext_model);
 		}
@@ -5366,6 +5478,67 @@ API int ncds_rollback(ncds_id id)
 	return (datastore->func.rollback(datastore));
 }
 
+API int ncds_edit_dryrun(ncds_id id, NC_DATASTORE target, const xmlDocPtr config, NC_EDIT_DEFOP_TYPE defop, struct ncds_change** changes, struct nc_err** error)
+{
+	struct ncds_ds *datastore;
+	struct nc_err *e = NULL;
+	xmlDocPtr data, edit;
+	int ret;
+
+	if (error != NULL) {
+		*error = NULL;
+	}
+	if (changes == NULL || config == NULL) {
+		return (EXIT_FAILURE);
+	}
+	*changes = NULL;
+
+	if ((datastore = datastores_get_ds(id)) == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	switch (target) {
+	case NC_DATASTORE_RUNNING:
+	case NC_DATASTORE_STARTUP:
+	case NC_DATASTORE_CANDIDATE:
+		break;
+	default:
+		ERROR("%s: invalid target.", __func__);
+		e = nc_err_new(NC_ERR_BAD_ELEM);
+		nc_err_set(e, NC_ERR_PARAM_INFO_BADELEM, "target");
+		goto error;
+	}
+
+	/* both documents are private copies, so the edit can change them */
+	if ((data = get_datastore_data(datastore, NULL, target, &e)) == NULL) {
+		if (e == NULL) {
+			e = nc_err_new(NC_ERR_OP_FAILED);
+		}
+		goto error;
+	}
+	if ((edit = xmlCopyDoc(config, 1)) == NULL) {
+		ERROR("Copying the edit configuration failed (%s:%d).", __FILE__, __LINE__);
+		xmlFreeDoc(data);
+		e = nc_err_new(NC_ERR_OP_FAILED);
+		goto error;
+	}
+
+	ret = edit_config_changes(data, edit, datastore, defop, NC_EDIT_ERROPT_STOP, NULL, 0, changes, &e);
+	xmlFreeDoc(data);
+	xmlFreeDoc(edit);
+	if (ret == EXIT_SUCCESS) {
+		return (EXIT_SUCCESS);
+	}
+
+error:
+	if (error != NULL) {
+		*error = e;
+	} else {
+		nc_err_free(e);
+	}
+	return (EXIT_FAILURE);
+}
+
 /**
  * @brief Check if source and target are same. If url is enabled, checks if source and target urls are same
  * @param rpc
@@ -5430,7 +5603,6 @@ static int ncds_is_conflict(const nc_rpc * rpc, const struct nc_session * sessio
  */
 static nc_reply* ncds_apply_transapi(struct ncds_ds* ds, const struct nc_session* session, xmlDocPtr old, NC_EDIT_ERROPT_TYPE erropt, nc_reply *reply)
 {
-	char *new_data;
 	xmlDocPtr new;
 	xmlChar *config;
 	int ret;
@@ -5445,9 +5617,10 @@ static nc_reply* ncds_apply_transapi(struct ncds_ds* ds, const struct nc_session
 	}
 
 	/* find differences and call functions */
-	new_data = ds->func.getconfig(ds, session, NC_DATASTORE_RUNNING, &e);
-	new = read_datastore_data(ds->id, new_data);
-	free(new_data);
+	new = get_datastore_data(ds, session, NC_DATASTORE_RUNNING, &e);
+	/* the error is reported below */
+	nc_err_free(e);
+	e = NULL;
 
 	/* add default values */
 	ncdflt_default_values(new, ds->ext_model, NCWD_MODE_IMPL_TAGGED);
@@ -5601,16 +5774,14 @@ static nc_reply* ncds_apply_rpc(ncds_id id, const struct nc_session* session, co
 	struct nc_err* e = NULL;
 	struct ncds_ds* ds = NULL;
 	struct nc_filter *filter = NULL;
-	char* data = NULL, *config, *model = NULL, *data2, *op_name;
-	xmlDocPtr doc1, doc2, doc_merged = NULL;
+	char* data = NULL, *config = NULL, *model = NULL, *data2, *op_name;
+	xmlDocPtr doc1, doc2, doc_merged = NULL, config_doc = NULL;
 	int len, dsid, i;
 	int ret = EXIT_FAILURE;
 	nc_reply* reply = NULL, *old_reply = NULL, *new_reply;
-	xmlBufferPtr resultbuffer;
 	xmlNodePtr aux_node, node;
 	NC_OP op;
 	xmlDocPtr old = NULL;
-	char * old_data = NULL;
 	NC_DATASTORE source_ds = 0, target_ds = 0;
 	struct nacm_rpc *nacm_aux;
 	nc_rpc *rpc_aux;
@@ -5652,9 +5823,14 @@ process_datastore:
 	op = nc_rpc_get_op(rpc);
 	/* if transapi used AND operation will affect running repository => store current running content */
 
-	i = pthread_mutex_lock(&ds->lock);
+	if ((op == NC_OP_GET || op == NC_OP_GETCONFIG || op == NC_OP_GETSCHEMA) && ds->type != NCDS_TYPE_CUSTOM) {
+		/* readers do not block each other, custom datastore callbacks are not required to be reentrant */
+		i = pthread_rwlock_rdlock(&ds->lock);
+	} else {
+		i = pthread_rwlock_wrlock(&ds->lock);
+	}
 	if (i != 0) {
-		ERROR("Failed to lock datastore (%s).", strerror(errno));
+		ERROR("Failed to lock datastore (%s).", strerror(i));
 		return (NULL);
 	}
 
@@ -5662,17 +5838,15 @@ process_datastore:
 		&& (op == NC_OP_COMMIT || op == NC_OP_COPYCONFIG || (op == NC_OP_EDITCONFIG && (nc_rpc_get_testopt(rpc) != NC_EDIT_TESTOPT_TEST))) &&
 		(nc_rpc_get_target(rpc) == NC_DATASTORE_RUNNING)) {
 
-		old_data = ds->func.getconfig(ds, session, NC_DATASTORE_RUNNING, &e);
-		old = read_datastore_data(ds->id, old_data);
+		old = get_datastore_data(ds, session, NC_DATASTORE_RUNNING, &e);
 		if (old == NULL) {/* cannot get or parse data */
-			pthread_mutex_unlock(&ds->lock);
+			pthread_rwlock_unlock(&ds->lock);
 			if (e == NULL) { /* error not set */
 				e = nc_err_new(NC_ERR_OP_FAILED);
 				nc_err_set(e, NC_ERR_PARAM_MSG, "TransAPI: Failed to get data from RUNNING datastore.");
 			}
 			return nc_reply_error(e);
 		}
-		free(old_data);
 	}
 
 	filter = NULL;
@@ -5727,19 +5901,24 @@ process_datastore:
 			break;
 		}
 
-		if ((data = ds->func.getconfig(ds, session, NC_DATASTORE_RUNNING, &e)) == NULL ) {
-			if (e == NULL ) {
-				ERROR("%s: Failed to get data from the datastore (%s:%d).", __func__, __FILE__, __LINE__);
-				e = nc_err_new(NC_ERR_OP_FAILED);
+		if (ds->get_state != NULL) {
+			/* the status data callback gets the configuration data serialized */
+			if ((data = ds->func.getconfig(ds, session, NC_DATASTORE_RUNNING, &e)) == NULL ) {
+				if (e == NULL ) {
+					ERROR("%s: Failed to get data from the datastore (%s:%d).", __func__, __FILE__, __LINE__);
+					e = nc_err_new(NC_ERR_OP_FAILED);
+				}
+				break;
 			}
+
+			/* convert configuration data into XML structure */
+			doc1 = read_datastore_data(ds->id, data);
+		} else if ((doc1 = get_datastore_data(ds, session, NC_DATASTORE_RUNNING, &e)) == NULL && e != NULL) {
 			break;
 		}
 
 		if (ds->get_state_xml != NULL || ds->get_state != NULL) {
 			/* caller provided callback function to retrieve status data */
-
-			/* convert configuration data into XML structure */
-			doc1 = read_datastore_data(ds->id, data);
 			if (doc1 == NULL || doc1->children == NULL) {
 				/* empty */
 				xmlFreeDoc(doc1);
@@ -5795,7 +5974,7 @@ process_datastore:
 				xmlFreeDoc(doc2);
 			}
 		} else {
-			doc_merged = read_datastore_data(ds->id, data);
+			doc_merged = doc1;
 		}
 		free(data);
 
@@ -5844,17 +6023,10 @@ process_datastore:
 			break;
 		}
 
-		if ((data = ds->func.getconfig(ds, session, nc_rpc_get_source(rpc), &e)) == NULL) {
-			if (e == NULL) {
-				ERROR ("%s: Failed to get data from the datastore (%s:%d).", __func__, __FILE__, __LINE__);
-				e = nc_err_new(NC_ERR_OP_FAILED);
+		if ((doc_merged = get_datastore_data(ds, session, nc_rpc_get_source(rpc), &e)) == NULL) {
+			if (e != NULL) {
+				break;
 			}
-			break;
-		}
-		doc_merged = read_datastore_data(ds->id, data);
-		free(data);
-
-		if (doc_merged == NULL) {
 			ERROR("Reading configuration datastore failed.");
 			e = nc_err_new(NC_ERR_OP_FAILED);
 			nc_err_set(e, NC_ERR_PARAM_MSG, "Invalid datastore content.");
@@ -5916,7 +6088,6 @@ process_datastore:
 				nc_err_set(e, NC_ERR_PARAM_MSG, "Both the target and the source identify the same datastore.");
 				break;
 			}
-			config = NULL;
 		} else {
 			/* source is url or config, here starts woodo magic */
 			/*
@@ -5924,58 +6095,40 @@ process_datastore:
 			 * just return <config> element content. If it is url,
 			 * download remote file and return its content
 			 */
-			config = nc_rpc_get_config(rpc);
-			if (config == NULL) {
+			if ((root = ncxml_rpc_get_config(rpc)) == NULL) {
 				e = nc_err_new(NC_ERR_OP_FAILED);
 				break;
 			}
-			if (strcmp(config, "") == 0) {
+
+			/*
+			 * config can contain multiple elements on the root level, they
+			 * are moved from the <config> element to the root level of the
+			 * document passed to the datastore
+			 */
+			config_doc = xmlNewDoc(BAD_CAST "1.0");
+			if (root->children == NULL) {
 				/* config is empty -> ignore rest of magic here,
 				 * go to application of the operation and do
 				 * delete of the datastore (including running)!
 				 */
+				xmlFreeNode(root);
 				goto apply_editcopyconfig;
 			}
 
-			/*
-			 * config can contain multiple elements on the root level, so
-			 * cover it with the <config> element to allow the creation of
-			 * xml document
-			 */
-			if (strncmp(config, "<config>", 8) == 0) {
-				data = strdup(config);
-			} else if (asprintf(&data, "<config>%s</config>", config) == -1) {
-				ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
-				e = nc_err_new(NC_ERR_OP_FAILED);
-				break;
-			}
-			free(config);
-			config = NULL;
-			doc1 = xmlReadDoc(BAD_CAST data, NULL, NULL, NC_XMLREAD_OPTIONS);
-			free(data);
-
-			if (doc1 == NULL || doc1->children == NULL || doc1->children->children == NULL) {
-				if (doc1 != NULL) {
-					xmlFreeDoc(doc1);
-				}
-				e = nc_err_new(NC_ERR_INVALID_VALUE);
-				nc_err_set(e, NC_ERR_PARAM_MSG, "Invalid <config> parameter of the rpc request.");
-				break;
-			}
-
 			/* keep only root elements applicable to the currently processed datastore */
-			for (doc2 = NULL, aux_node = doc1->children->children; aux_node != NULL; aux_node = aux_node->next) {
-				if (is_model_root(aux_node, ds->data_model)) {
-					if (!doc2) {
-						doc2 = xmlNewDoc(BAD_CAST "1.0");
-						xmlDocSetRootElement(doc2, xmlCopyNode(aux_node, 1));
+			for (node = root->children; node != NULL; node = aux_node) {
+				aux_node = node->next;
+				if (is_model_root(node, ds->data_model)) {
+					xmlUnlinkNode(node);
+					if (config_doc->children == NULL) {
+						xmlDocSetRootElement(config_doc, node);
 					} else {
-						xmlAddNextSibling(doc2->last, xmlCopyNode(aux_node, 1));
+						xmlAddNextSibling(config_doc->last, node);
 					}
 				}
 			}
-			xmlFreeDoc(doc1);
-			if (!doc2) {
+			xmlFreeNode(root);
+			if (config_doc->children == NULL) {
 				/* request is not intended for this device */
 				/* this makes copy-config behavior a little bit magic - if we
 				 * copy data from a standard datastore (e.g. startup), and some
@@ -5985,6 +6138,7 @@ process_datastore:
 				 * parts and do copy only of the parts that rewrites the target
 				 * with some data.
 				 */
+				xmlFreeDoc(config_doc);
 				ret = EXIT_RPC_NOT_APPLICABLE;
 				break;
 			}
@@ -5998,31 +6152,18 @@ process_datastore:
 				 * value is not equal to the default value, the invalid-value
 				 * error reply must be returned.
 				 */
-				if (ncdflt_edit_remove_default(doc2, ds->ext_model) != EXIT_SUCCESS) {
+				if (ncdflt_edit_remove_default(config_doc, ds->ext_model) != EXIT_SUCCESS) {
+					xmlFreeDoc(config_doc);
 					e = nc_err_new(NC_ERR_INVALID_VALUE);
 					nc_err_set(e, NC_ERR_PARAM_MSG, "with-defaults capability failure");
 					break;
 				}
 			}
-
-			/* dump the data to string */
-			resultbuffer = xmlBufferCreate();
-			if (resultbuffer == NULL) {
-				ERROR("%s: xmlBufferCreate failed (%s:%d).", __func__, __FILE__, __LINE__);
-				e = nc_err_new(NC_ERR_OP_FAILED);
-				break;
-			}
-			for (aux_node = doc2->children; aux_node != NULL; aux_node = aux_node->next) {
-				xmlNodeDump(resultbuffer, NULL, aux_node, 2, 1);
-			}
-			config = strdup((char *) xmlBufferContent(resultbuffer));
-			xmlBufferFree(resultbuffer);
-			xmlFreeDoc(doc2);
 		}
 apply_editcopyconfig:
 		/* perform the operation */
 		if (op == NC_OP_EDITCONFIG) {
-			ret = ds->func.editconfig(ds, session, rpc, target_ds, config, nc_rpc_get_defop(rpc), nc_rpc_get_erropt(rpc), &e);
+			ret = apply_editconfig(ds, session, rpc, target_ds, config_doc, nc_rpc_get_defop(rpc), nc_rpc_get_erropt(rpc), &e);
 #ifndef DISABLE_VALIDATION
 			if (ret == EXIT_SUCCESS && (nc_cpblts_enabled(session, NC_CAP_VALIDATE11_ID) || nc_cpblts_enabled(session, NC_CAP_VALIDATE10_ID))) {
 				/* process test option if set */
@@ -6071,13 +6212,13 @@ apply_editcopyconfig:
 				source_ds = NC_DATASTORE_CONFIG;
 				if (target_ds == NC_DATASTORE_URL) {
 					/* if target is url, prepare document content */
-					data = config;
-					config = NULL;
-					if (asprintf(&config, "<?xml version=\"1.0\"?><config xmlns=\""NC_NS_BASE10"\">%s</config>", data) == -1) {
-						ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+					if ((data = dump_datastore_data(config_doc)) == NULL ||
+							asprintf(&config, "<?xml version=\"1.0\"?><config xmlns=\""NC_NS_BASE10"\">%s</config>", data) == -1) {
+						ERROR("Preparing the URL content failed (%s:%d).", __FILE__, __LINE__);
 						e = nc_err_new(NC_ERR_OP_FAILED);
 						nc_err_set(e, NC_ERR_PARAM_MSG, "libnetconf server internal error, see error log.");
 						free(data);
+						xmlFreeDoc(config_doc);
 						break; /* main switch */
 					}
 					free(data);
@@ -6175,17 +6316,7 @@ apply_editcopyconfig:
 						}
 					}
 
-					data = ds->func.getconfig(ds, session, source_ds, &e);
-					if (data == NULL ) {
-						if (e == NULL ) {
-							ERROR("%s: Failed to get data from the datastore (%s:%d).", __func__, __FILE__, __LINE__);
-							e = nc_err_new(NC_ERR_OP_FAILED);
-						}
-						xmlFreeDoc(doc1);
-						break;
-					}
-					doc2 = read_datastore_data(ds->id, data);
-					free(data);
+					doc2 = get_datastore_data(ds, session, source_ds, &e);
 					if (doc2 == NULL) {
 						if (e == NULL ) {
 							ERROR("%s: Unable to process datastore data (%s:%d).", __func__, __FILE__, __LINE__);
@@ -6217,18 +6348,20 @@ apply_editcopyconfig:
 					ret = EXIT_SUCCESS;
 				} else {
 					free(config);
+					xmlFreeDoc(config_doc);
 					break; /* main switch */
 				}
 			} else {
 #else
 			{
 #endif /* DISABLE_URL */
-				ret = ds->func.copyconfig(ds, session, rpc, target_ds, source_ds, config, &e);
+				ret = apply_copyconfig(ds, session, rpc, target_ds, source_ds, config_doc, &e);
 			}
 		} else {
 			ret = EXIT_FAILURE;
 		}
 		free(config);
+		xmlFreeDoc(config_doc);
 
 		break;
 	case NC_OP_DELETECONFIG:
@@ -6374,7 +6507,7 @@ apply_editcopyconfig:
 		break;
 	default:
 		ERROR("%s: unsupported NETCONF operation requested.", __func__);
-		pthread_mutex_unlock(&ds->lock);
+		pthread_rwlock_unlock(&ds->lock);
 		return (nc_reply_error (nc_err_new (NC_ERR_OP_NOT_SUPPORTED)));
 		break;
 	}
@@ -6442,7 +6575,7 @@ apply_editcopyconfig:
 	xmlFreeDoc (old);
 	old = NULL;
 
-	pthread_mutex_unlock(&ds->lock);
+	pthread_rwlock_unlock(&ds->lock);
 
 	if (id == NCDS_INTERNAL_ID) {
 		if (old_reply == NULL) {
@@ -6503,7 +6636,7 @@ API nc_reply* ncds_apply_rpc2all(struct nc_session* session, const nc_rpc* rpc,
 	struct ncds_ds_list* ds, *ds_rollback;
 	nc_reply *old_reply = NULL, *new_reply = NULL, *reply = NULL;
 	int id_i = 0, transapi = 0;
-	char *op_name, *op_namespace, *data;
+	char *op_name, *op_namespace;
 	xmlDocPtr old;
 	NC_OP op;
 	NC_DATASTORE target;
@@ -6542,10 +6675,7 @@ API nc_reply* ncds_apply_rpc2all(struct nc_session* session, const nc_rpc* rpc,
 		erropt = nc_rpc_get_erropt(rpc);
 		break;
 	case NC_OP_GET:
-		data = serialize_cpblts(session->capabilities);
-		pthread_spin_lock(&server_cpblt_lock);
-		server_capabilities = data;
-		pthread_spin_unlock(&server_cpblt_lock);
+		pthread_setspecific(server_cpblt_key, serialize_cpblts(session->capabilities));
 		/* no break */
 	case NC_OP_GETCONFIG:
 		shared_filter = nc_rpc_get_filter(rpc);
@@ -6576,10 +6706,8 @@ API nc_reply* ncds_apply_rpc2all(struct nc_session* session, const nc_rpc* rpc,
 			if ((new_reply = nc_reply_merge(2, old_reply, reply)) == NULL) {
 				nc_filter_free(shared_filter);
 				shared_filter = NULL;
-				pthread_spin_lock(&server_cpblt_lock);
-				free(server_capabilities);
-				server_capabilities = NULL;
-				pthread_spin_unlock(&server_cpblt_lock);
+				free(pthread_getspecific(server_cpblt_key));
+				pthread_setspecific(server_cpblt_key, NULL);
 
 				if (nc_reply_get_type(old_reply) == NC_REPLY_ERROR) {
 					return (old_reply);
@@ -6611,12 +6739,9 @@ API nc_reply* ncds_apply_rpc2all(struct nc_session* session, const nc_rpc* rpc,
 
 						if (transapi) {
 							/* remeber data for transAPI diff */
-							data = ds_rollback->datastore->func.getconfig(ds_rollback->datastore, session, NC_DATASTORE_RUNNING, &e);
+							old = get_datastore_data(ds_rollback->datastore, session, NC_DATASTORE_RUNNING, &e);
 							nc_err_free(e);
 							e = NULL;
-
-							old = read_datastore_data(ds_rollback->datastore->id, data);
-							free(data);
 						}
 
 						ds_rollback->datastore->func.rollback(ds_rollback->datastore);
@@ -6653,14 +6778,61 @@ cleanup:
 	nc_filter_free(shared_filter);
 	shared_filter = NULL;
 
-	pthread_spin_lock(&server_cpblt_lock);
-	free(server_capabilities);
-	server_capabilities = NULL;
-	pthread_spin_unlock(&server_cpblt_lock);
+	free(pthread_getspecific(server_cpblt_key));
+	pthread_setspecific(server_cpblt_key, NULL);
 
 	return (reply);
 }
 
+ncds_id ncds_rpc_write_target(const nc_rpc* rpc)
+{
+	xmlXPathObjectPtr query_result;
+	xmlNodePtr node;
+	const xmlChar *ns = NULL;
+	struct ncds_ds_list* ds;
+	ncds_id id = -1;
+	int i;
+
+	if (nc_rpc_get_op(rpc) != NC_OP_EDITCONFIG || nc_rpc_get_erropt(rpc) == NC_EDIT_ERROPT_ROLLBACK) {
+		/* operations on whole datastores, rollback affects all of them */
+		return (-1);
+	}
+
+	/* all the top-level configuration elements must belong to the same module */
+	query_result = xmlXPathEvalExpression(BAD_CAST "/"NC_NS_BASE10_ID":rpc/"NC_NS_BASE10_ID":edit-config/"NC_NS_BASE10_ID":config/*", rpc->ctxt);
+	if (query_result == NULL) {
+		return (-1);
+	}
+	if (!xmlXPathNodeSetIsEmpty(query_result->nodesetval)) {
+		for (i = 0; i < query_result->nodesetval->nodeNr; i++) {
+			node = query_result->nodesetval->nodeTab[i];
+			if (node->ns == NULL || (ns != NULL && !xmlStrEqual(ns, node->ns->href))) {
+				ns = NULL;
+				break;
+			}
+			ns = node->ns->href;
+		}
+	}
+
+	if (ns != NULL) {
+		for (ds = ncds.datastores; ds != NULL; ds = ds->next) {
+			if (ds->datastore->data_model == NULL || ds->datastore->data_model->ns == NULL
+					|| !xmlStrEqual(ns, BAD_CAST ds->datastore->data_model->ns)) {
+				continue;
+			}
+			if (id != -1 || (ds->datastore->id > 0 && ds->datastore->id < internal_ds_count)) {
+				/* ambiguous or an internal datastore */
+				id = -1;
+				break;
+			}
+			id = ds->datastore->id;
+		}
+	}
+	xmlXPathFreeObject(query_result);
+
+	return (id);
+}
+
 API void ncds_break_locks(const struct nc_session* session)
 {
 	struct ncds_ds_list * ds;
@@ -6681,7 +6853,7 @@ API void ncds_break_locks(const struct nc_session* session)
 		/* if session NULL, get all sessions that hold lock from first file datastore */
 		ds = ncds.datastores;
 		/* find first file datastore */
-		while (ds != NULL && ds->datastore != NULL && ds->datastore->type != NCDS_TYPE_FILE) {
+		while (ds != NULL && ds->datastore != NULL && ds->datastore->type != NCDS_TYPE_FILE && ds->datastore->type != NCDS_TYPE_BIN && ds->datastore->type != NCDS_TYPE_SHM) {
 			ds = ds->next;
 		}
 		if (ds != NULL) {
@@ -6725,7 +6897,7 @@ API void ncds_break_locks(const struct nc_session* session)
 #ifndef DISABLE_NOTIFICATIONS
 					} else {
 						/* log the event */
-						if (ds->datastore->type == NCDS_TYPE_FILE) {
+						if (ds->datastore->type == NCDS_TYPE_FILE || ds->datastore->type == NCDS_TYPE_BIN || ds->datastore->type == NCDS_TYPE_SHM) {
 							switch (ds_type[j]) {
 							case NC_DATASTORE_RUNNING:
 								ds_name = "running";
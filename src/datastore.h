@@ -55,7 +55,9 @@ typedef enum {
 	NCDS_TYPE_ERROR = -1, /**< virtual enum value for internal purposes */
 	NCDS_TYPE_EMPTY, /**< No real datastore. For read-only devices. */
 	NCDS_TYPE_FILE, /**< Datastores implemented as files */
-	NCDS_TYPE_CUSTOM /**< User-defined datastore */
+	NCDS_TYPE_CUSTOM, /**< User-defined datastore */
+	NCDS_TYPE_BIN, /**< Datastores implemented as files in a compact binary format */
+	NCDS_TYPE_SHM /**< Datastores kept in the shared memory of the processes using them, backed by a file */
 } NCDS_TYPE;
 
 /**
@@ -137,9 +139,16 @@ extern char error_area;
  *
  *   There is no additional settings for this datastore type.
  *
- * - \ref fileds (*NCDS_TYPE_FILE*)
+ * - \ref fileds (*NCDS_TYPE_FILE*, *NCDS_TYPE_BIN*, *NCDS_TYPE_SHM*)
  *
- *   ncds_file_set_path() to set file to store datastore content.
+ *   ncds_file_set_path() to set file to store datastore content. The
+ *   *NCDS_TYPE_BIN* datastore works the same way, but its file is stored in a
+ *   compact binary format that is loaded faster than XML. ncds_bin_import()
+ *   and ncds_bin_export() convert the file from and to XML. The *NCDS_TYPE_SHM*
+ *   datastore stores its content into the XML file as well, but every change
+ *   is published as a binary image in the shared memory, so the other
+ *   processes using the datastore attach the image instead of reading the
+ *   file again.
  *
  * - \ref customds (*NCDS_TYPE_CUSTOM*)
  *
@@ -395,6 +404,49 @@ int ncds_set_validation(struct ncds_ds* ds, int enable, const char* relaxng, con
  */
 int ncds_file_set_path(struct ncds_ds* datastore, const char* path);
 
+/**
+ * @ingroup fileds
+ * @brief Get the statistics of locking the file datastore in this process.
+ *
+ * Read-only operations (get-config) share the lock, so they can run in
+ * parallel, other operations get it exclusively.
+ *
+ * @param[in] datastore Initiated file datastore structure.
+ * @param[out] reads Number of shared locks acquired, can be NULL.
+ * @param[out] writes Number of exclusive locks acquired, can be NULL.
+ * @param[out] timeouts Number of lock attempts given up after the timeout, can be NULL.
+ * @param[out] wait_usec Total time spent waiting for the lock in microseconds, can be NULL.
+ * @param[out] max_wait_usec Longest wait for the lock in microseconds, can be NULL.
+ * @return
+ * - 0 on success
+ * - -1 Invalid datastore
+ */
+int ncds_file_get_lock_stats(struct ncds_ds* datastore, unsigned long long* reads, unsigned long long* writes, unsigned long long* timeouts, unsigned long long* wait_usec, unsigned long long* max_wait_usec);
+
+/**
+ * @ingroup fileds
+ * @brief Convert the XML file datastore into the binary one (NCDS_TYPE_BIN).
+ *
+ * The conversion is lossless, ncds_bin_export() gives the same XML document.
+ * The changes in the journal of the datastore that were not yet written into
+ * its file are not converted, so the datastore should not be in use.
+ *
+ * @param[in] xml_path Path of the XML datastore file.
+ * @param[in] bin_path Path of the binary datastore file to create.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int ncds_bin_import(const char* xml_path, const char* bin_path);
+
+/**
+ * @ingroup fileds
+ * @brief Convert the binary file datastore (NCDS_TYPE_BIN) into the XML one.
+ *
+ * @param[in] bin_path Path of the binary datastore file.
+ * @param[in] xml_path Path of the XML datastore file to create.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int ncds_bin_export(const char* bin_path, const char* xml_path);
+
 /**
  * @ingroup store
  * @brief Activate datastore structure for use.
@@ -451,7 +503,12 @@ void ncds_free2(ncds_id datastore_id);
  * @brief Perform the requested RPC operation on the all datastores controlled
  * by the libnetconf (created by ncdsd_new() and ncds_init()).
  *
- * **This function IS NOT thread safety.**
+ * The function can be called from more threads at once, reading operations
+ * on a datastore run in parallel while its modifications are serialized.
+ * However, the \p ids array is shared by all the calls, so the concurrent
+ * callers have to pass NULL, and no datastore can be added or removed
+ * meanwhile. To process requests in parallel while keeping the order of the
+ * replies, use the worker pool (ncds_workers_new()).
  *
  * @param[in] session NETCONF session (a dummy session is acceptable) where the
  * \<rpc\> came from. Capabilities checks are done according to this session.
@@ -470,6 +527,67 @@ void ncds_free2(ncds_id datastore_id);
  */
 nc_reply* ncds_apply_rpc2all(struct nc_session* session, const nc_rpc* rpc, ncds_id* ids[]);
 
+/**
+ * @ingroup store
+ * @brief Pool of threads applying \<rpc\>s to the datastores.
+ */
+struct ncds_workers;
+
+/**
+ * @ingroup store
+ * @brief Start a pool of threads applying the submitted \<rpc\>s to the
+ * datastores by ncds_apply_rpc2all().
+ *
+ * \<rpc\>s of different sessions are processed in parallel, but the requests
+ * of a single session are processed one by one in the order they were
+ * submitted, so the replies are sent in the order required by RFC 6241.
+ * Write operations modifying a single datastore (\<edit-config\> with the
+ * configuration data of a single data model) are serialized per datastore,
+ * all the other write operations are performed exclusively.
+ *
+ * Reading operations on a datastore run in parallel, except for the custom
+ * datastores whose callbacks are always called one by one. Therefore, the
+ * status data callbacks (get_state) of a datastore may be called from more
+ * threads at once.
+ *
+ * @param[in] count Number of threads, 0 for the number of online processors.
+ * @return Created worker pool, NULL on error.
+ */
+struct ncds_workers* ncds_workers_new(int count);
+
+/**
+ * @ingroup store
+ * @brief Pass the \<rpc\> to the worker pool. The \<rpc\> is applied to the
+ * datastores and the reply is sent to the session by a worker thread. The
+ * reply is not sent from the calling thread, but the session can be still
+ * used to receive the following requests.
+ *
+ * @param[in] workers Worker pool to use.
+ * @param[in] session Session the \<rpc\> was received on.
+ * @param[in] rpc \<rpc\> of the NC_RPC_DATASTORE_READ or NC_RPC_DATASTORE_WRITE
+ * type. On success, the worker pool takes care of freeing it.
+ * @return EXIT_SUCCESS or EXIT_FAILURE (e.g. another type of the \<rpc\>), in
+ * such a case, the caller is still responsible for the \<rpc\>.
+ */
+int ncds_workers_submit(struct ncds_workers* workers, struct nc_session* session, nc_rpc* rpc);
+
+/**
+ * @ingroup store
+ * @brief Drop all the queued \<rpc\>s of the session and wait for the one
+ * being just processed. It must be called before freeing the session.
+ *
+ * @param[in] workers Worker pool to use.
+ * @param[in] session Session to forget.
+ */
+void ncds_workers_cancel(struct ncds_workers* workers, const struct nc_session* session);
+
+/**
+ * @ingroup store
+ * @brief Process all the queued \<rpc\>s, stop the threads and free the pool.
+ * @param[in] workers Worker pool to free.
+ */
+void ncds_workers_free(struct ncds_workers* workers);
+
 /**
  * @ingroup store
  * @brief Undo the last change performed on the specified datastore.
@@ -50,6 +50,7 @@
 
 #include "../transapi.h"
 #include "../datastore.h"
+#include "../datastore_xml.h"
 
 #define EXIT_RPC_NOT_APPLICABLE -2
 
@@ -125,6 +126,18 @@ struct ncds_funcs {
 	 * @return NULL on error, resulting data on success.
 	*/
 	char* (*getconfig)(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE target, struct nc_err** error);
+	/**
+	 * @brief Get configuration data stored in target datastore as a document,
+	 * optional - if NULL, the data from getconfig() are parsed instead
+	 *
+	 * @param[in] ds Datastore structure from which the data will be obtained.
+	 * @param[in] session Session originating the request.
+	 * @param[in] source Datastore (runnign, startup, candidate) to get the data from.
+	 * @param[out] error NETCONF error structure describing the experienced error.
+	 * @return NULL on error, document with the top-level configuration elements
+	 * as its root siblings on success (empty document for an empty datastore).
+	 */
+	xmlDocPtr (*getconfig_xml)(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE target, struct nc_err** error);
 	/**
 	 * @brief Copy the content of source datastore or externally sent configuration to target datastore
 	 *
@@ -141,6 +154,18 @@ struct ncds_funcs {
 	 * 	   EXIT_FAILURE when error occured
 	 */
 	int (*copyconfig)(struct ncds_ds* ds, const struct nc_session* session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, char* config, struct nc_err** error);
+	/**
+	 * @brief Copy the content of source datastore or externally sent configuration
+	 * to target datastore, optional - if NULL, copyconfig() gets the serialized
+	 * configuration instead
+	 *
+	 * @param config Configuration to be used as the source in the form returned
+	 * by getconfig_xml(), NULL if the source is a datastore. The document stays
+	 * owned by the caller.
+	 *
+	 * The other parameters and the return value are the same as for copyconfig().
+	 */
+	int (*copyconfig_xml)(struct ncds_ds* ds, const struct nc_session* session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, xmlDocPtr config, struct nc_err** error);
 	/**
 	 * @brief Delete the target datastore
 	 *
@@ -167,6 +192,16 @@ struct ncds_funcs {
 	 * @return EXIT_SUCCESS or EXIT_FAILURE
 	 */
 	int (*editconfig)(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, const char * config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error);
+	/**
+	 * @brief Edit configuration in datastore, optional - if NULL, editconfig()
+	 * gets the serialized edit configuration instead
+	 *
+	 * @param config Edit configuration in the form returned by getconfig_xml().
+	 * The document stays owned by the caller, but its content can be changed.
+	 *
+	 * The other parameters and the return value are the same as for editconfig().
+	 */
+	int (*editconfig_xml)(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, xmlDocPtr config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error);
 };
 
 struct model_feature {
@@ -326,9 +361,10 @@ struct ncds_ds {
 	 */
 	time_t last_access;
 	/**
-	 * @brief Lock for serialized access/modification of the datastore.
+	 * @brief Lock for serialized modification of the datastore, reading
+	 * operations hold it shared.
 	 */
-	pthread_mutex_t lock;
+	pthread_rwlock_t lock;
 	/**
 	 * @brief Pointer to a callback function implementing the retrieval of the
 	 * device status data.
@@ -375,4 +411,13 @@ struct ncds_ds {
 	int tapi_callbacks_count;
 };
 
+/**
+ * @brief Get the datastore modified by the \<rpc\>, it is used to order the
+ * write operations processed by the worker pool.
+ * @param[in] rpc \<rpc\> of the NC_RPC_DATASTORE_WRITE type.
+ * @return ID of the only datastore the \<rpc\> can modify, -1 if it can modify
+ * more of them (or it cannot be easily recognized).
+ */
+ncds_id ncds_rpc_write_target(const nc_rpc* rpc);
+
 #endif /* NC_DATASTORE_INTERNAL_H_ */
@@ -58,8 +58,6 @@
 
 static const char rcsid[] __attribute__((used)) ="$Id: "__FILE__": "RCSID" $";
 
-#define XPATH_BUFFER 1024
-
 #define NC_EDIT_OP_MERGE_STRING "merge"
 #define NC_EDIT_OP_CREATE_STRING "create"
 #define NC_EDIT_OP_DELETE_STRING "delete"
@@ -67,6 +65,9 @@ static const char rcsid[] __attribute__((used)) ="$Id: "__FILE__": "RCSID" $";
 #define NC_EDIT_OP_REMOVE_STRING "remove"
 #define NC_EDIT_ATTR_OP "operation"
 
+/* sibling sets smaller than this are searched sequentially */
+#define EDIT_INDEX_MIN_SIBLINGS 32
+
 struct key_predicate {
 	int position;
 	char* prefix;
@@ -75,10 +76,60 @@ struct key_predicate {
 	char* value;
 };
 
-typedef enum {
-	NC_CHECK_EDIT_DELETE = NC_EDIT_OP_DELETE,
-	NC_CHECK_EDIT_CREATE = NC_EDIT_OP_CREATE
-} NC_CHECK_EDIT_OP;
+/**
+ * @brief Changes recorded by edit_config_changes()
+ */
+struct edit_changes {
+	struct ncds_change *first, *last;
+	/**
+	 * @brief Configuration data model and its key statements to recognize
+	 * the replaced nodes
+	 */
+	xmlDocPtr model;
+	keyList keys;
+	/**
+	 * @brief Node the last change was made to (the parent of the removed
+	 * node), used only to join the following change with the last one
+	 */
+	xmlNodePtr target;
+};
+
+/**
+ * @brief Index of the original configuration data modified by edit_config(),
+ * kept in the _private pointer of the original document during the edit.
+ */
+struct edit_index {
+	/**
+	 * @brief Compiled configuration data model, NULL if the model is not
+	 * compiled and the data are not indexed
+	 */
+	xmlDocPtr model;
+	/**
+	 * @brief struct sibling_index of the large sibling sets hashed by the
+	 * address of their parent
+	 */
+	xmlHashTablePtr parents;
+	/**
+	 * @brief Changes of the document, NULL if they are not recorded
+	 */
+	struct edit_changes* changes;
+};
+
+/**
+ * @brief Children of a node hashed by their name and the values of their keys
+ */
+struct sibling_index {
+	/**
+	 * @brief Compiled definition of the parent, NULL if unknown
+	 */
+	struct model_index* def;
+	/**
+	 * @brief Children hashed by the name and the key string, see
+	 * edit_index_key(), NULL if the children are searched sequentially
+	 * (some of them cannot be identified by the key string)
+	 */
+	xmlHashTablePtr nodes;
+};
 
 /* from datastore.c */
 int is_key(xmlNodePtr parent, xmlNodePtr child, keyList keys);
@@ -161,6 +212,8 @@ static NC_EDIT_OP_TYPE get_operation(xmlNodePtr node, NC_EDIT_DEFOP_TYPE defop,
 	return op;
 }
 
+static struct model_index* find_element_index(xmlNodePtr node, xmlDocPtr model);
+
 /**
  * \brief Get all the key elements from the configuration data model
  *
@@ -168,15 +221,11 @@ static NC_EDIT_OP_TYPE get_operation(xmlNodePtr node, NC_EDIT_DEFOP_TYPE defop,
  *
  * \return              keyList with references to all the keys in the data model.
  */
-keyList get_keynode_list(xmlDocPtr model)
+static keyList keynode_list_eval(xmlDocPtr model)
 {
 	xmlXPathContextPtr model_ctxt = NULL;
 	xmlXPathObjectPtr result = NULL;
 
-	if (model == NULL) {
-		return (NULL);
-	}
-
 	/* create xpath evaluation context */
 	model_ctxt = xmlXPathNewContext(model);
 	if (model_ctxt == NULL) {
@@ -200,6 +249,50 @@ keyList get_keynode_list(xmlDocPtr model)
 	return ((keyList)result);
 }
 
+keyList get_keynode_list(xmlDocPtr model)
+{
+	if (model == NULL) {
+		return (NULL);
+	}
+
+	if (model->_private != NULL) {
+		/* the model is compiled */
+		return (((struct model_index*)model->_private)->keynodes);
+	}
+
+	return (keynode_list_eval(model));
+}
+
+/**
+ * @return compiled model the key statements come from, NULL if the model is
+ * not compiled
+ */
+static xmlDocPtr keynode_list_model(keyList keys)
+{
+	xmlDocPtr model;
+
+	if (keys == NULL || keys->nodesetval == NULL || keys->nodesetval->nodeNr == 0) {
+		return (NULL);
+	}
+
+	model = keys->nodesetval->nodeTab[0]->doc;
+	if (model == NULL || model->_private == NULL || ((struct model_index*)model->_private)->keynodes != keys) {
+		return (NULL);
+	}
+
+	return (model);
+}
+
+void keyListFree(keyList keys)
+{
+	if (keys == NULL || keynode_list_model(keys) != NULL) {
+		/* kept in the index of the model */
+		return;
+	}
+
+	xmlXPathFreeObject((xmlXPathObjectPtr)keys);
+}
+
 /* get the key nodes from the xml document */
 static int find_key_elems(xmlNodePtr modelnode, xmlNodePtr node, int all, xmlNodePtr **result)
 {
@@ -255,6 +348,30 @@ static int find_key_elems(xmlNodePtr modelnode, xmlNodePtr node, int all, xmlNod
 	return EXIT_SUCCESS;
 }
 
+/* get the key nodes from the xml document using the compiled definition, see find_key_elems() */
+static int find_key_elems_index(struct model_index* idx, xmlNodePtr node, int all, xmlNodePtr **result)
+{
+	int i, j;
+
+	if ((*result = (xmlNodePtr*)calloc(idx->keys_count + 1, sizeof(xmlNodePtr))) == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	for (i = 0, j = 0; i < idx->keys_count; i++) {
+		/* the names are interned, but the node's name may come from another dictionary */
+		for ((*result)[j] = node->children; (*result)[j] != NULL && xmlStrcmp(idx->keys[i], (*result)[j]->name); (*result)[j] = (*result)[j]->next);
+		if ((*result)[j] != NULL) {
+			j++;
+		} else if (all) {
+			free(*result);
+			*result = NULL;
+			return (EXIT_FAILURE);
+		}
+	}
+
+	return (EXIT_SUCCESS);
+}
+
 /**
  * \brief Get all the key nodes for the specific element.
  *
@@ -270,6 +387,8 @@ static int get_keys(keyList keys, xmlNodePtr node, int all, xmlNodePtr **result)
 	xmlChar *str = NULL;
 	int j, match;
 	xmlNodePtr key_parent, node_parent;
+	xmlDocPtr model;
+	struct model_index* idx;
 
 	assert(keys != NULL);
 	assert(node != NULL);
@@ -277,6 +396,14 @@ static int get_keys(keyList keys, xmlNodePtr node, int all, xmlNodePtr **result)
 
 	*result = NULL;
 
+	if ((model = keynode_list_model(keys)) != NULL) {
+		/* the keys of the compiled model are resolved by its index */
+		if ((idx = find_element_index(node, model)) == NULL || idx->keys == NULL) {
+			return (EXIT_SUCCESS);
+		}
+		return (find_key_elems_index(idx, node, all, result));
+	}
+
 	for (j = 0; j < keys->nodesetval->nodeNr; j++) {
 		/* get corresponding key definition from the data model */
 		// name = xmlGetNsProp (keys->nodesetval->nodeTab[i]->parent, BAD_CAST "name", BAD_CAST NC_NS_YIN);
@@ -558,6 +685,253 @@ static xmlNodePtr find_element_model_compare(xmlNodePtr node, xmlNodePtr model_n
 	return (NULL);
 }
 
+static struct model_index* model_index_new(xmlNodePtr def, const xmlChar* name, xmlDictPtr dict);
+
+static void model_index_node_free(void* payload, const xmlChar* UNUSED(name))
+{
+	struct model_index* idx = (struct model_index*)payload;
+
+	if (idx->children != NULL) {
+		xmlHashFree(idx->children, model_index_node_free);
+	}
+	free(idx->keys);
+	free(idx);
+}
+
+/**
+ * @brief Add the definition of a child node into the index, the same way
+ * find_element_model_compare() looks for it - choice, case and augment
+ * statements are transparent and the first definition of a name is used.
+ */
+static int model_index_add(struct model_index* parent, xmlNodePtr model_node, xmlDictPtr dict)
+{
+	xmlNodePtr aux;
+	xmlChar* name;
+	const xmlChar* iname;
+	struct model_index* idx;
+
+	if (xmlStrcmp(model_node->name, BAD_CAST "choice") == 0 ||
+	    xmlStrcmp(model_node->name, BAD_CAST "case") == 0 ||
+	    xmlStrcmp(model_node->name, BAD_CAST "augment") == 0) {
+		for (aux = model_node->children; aux != NULL; aux = aux->next) {
+			if (model_index_add(parent, aux, dict) != EXIT_SUCCESS) {
+				return (EXIT_FAILURE);
+			}
+		}
+		return (EXIT_SUCCESS);
+	}
+
+	if ((name = xmlGetProp(model_node, BAD_CAST "name")) == NULL) {
+		return (EXIT_SUCCESS);
+	}
+	iname = xmlDictLookup(dict, name, -1);
+	xmlFree(name);
+	if (iname == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	if (parent->children == NULL && (parent->children = xmlHashCreateDict(0, dict)) == NULL) {
+		return (EXIT_FAILURE);
+	}
+	if (xmlHashLookup(parent->children, iname) != NULL) {
+		/* hidden by the previous definition of the same name */
+		return (EXIT_SUCCESS);
+	}
+
+	if ((idx = model_index_new(model_node, iname, dict)) == NULL) {
+		return (EXIT_FAILURE);
+	}
+	if (xmlHashAddEntry(parent->children, iname, idx) != 0) {
+		model_index_node_free(idx, NULL);
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Compile the definition of a node and all its children.
+ */
+static struct model_index* model_index_new(xmlNodePtr def, const xmlChar* name, xmlDictPtr dict)
+{
+	struct model_index* idx;
+	xmlNodePtr aux;
+	xmlChar* value;
+	char *s, *token;
+	int i;
+
+	if ((idx = calloc(1, sizeof(struct model_index))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (NULL);
+	}
+	idx->def = def;
+	idx->name = name;
+
+	if (xmlStrcmp(def->name, BAD_CAST "container") == 0) {
+		idx->type = MODEL_NODE_CONTAINER;
+	} else if (xmlStrcmp(def->name, BAD_CAST "leaf") == 0) {
+		idx->type = MODEL_NODE_LEAF;
+	} else if (xmlStrcmp(def->name, BAD_CAST "leaf-list") == 0) {
+		idx->type = MODEL_NODE_LEAFLIST;
+	} else if (xmlStrcmp(def->name, BAD_CAST "list") == 0) {
+		idx->type = MODEL_NODE_LIST;
+	} else if (xmlStrcmp(def->name, BAD_CAST "anyxml") == 0) {
+		idx->type = MODEL_NODE_ANYXML;
+	} else {
+		idx->type = MODEL_NODE_OTHER;
+	}
+	idx->user_ordered = is_user_ordered_list(def);
+	idx->choice = is_partof_choice(def);
+
+	for (aux = def->children; aux != NULL; aux = aux->next) {
+		if (idx->dflt == NULL && xmlStrcmp(aux->name, BAD_CAST "default") == 0) {
+			idx->dflt = aux;
+		} else if (idx->key == NULL && aux->type == XML_ELEMENT_NODE && xmlStrcmp(aux->name, BAD_CAST "key") == 0) {
+			idx->key = aux;
+		}
+	}
+
+	/* the key names are a space-separated list, see find_key_elems() */
+	if (idx->key != NULL && (value = xmlGetProp(idx->key, BAD_CAST "value")) != NULL) {
+		for (i = 0, idx->keys_count = 1; value[i] != '\0'; i++) {
+			if (value[i] == ' ') {
+				idx->keys_count++;
+			}
+		}
+		if ((idx->keys = calloc(idx->keys_count, sizeof(xmlChar*))) == NULL) {
+			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+			xmlFree(value);
+			model_index_node_free(idx, NULL);
+			return (NULL);
+		}
+		for (i = 0, s = (char*)value; (token = strtok(s, " ")) != NULL; s = NULL) {
+			idx->keys[i++] = xmlDictLookup(dict, BAD_CAST token, -1);
+		}
+		idx->keys_count = i;
+		xmlFree(value);
+	}
+
+	for (aux = def->children; aux != NULL; aux = aux->next) {
+		if (model_index_add(idx, aux, dict) != EXIT_SUCCESS) {
+			model_index_node_free(idx, NULL);
+			return (NULL);
+		}
+	}
+
+	return (idx);
+}
+
+void model_index_free(xmlDocPtr model)
+{
+	struct model_index* root;
+	xmlDictPtr dict;
+
+	if (model == NULL || model->_private == NULL) {
+		return;
+	}
+
+	root = (struct model_index*)model->_private;
+	model->_private = NULL;
+	if (root->keynodes != NULL) {
+		xmlXPathFreeObject(root->keynodes);
+	}
+	dict = root->dict;
+	model_index_node_free(root, NULL);
+	xmlDictFree(dict);
+}
+
+int model_index_build(xmlDocPtr model)
+{
+	struct model_index* root;
+	xmlDictPtr dict;
+	xmlNodePtr aux;
+
+	if (model == NULL || xmlDocGetRootElement(model) == NULL) {
+		return (EXIT_FAILURE);
+	}
+	model_index_free(model);
+
+	if ((dict = xmlDictCreate()) == NULL) {
+		return (EXIT_FAILURE);
+	}
+	if ((root = calloc(1, sizeof(struct model_index))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		xmlDictFree(dict);
+		return (EXIT_FAILURE);
+	}
+	root->def = xmlDocGetRootElement(model);
+	root->dict = dict;
+
+	for (aux = root->def->children; aux != NULL; aux = aux->next) {
+		if (model_index_add(root, aux, dict) != EXIT_SUCCESS) {
+			model_index_node_free(root, NULL);
+			xmlDictFree(dict);
+			return (EXIT_FAILURE);
+		}
+	}
+	/* evaluated once, get_keynode_list() returns it until the index is freed */
+	root->keynodes = keynode_list_eval(model);
+	model->_private = root;
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Find the compiled definition of the node, one hash lookup per level
+ * of the node's path. The model MUST be compiled by model_index_build().
+ *
+ * @param[in] node XML element which we want to find in the model
+ * @param[in] model Compiled configuration data model
+ * @return compiled definition of the node, NULL if no such element is found.
+ */
+static struct model_index* find_element_index(xmlNodePtr node, xmlDocPtr model)
+{
+	struct model_index* parent;
+
+	if (node == NULL || node->parent == NULL || node->name == NULL) {
+		return (NULL);
+	}
+
+	if (node->parent->type != XML_DOCUMENT_NODE) {
+		parent = find_element_index(node->parent, model);
+	} else {
+		parent = (struct model_index*)model->_private;
+	}
+	if (parent == NULL || parent->children == NULL) {
+		return (NULL);
+	}
+
+	return ((struct model_index*)xmlHashLookup(parent->children, node->name));
+}
+
+/**
+ * @return the user-ordered type of the node's definition, see is_user_ordered_list()
+ */
+static int model_user_ordered(xmlNodePtr node, xmlDocPtr model)
+{
+	struct model_index* idx;
+
+	if (model != NULL && model->_private != NULL) {
+		return (((idx = find_element_index(node, model)) != NULL) ? idx->user_ordered : 0);
+	}
+
+	return (is_user_ordered_list(find_element_model(node, model)));
+}
+
+/**
+ * @return the choice branch of the node's definition, see is_partof_choice()
+ */
+static xmlNodePtr model_choice_branch(xmlNodePtr node, xmlDocPtr model)
+{
+	struct model_index* idx;
+
+	if (model != NULL && model->_private != NULL) {
+		return (((idx = find_element_index(node, model)) != NULL) ? idx->choice : NULL);
+	}
+
+	return (is_partof_choice(find_element_model(node, model)));
+}
+
 /**
  * @brief Go recursively in the YIN model and find model's equivalent of the node
  * @param[in] node XML element which we want to find in the model
@@ -567,11 +941,18 @@ static xmlNodePtr find_element_model_compare(xmlNodePtr node, xmlNodePtr model_n
 xmlNodePtr find_element_model(xmlNodePtr node, xmlDocPtr model)
 {
 	xmlNodePtr mparent, aux, retval;
+	struct model_index* idx;
 
 	if (node == NULL || node->parent == NULL) {
 		return (NULL);
 	}
 
+	if (model != NULL && model->_private != NULL) {
+		/* the model is compiled */
+		idx = find_element_index(node, model);
+		return ((idx != NULL) ? idx->def : NULL);
+	}
+
 	if (node->parent->type != XML_DOCUMENT_NODE) {
 		mparent = find_element_model(node->parent, model);
 	} else {
@@ -601,6 +982,14 @@ static xmlChar* get_default_value(xmlNodePtr node, xmlDocPtr model)
 {
 	xmlNodePtr mnode, aux;
 	xmlChar* value = NULL;
+	struct model_index* idx;
+
+	if (model != NULL && model->_private != NULL) {
+		if ((idx = find_element_index(node, model)) == NULL || idx->dflt == NULL) {
+			return (NULL);
+		}
+		return (xmlGetNsProp(idx->dflt, BAD_CAST "value", BAD_CAST NC_NS_YIN));
+	}
 
 	mnode = find_element_model(node, model);
 	if (mnode == NULL) {
@@ -618,381 +1007,797 @@ static xmlChar* get_default_value(xmlNodePtr node, xmlDocPtr model)
 }
 
 /**
- * \brief Find an equivalent of the given edit node on orig_doc document.
+ * @brief Get the string identifying the node among its siblings of the same
+ * name - the values of the list keys or the value of the leaf-list.
  *
- * \param[in] orig_doc Original configuration document to edit.
- * \param[in] edit Element from the edit-config's \<config\>. Its equivalent in
- *                 orig_doc should be found.
- * \param[in] keys List of the key elements from the configuration data model.
- * \return Found equivalent element, NULL if no such element exists.
+ * @param[in] def Compiled definition of the node, NULL if unknown.
+ * @param[in] node Data node to identify.
+ * @param[out] key Identification of the node, NULL if the node is identified
+ * only by its name. Caller is supposed to free it.
+ * @return 0 on success, 1 if some of the list keys is missing so the node
+ * cannot match any node with all the keys, 2 if the node can match any node of
+ * the same name (leaf-list without value), -1 on error.
  */
-xmlNodePtr find_element_equiv(xmlDocPtr orig_doc, xmlNodePtr edit, xmlDocPtr model, keyList keys)
+static int edit_index_key(struct model_index* def, xmlNodePtr node, char** key)
 {
-	xmlNodePtr orig_parent, node, model_def;
-	int leaf = 0;
+	xmlNodePtr child;
+	xmlChar* content;
+	char *value, *aux;
+	int i;
 
-	if (edit == NULL || orig_doc == NULL) {
-		return (NULL);
-	}
+	*key = NULL;
 
-	/* go recursively to the root */
-	if (edit->parent->type != XML_DOCUMENT_NODE) {
-		orig_parent = find_element_equiv(orig_doc, edit->parent, model, keys);
-	} else {
-		if (orig_doc->children == NULL) {
-			orig_parent = NULL;
-		} else {
-			orig_parent = orig_doc->children->parent;
+	if (def == NULL) {
+		return (0);
+	} else if (def->type == MODEL_NODE_LEAFLIST) {
+		/* the same as matching_elements() compares */
+		if (node->children == NULL || node->children->type != XML_TEXT_NODE) {
+			return (2);
 		}
-	}
-	if (orig_parent == NULL) {
-		return (NULL);
+		return (((*key = nc_clrwspace((char*)(node->children->content))) == NULL) ? -1 : 0);
+	} else if (def->type != MODEL_NODE_LIST) {
+		return (0);
 	}
 
-	model_def = find_element_model(edit, model);
-	if (model_def != NULL && xmlStrcmp(model_def->name, BAD_CAST "leaf-list") == 0) {
-		/* check also children text element when checking elements matching */
-		leaf = 1;
-	}
+	for (i = 0; i < def->keys_count; i++) {
+		for (child = node->children; child != NULL && xmlStrcmp(child->name, def->keys[i]) != 0; child = child->next);
+		if (child == NULL) {
+			free(*key);
+			*key = NULL;
+			return (1);
+		}
 
-	/* element check */
-	node = orig_parent->children;
-	while (node != NULL) {
-		/* compare edit and node */
-		if (matching_elements(edit, node, keys, leaf) == 0) {
-			/* non matching nodes */
-			node = node->next;
-			continue;
+		if ((content = xmlNodeGetContent(child)) == NULL) {
+			value = NULL;
 		} else {
-			/* matching nodes found */
-			return (node);
+			value = nc_clrwspace((char*)content);
+			xmlFree(content);
+		}
+		/* the values are separated by space, colliding keys are resolved by matching_elements() */
+		if (value == NULL || asprintf(&aux, "%s%s%s", (i == 0) ? "" : *key, (i == 0) ? "" : " ", value) == -1) {
+			free(value);
+			free(*key);
+			*key = NULL;
+			return (-1);
 		}
+		free(value);
+		free(*key);
+		*key = aux;
 	}
 
-	/* no corresponding node found */
-	return (NULL);
+	return (0);
 }
 
-/**
- * \brief Get the list of elements with the specified selected edit-config's operation.
- *
- * \param[in] op edit-config's operation type to search for.
- * \param[in] edit XML document covering edit-config's \<config\> element. The
- *                 elements with specified operation will be searched for in
- *                 this document.
- */
-static xmlXPathObjectPtr get_operation_elements(NC_EDIT_OP_TYPE op, xmlDocPtr edit)
+static void sibling_index_free(void* payload, const xmlChar* UNUSED(name))
 {
-	xmlXPathContextPtr edit_ctxt = NULL;
-	xmlXPathObjectPtr operation_nodes = NULL;
-	xmlChar xpath[XPATH_BUFFER];
-	char *opstring;
+	struct sibling_index* sidx = (struct sibling_index*)payload;
 
-	assert(edit != NULL);
+	if (sidx->nodes != NULL) {
+		xmlHashFree(sidx->nodes, NULL);
+	}
+	free(sidx);
+}
 
-	switch (op) {
-	case NC_EDIT_OP_MERGE:
-		opstring = NC_EDIT_OP_MERGE_STRING;
-		break;
-	case NC_EDIT_OP_REPLACE:
-		opstring = NC_EDIT_OP_REPLACE_STRING;
-		break;
-	case NC_EDIT_OP_CREATE:
-		opstring = NC_EDIT_OP_CREATE_STRING;
+/**
+ * @brief Switch the sibling set to the sequential search.
+ */
+static void sibling_index_linear(struct sibling_index* sidx)
+{
+	if (sidx->nodes != NULL) {
+		xmlHashFree(sidx->nodes, NULL);
+		sidx->nodes = NULL;
+	}
+}
+
+/**
+ * @return compiled definition of the child of the indexed parent
+ */
+static struct model_index* sibling_index_def(struct sibling_index* sidx, const xmlChar* name)
+{
+	if (sidx->def == NULL || sidx->def->children == NULL) {
+		return (NULL);
+	}
+	return ((struct model_index*)xmlHashLookup(sidx->def->children, name));
+}
+
+/**
+ * @brief Add the node into the index of its siblings.
+ */
+static void sibling_index_add(struct sibling_index* sidx, xmlNodePtr node)
+{
+	char* key;
+
+	if (sidx->nodes == NULL || node->type != XML_ELEMENT_NODE) {
+		return;
+	}
+
+	switch (edit_index_key(sibling_index_def(sidx, node->name), node, &key)) {
+	case 0:
+		if (xmlHashAddEntry2(sidx->nodes, node->name, BAD_CAST ((key == NULL) ? "" : key), node) != 0) {
+			/* duplicated node, the first one in the document order must be found */
+			sibling_index_linear(sidx);
+		}
+		free(key);
 		break;
-	case NC_EDIT_OP_DELETE:
-		opstring = NC_EDIT_OP_DELETE_STRING;
-		break;
-	case NC_EDIT_OP_REMOVE:
-		opstring = NC_EDIT_OP_REMOVE_STRING;
+	case 1:
+		/* node without all its keys does not match any edit node */
 		break;
 	default:
-		ERROR("Unsupported edit operation %d (%s:%d).", op, __FILE__, __LINE__);
-		return (NULL);
+		sibling_index_linear(sidx);
+		break;
 	}
+}
 
-	/* create xpath evaluation context */
-	edit_ctxt = xmlXPathNewContext(edit);
-	if (edit_ctxt == NULL) {
-		if (edit_ctxt != NULL) {
-			xmlXPathFreeContext(edit_ctxt);
-		}
-		ERROR("Creating the XPath evaluation context failed (%s:%d).", __FILE__, __LINE__);
+static struct sibling_index* edit_index_lookup(struct edit_index* eidx, xmlNodePtr parent)
+{
+	char addr[32];
+
+	snprintf(addr, sizeof(addr), "%p", (void*)parent);
+	return ((struct sibling_index*)xmlHashLookup(eidx->parents, BAD_CAST addr));
+}
+
+static void edit_index_drop(struct edit_index* eidx, xmlNodePtr parent)
+{
+	char addr[32];
+
+	snprintf(addr, sizeof(addr), "%p", (void*)parent);
+	xmlHashRemoveEntry(eidx->parents, BAD_CAST addr, sibling_index_free);
+}
+
+/**
+ * @brief Get the index of the parent's children, it is built on the first use
+ * for the sibling sets with at least EDIT_INDEX_MIN_SIBLINGS nodes.
+ *
+ * @param[in] parent Node from the document modified by edit_config().
+ * @return Index of the children, NULL if they are not indexed.
+ */
+static struct sibling_index* edit_index_get(xmlNodePtr parent)
+{
+	struct edit_index* eidx;
+	struct sibling_index* sidx;
+	xmlNodePtr child;
+	char addr[32];
+	int count;
+
+	if (parent == NULL || parent->doc == NULL || (eidx = (struct edit_index*)(parent->doc->_private)) == NULL || eidx->model == NULL) {
 		return (NULL);
 	}
 
-	if (xmlXPathRegisterNs(edit_ctxt, BAD_CAST NC_NS_BASE_ID, BAD_CAST NC_NS_BASE) != 0) {
-		xmlXPathFreeContext(edit_ctxt);
-		ERROR("Registering a namespace for XPath failed (%s:%d).", __FILE__, __LINE__);
+	snprintf(addr, sizeof(addr), "%p", (void*)parent);
+	if ((sidx = (struct sibling_index*)xmlHashLookup(eidx->parents, BAD_CAST addr)) != NULL) {
+		return (sidx);
+	}
+
+	for (count = 0, child = parent->children; child != NULL && count < EDIT_INDEX_MIN_SIBLINGS; child = child->next, count++);
+	if (count < EDIT_INDEX_MIN_SIBLINGS) {
 		return (NULL);
 	}
 
-	if (snprintf((char*)xpath, XPATH_BUFFER, "//*[@%s:operation='%s']", NC_NS_BASE_ID, opstring) <= 0) {
-		xmlXPathFreeContext(edit_ctxt);
-		ERROR("Preparing the XPath query failed (%s:%d).", __FILE__, __LINE__);
+	if ((sidx = calloc(1, sizeof(struct sibling_index))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (NULL);
+	}
+	if (parent->type == XML_DOCUMENT_NODE) {
+		sidx->def = (struct model_index*)(eidx->model->_private);
+	} else {
+		sidx->def = find_element_index(parent, eidx->model);
+	}
+	if ((sidx->nodes = xmlHashCreate(0)) == NULL) {
+		free(sidx);
 		return (NULL);
 	}
-	operation_nodes = xmlXPathEvalExpression(BAD_CAST xpath, edit_ctxt);
+	for (child = parent->children; child != NULL && sidx->nodes != NULL; child = child->next) {
+		sibling_index_add(sidx, child);
+	}
 
-	/* clean up */
-	xmlXPathFreeContext(edit_ctxt);
+	if (xmlHashAddEntry(eidx->parents, BAD_CAST addr, sidx) != 0) {
+		sibling_index_free(sidx, NULL);
+		return (NULL);
+	}
 
-	return (operation_nodes);
+	return (sidx);
 }
 
 /**
- * \brief Check edit-config's node operations hierarchy.
- *
- * In case of the removal ("remove" and "delete") operations, the supreme operation
- * (including the default operation) cannot be the creation ("create or "replace")
- * operation.
+ * @brief Find the child of the parent matching the edit node using the index.
  *
- * In case of the creation operations, the supreme operation cannot be a removal
- * operation.
- *
- * \param[in] edit XML node from edit-config's \<config\> whose hierarchy
- *                 (supreme operations) will be checked.
- * \param[in] defop Default edit-config's operation for this edit-config call.
- * \param[out] err NETCONF error structure.
- * \return On error, non-zero is returned and err structure is filled. Zero is
- * returned on success.
+ * @param[in] parent Node from the document modified by edit_config().
+ * @param[in] edit Element from the edit-config's \<config\>.
+ * @param[in] keys List of the key elements from the configuration data model.
+ * @param[in] leaf Parameter of matching_elements().
+ * @param[out] result Matching child, NULL if there is no such child.
+ * @return EXIT_SUCCESS if the result was found out, EXIT_FAILURE if the
+ * children must be searched sequentially.
  */
-static int check_edit_ops_hierarchy(xmlNodePtr edit, NC_EDIT_DEFOP_TYPE defop, struct nc_err **error)
+static int edit_index_find(xmlNodePtr parent, xmlNodePtr edit, keyList keys, int leaf, xmlNodePtr* result)
 {
+	struct sibling_index* sidx;
+	xmlNodePtr node;
+	char* key;
+
+	if (keys == NULL || edit->type != XML_ELEMENT_NODE) {
+		return (EXIT_FAILURE);
+	}
+	if ((sidx = edit_index_get(parent)) == NULL || sidx->nodes == NULL) {
+		return (EXIT_FAILURE);
+	}
+	/* edit nodes without all the keys can match more nodes */
+	if (edit_index_key(sibling_index_def(sidx, edit->name), edit, &key) != 0) {
+		return (EXIT_FAILURE);
+	}
+
+	node = (xmlNodePtr)xmlHashLookup2(sidx->nodes, edit->name, BAD_CAST ((key == NULL) ? "" : key));
+	free(key);
+	if (node == NULL) {
+		*result = NULL;
+		return (EXIT_SUCCESS);
+	} else if (matching_elements(edit, node, keys, leaf) == 1) {
+		*result = node;
+		return (EXIT_SUCCESS);
+	}
+
+	/* keys collision or different namespace */
+	return (EXIT_FAILURE);
+}
+
+/**
+ * @brief The node was added or removed, if it is a list key or the value of a
+ * leaf-list, the index of the instance's siblings is no longer valid.
+ */
+static void edit_index_changed(struct edit_index* eidx, xmlNodePtr node)
+{
+	struct sibling_index* sidx;
+	struct model_index* def;
 	xmlNodePtr parent;
-	NC_EDIT_OP_TYPE op, parent_op;
+	int i;
 
-	assert(error != NULL);
+	if (node->type == XML_TEXT_NODE) {
+		/* value of the leaf or leaf-list */
+		if ((node = node->parent) == NULL || node->parent == NULL) {
+			return;
+		}
+		if ((sidx = edit_index_lookup(eidx, node->parent)) != NULL && sidx->nodes != NULL &&
+				(def = sibling_index_def(sidx, node->name)) != NULL && def->type == MODEL_NODE_LEAFLIST) {
+			edit_index_drop(eidx, node->parent);
+			return;
+		}
+	} else if (node->type != XML_ELEMENT_NODE) {
+		return;
+	}
 
-	op = get_operation(edit, NC_EDIT_DEFOP_NOTSET, error);
-	if (op == (NC_EDIT_OP_TYPE)NC_EDIT_DEFOP_NOTSET) {
-		/* no operation defined for this node */
-		return EXIT_SUCCESS;
-	} else if (op == NC_EDIT_OP_ERROR) {
-		return EXIT_FAILURE;
-	} else if (op == NC_EDIT_OP_DELETE || op == NC_EDIT_OP_REMOVE) {
-		if (defop == NC_EDIT_DEFOP_REPLACE) {
-			if (error != NULL) {
-				*error = nc_err_new(NC_ERR_OP_FAILED);
-			}
-			return EXIT_FAILURE;
+	if ((parent = node->parent) == NULL || parent->parent == NULL) {
+		return;
+	}
+	if ((sidx = edit_index_lookup(eidx, parent->parent)) == NULL || sidx->nodes == NULL ||
+			(def = sibling_index_def(sidx, parent->name)) == NULL || def->type != MODEL_NODE_LIST) {
+		return;
+	}
+	for (i = 0; i < def->keys_count; i++) {
+		if (xmlStrcmp(node->name, def->keys[i]) == 0) {
+			edit_index_drop(eidx, parent->parent);
+			return;
 		}
+	}
+}
 
-		/* check parent elements for operation compatibility */
-		parent = edit->parent;
-		while (parent->type != XML_DOCUMENT_NODE) {
-			parent_op = get_operation(parent, NC_EDIT_DEFOP_NOTSET, error);
-			if (parent_op == NC_EDIT_OP_ERROR) {
-				return EXIT_FAILURE;
-			} else if (parent_op == NC_EDIT_OP_CREATE || parent_op == NC_EDIT_OP_REPLACE) {
-				if (error != NULL) {
-					*error = nc_err_new(NC_ERR_OP_FAILED);
-				}
-				return EXIT_FAILURE;
+static int is_leaf_list(xmlNodePtr node, xmlDocPtr model);
+
+API void ncds_changes_free(struct ncds_change* changes)
+{
+	struct ncds_change* next;
+
+	for (; changes != NULL; changes = next) {
+		next = changes->next;
+		free(changes->path);
+		xmlFreeNode(changes->before);
+		xmlFreeNode(changes->after);
+		free(changes);
+	}
+}
+
+/**
+ * @brief Quote the value as an XPath string literal. The value containing both
+ * the apostrophe and the quotation mark is split into the concat() function.
+ *
+ * @return Quoted value, caller is supposed to free it.
+ */
+static char* edit_changes_literal(const char* value)
+{
+	const char *start, *end;
+	char *ret, *aux;
+
+	if (value == NULL) {
+		value = "";
+	}
+	if (strchr(value, '\'') == NULL) {
+		return ((asprintf(&ret, "'%s'", value) == -1) ? NULL : ret);
+	} else if (strchr(value, '"') == NULL) {
+		return ((asprintf(&ret, "\"%s\"", value) == -1) ? NULL : ret);
+	}
+
+	/* concat('...', "'", '...') */
+	ret = strdup("concat(");
+	for (start = value; ret != NULL && *start != '\0'; start = end) {
+		if (*start == '\'') {
+			end = start + 1;
+			if (asprintf(&aux, "%s%s\"'\"", ret, (start == value) ? "" : ",") == -1) {
+				aux = NULL;
 			}
-			parent = parent->parent;
-		}
-	} else if (op == NC_EDIT_OP_CREATE || op == NC_EDIT_OP_REPLACE) {
-		/* check parent elements for operation compatibility */
-		parent = edit->parent;
-		while (parent->type != XML_DOCUMENT_NODE) {
-			parent_op = get_operation(parent, NC_EDIT_DEFOP_NOTSET, error);
-			if (parent_op == NC_EDIT_OP_ERROR) {
-				return EXIT_FAILURE;
-			} else if (parent_op == NC_EDIT_OP_DELETE || parent_op == NC_EDIT_OP_REMOVE) {
-				if (error != NULL) {
-					*error = nc_err_new(NC_ERR_OP_FAILED);
-				}
-				return EXIT_FAILURE;
+		} else {
+			for (end = start; *end != '\0' && *end != '\''; end++);
+			if (asprintf(&aux, "%s%s'%.*s'", ret, (start == value) ? "" : ",", (int)(end - start), start) == -1) {
+				aux = NULL;
 			}
-			parent = parent->parent;
 		}
+		free(ret);
+		ret = aux;
+	}
+	if (ret != NULL) {
+		if (asprintf(&aux, "%s)", ret) == -1) {
+			aux = NULL;
+		}
+		free(ret);
+		ret = aux;
 	}
 
-	return EXIT_SUCCESS;
+	return (ret);
 }
 
 /**
- * \brief Check edit-config's operation rules.
+ * @brief Get the path of the data node, list instances are identified by the
+ * values of their keys and leaf-list instances by their value.
  *
- * In case of the "create" operation, if the configuration data exists, the
- * "data-exists" error is generated.
- *
- * In case of the "delete" operation, if the configuration data does not exist, the
- * "data-missing" error is generated.
+ * @return Path of the node such as /top/item[id='5']/val, caller is supposed
+ * to free it.
+ */
+static char* edit_changes_path(struct edit_changes* changes, xmlNodePtr node)
+{
+	xmlNodePtr *keynodes = NULL;
+	xmlChar* value;
+	char *path = NULL, *pred = NULL, *aux, *literal;
+	int i;
+
+	if (node == NULL || node->type != XML_ELEMENT_NODE) {
+		return (strdup(""));
+	}
+	if ((path = edit_changes_path(changes, node->parent)) == NULL) {
+		return (NULL);
+	}
+
+	if (is_leaf_list(node, changes->model)) {
+		value = xmlNodeGetContent(node);
+		if ((literal = edit_changes_literal((char*)value)) == NULL || asprintf(&pred, "[.=%s]", literal) == -1) {
+			pred = NULL;
+		}
+		free(literal);
+		xmlFree(value);
+	} else if (changes->keys != NULL && get_keys(changes->keys, node, 0, &keynodes) == EXIT_SUCCESS && keynodes != NULL) {
+		for (i = 0, pred = strdup(""); keynodes[i] != NULL && pred != NULL; i++) {
+			value = xmlNodeGetContent(keynodes[i]);
+			if ((literal = edit_changes_literal((char*)value)) == NULL || asprintf(&aux, "%s[%s=%s]", pred, (char*)keynodes[i]->name, literal) == -1) {
+				aux = NULL;
+			}
+			free(literal);
+			xmlFree(value);
+			free(pred);
+			pred = aux;
+		}
+		free(keynodes);
+	}
+
+	if (asprintf(&aux, "%s/%s%s", path, (char*)node->name, (pred == NULL) ? "" : pred) == -1) {
+		aux = NULL;
+	}
+	free(path);
+	free(pred);
+
+	return (aux);
+}
+
+/**
+ * @brief Append the change of the node to the recorded changes.
  *
- * Operation hierarchy check check_edit_ops_hierarchy() is also applied.
+ * @param[in] changes Recorded changes.
+ * @param[in] op Type of the change.
+ * @param[in] node Changed element, it is copied.
+ * @param[in] after Flag if the node is copied as the new (1) or the old (0) node.
+ * @param[in] target Node to remember for joining the next change.
+ */
+static void edit_changes_add(struct edit_changes* changes, XMLDIFF_OP op, xmlNodePtr node, int after, xmlNodePtr target)
+{
+	struct ncds_change* change;
+
+	if ((change = calloc(1, sizeof(struct ncds_change))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return;
+	}
+	change->op = op;
+	change->path = edit_changes_path(changes, node);
+	if (after) {
+		change->after = xmlCopyNode(node, 1);
+	} else {
+		change->before = xmlCopyNode(node, 1);
+	}
+
+	if (changes->last == NULL) {
+		changes->first = change;
+	} else {
+		changes->last->next = change;
+	}
+	changes->last = change;
+	changes->target = target;
+}
+
+/**
+ * @brief Record the node linked into the document modified by edit_config().
+ */
+static void edit_changes_insert(struct edit_changes* changes, xmlNodePtr node)
+{
+	struct ncds_change* last = changes->last;
+	xmlNodePtr aux;
+
+	if (node->type == XML_TEXT_NODE) {
+		/* new value of the leaf */
+		if ((node = node->parent) == NULL || node->type != XML_ELEMENT_NODE) {
+			return;
+		}
+		if (last != NULL && last->op == XMLDIFF_MOD && last->after == NULL && changes->target == node) {
+			/* the old value was removed just before */
+			last->after = xmlCopyNode(node, 1);
+			changes->target = node;
+		} else {
+			edit_changes_add(changes, XMLDIFF_MOD, node, 1, node);
+		}
+		return;
+	} else if (node->type != XML_ELEMENT_NODE) {
+		return;
+	}
+
+	if (last != NULL && last->op == XMLDIFF_REM && changes->target == node->parent && last->before != NULL &&
+			matching_elements(node, last->before, changes->keys, is_leaf_list(node, changes->model)) == 1) {
+		/* the node was removed and created again (replaced) */
+		last->op = XMLDIFF_MOD;
+		last->after = xmlCopyNode(node, 1);
+		changes->target = node;
+		return;
+	}
+	if (last != NULL && last->op == XMLDIFF_ADD && changes->target != NULL) {
+		for (aux = node->parent; aux != NULL && aux != changes->target; aux = aux->parent);
+		if (aux != NULL) {
+			/* the parent created by the last change is filled */
+			xmlFreeNode(last->after);
+			last->after = xmlCopyNode(aux, 1);
+			return;
+		}
+	}
+
+	edit_changes_add(changes, XMLDIFF_ADD, node, 1, node);
+}
+
+/**
+ * @brief Find the node in the copy of the subtree.
  *
- * \param[in] op Operation type to check (only the "delete" and "create" operation
- * types are valid).
- * \param[in] defop Default edit-config's operation for this edit-config call.
- * \param[in] orig Original configuration document to edit.
- * \param[in] edit XML document covering edit-config's \<config\> element
- * supposed to edit the orig configuration data.
- * \param[in] model XML form (YIN) of the configuration data model appropriate
- * to the given repo.
- * \param[out] err NETCONF error structure.
- * \return On error, non-zero is returned and an err structure is filled. Zero is
- * returned on success.
+ * @param[in] top Root of the original subtree.
+ * @param[in] copy Copy of the subtree made by xmlCopyNode().
+ * @param[in] node Node from the original subtree.
+ * @return Corresponding node from the copy.
  */
-static int check_edit_ops(NC_CHECK_EDIT_OP op, NC_EDIT_DEFOP_TYPE defop, xmlDocPtr orig, xmlDocPtr edit, xmlDocPtr model, struct nc_err **error)
+static xmlNodePtr edit_changes_counterpart(xmlNodePtr top, xmlNodePtr copy, xmlNodePtr node)
 {
-	xmlXPathObjectPtr operation_nodes = NULL;
-	xmlNodePtr node_to_process = NULL, n;
-	keyList keys;
-	xmlChar *defval = NULL, *value = NULL;
-	int i;
+	xmlNodePtr parent, aux;
+
+	if (node == top) {
+		return (copy);
+	}
+	if (node->parent == NULL || (parent = edit_changes_counterpart(top, copy, node->parent)) == NULL) {
+		return (NULL);
+	}
 
-	assert(orig != NULL);
-	assert(edit != NULL);
-	assert(error != NULL);
+	/* the children are copied in the same order */
+	for (aux = node->parent->children, copy = parent->children; aux != node && aux != NULL && copy != NULL; aux = aux->next, copy = copy->next);
 
-	keys = get_keynode_list(model);
+	return (copy);
+}
 
-	operation_nodes = get_operation_elements((NC_EDIT_OP_TYPE)op, edit);
-	if (operation_nodes == NULL) {
-		if (error != NULL) {
-			*error = nc_err_new(NC_ERR_OP_FAILED);
+/**
+ * @brief Drop the node created by the edit (e.g. a trimmed default value)
+ * from the recorded changes, the node was never in the datastore.
+ *
+ * @return 1 if the node was created by the edit, 0 otherwise.
+ */
+static int edit_changes_uncreate(struct edit_changes* changes, xmlNodePtr node)
+{
+	struct ncds_change *change, *prev = NULL, *found = NULL, *found_prev = NULL;
+	xmlNodePtr top, copy;
+	char *path, *aux;
+	size_t len = 0;
+
+	if (node->type == XML_TEXT_NODE) {
+		/* value of the created leaf */
+		top = node->parent;
+	} else {
+		top = node;
+	}
+	if (top == NULL || top->type != XML_ELEMENT_NODE || (path = edit_changes_path(changes, top)) == NULL) {
+		return (0);
+	}
+
+	/* the last change creating the node or its ancestor */
+	for (change = changes->first; change != NULL; prev = change, change = change->next) {
+		if ((change->op != XMLDIFF_ADD && change->op != XMLDIFF_MOD) || change->after == NULL || change->path == NULL) {
+			continue;
 		}
-		if (keys != NULL) {
-			keyListFree(keys);
+		len = strlen(change->path);
+		if (strncmp(path, change->path, len) == 0 && (path[len] == '/' || (path[len] == '\0' && top != node) ||
+				(path[len] == '\0' && change->op == XMLDIFF_ADD))) {
+			found = change;
+			found_prev = prev;
 		}
-		return EXIT_FAILURE;
+	}
+	if (found == NULL) {
+		free(path);
+		return (0);
 	}
 
-	if (xmlXPathNodeSetIsEmpty(operation_nodes->nodesetval)) {
-		xmlXPathFreeObject(operation_nodes);
-		if (keys != NULL) {
-			keyListFree(keys);
+	if (found->op == XMLDIFF_ADD && top == node && path[strlen(found->path)] == '\0') {
+		/* the created node itself is removed */
+		if (found_prev == NULL) {
+			changes->first = found->next;
+		} else {
+			found_prev->next = found->next;
+		}
+		if (changes->last == found) {
+			changes->last = found_prev;
+			changes->target = NULL;
 		}
-		return EXIT_SUCCESS;
+		found->next = NULL;
+		ncds_changes_free(found);
+		free(path);
+		return (1);
 	}
+	free(path);
 
-	*error = NULL;
-	for (i = 0; i < operation_nodes->nodesetval->nodeNr; i++) {
-		node_to_process = operation_nodes->nodesetval->nodeTab[i];
+	/* find the created ancestor and copy it without the node */
+	for (top = node->parent; top != NULL; top = top->parent) {
+		if ((aux = edit_changes_path(changes, top)) != NULL && strcmp(aux, found->path) == 0) {
+			free(aux);
+			break;
+		}
+		free(aux);
+	}
+	if (top == NULL) {
+		return (0);
+	}
+	copy = xmlCopyNode(top, 1);
+	if ((node = edit_changes_counterpart(top, copy, node)) != NULL) {
+		xmlUnlinkNode(node);
+		xmlFreeNode(node);
+	}
+	xmlFreeNode(found->after);
+	found->after = copy;
 
-		if (check_edit_ops_hierarchy(node_to_process, defop, error) != EXIT_SUCCESS) {
-			xmlXPathFreeObject(operation_nodes);
-			if (keys != NULL) {
-				keyListFree(keys);
-			}
-			return EXIT_FAILURE;
+	return (1);
+}
+
+/**
+ * @brief Record the node to be unlinked from the document modified by
+ * edit_config().
+ */
+static void edit_changes_remove(struct edit_changes* changes, xmlNodePtr node)
+{
+	if (edit_changes_uncreate(changes, node)) {
+		return;
+	}
+
+	if (node->type == XML_TEXT_NODE) {
+		/* old value of the leaf */
+		if ((node = node->parent) == NULL || node->type != XML_ELEMENT_NODE) {
+			return;
 		}
+		edit_changes_add(changes, XMLDIFF_MOD, node, 0, node);
+	} else if (node->type == XML_ELEMENT_NODE) {
+		edit_changes_add(changes, XMLDIFF_REM, node, 0, node->parent);
+	}
+}
 
-		/* \todo namespace handlings */
-		n = find_element_equiv(orig, node_to_process, model, keys);
-		if (op == NC_CHECK_EDIT_DELETE && n == NULL) {
-			if (ncdflt_get_basic_mode() == NCWD_MODE_ALL) {
-				/* A valid 'delete' operation attribute for a
-				 * data node that contains its schema default
-				 * value MUST succeed, even though the data node
-				 * is immediately replaced by the server with
-				 * the default value.
-				 */
-				defval = get_default_value(node_to_process, model);
-				if (defval == NULL) {
-					/* no default value for this node */
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_MISSING);
-					}
-					break;
-				}
-				value = xmlNodeGetContent(node_to_process);
-				if (value == NULL) {
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_MISSING);
-					}
-					break;
-				}
-				if (xmlStrcmp(defval, value) != 0) {
-					/* node do not contain default value */
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_MISSING);
-					}
-					break;
-				} else {
-					/* remove delete operation - it is valid
-					 * but there is no reason to really
-					 * perform it
-					 */
-					xmlUnlinkNode(node_to_process);
-					xmlFreeNode(node_to_process);
-				}
-				xmlFree(defval);
-				defval = NULL;
-				xmlFree(value);
-				value = NULL;
-			} else {
-				if (error != NULL) {
-					*error = nc_err_new(NC_ERR_DATA_MISSING);
-				}
-				break;
-			}
-		} else if (op == NC_CHECK_EDIT_CREATE && n != NULL) {
-			if (ncdflt_get_basic_mode() == NCWD_MODE_TRIM) {
-				/* A valid 'create' operation attribute for a
-				 * data node that has a schema default value
-				 * defined MUST succeed.
-				 */
-				defval = get_default_value(node_to_process, model);
-				if (defval == NULL) {
-					/* no default value for this node */
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_EXISTS);
-					}
-					break;
-				}
-				value = xmlNodeGetContent(node_to_process);
-				if (value == NULL) {
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_EXISTS);
-					}
-					break;
-				}
-				if (xmlStrcmp(defval, value) != 0) {
-					/* node do not contain default value */
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_MISSING);
-					}
-					break;
-				} else {
-					/* remove old node in configuration to
-					 * allow recreate it by the new one with
-					 * the default value
-					 */
-					xmlUnlinkNode(n);
-					xmlFreeNode(n);
-				}
-				xmlFree(defval);
-				defval = NULL;
-				xmlFree(value);
-				value = NULL;
+/**
+ * @brief Record the list instance moved in the document modified by
+ * edit_config().
+ */
+static void edit_changes_move(xmlNodePtr node)
+{
+	struct edit_index* eidx;
 
-			} else {
-				if (error != NULL) {
-					*error = nc_err_new(NC_ERR_DATA_EXISTS);
-				}
-				break;
+	if (node == NULL || node->doc == NULL || (eidx = (struct edit_index*)(node->doc->_private)) == NULL || eidx->changes == NULL) {
+		return;
+	}
+
+	edit_changes_add(eidx->changes, XMLDIFF_REORDER, node, 1, NULL);
+}
+
+/**
+ * @brief Update the index after the node was linked into the document
+ * modified by edit_config().
+ */
+static void edit_index_insert(xmlNodePtr node)
+{
+	struct edit_index* eidx;
+	struct sibling_index* sidx;
+
+	if (node == NULL || node->doc == NULL || (eidx = (struct edit_index*)(node->doc->_private)) == NULL) {
+		return;
+	}
+	if (eidx->changes != NULL) {
+		edit_changes_insert(eidx->changes, node);
+	}
+	if (xmlHashSize(eidx->parents) <= 0) {
+		/* nothing indexed yet */
+		return;
+	}
+
+	edit_index_changed(eidx, node);
+	if (node->parent != NULL && (sidx = edit_index_lookup(eidx, node->parent)) != NULL) {
+		sibling_index_add(sidx, node);
+	}
+}
+
+static void edit_index_drop_subtree(struct edit_index* eidx, xmlNodePtr node)
+{
+	xmlNodePtr child;
+
+	if (node->type != XML_ELEMENT_NODE || node->children == NULL) {
+		return;
+	}
+
+	edit_index_drop(eidx, node);
+	for (child = node->children; child != NULL; child = child->next) {
+		edit_index_drop_subtree(eidx, child);
+	}
+}
+
+void edit_index_remove(xmlNodePtr node)
+{
+	struct edit_index* eidx;
+	struct sibling_index* sidx;
+	char* key;
+
+	if (node == NULL || node->doc == NULL || (eidx = (struct edit_index*)(node->doc->_private)) == NULL) {
+		return;
+	}
+	if (eidx->changes != NULL) {
+		edit_changes_remove(eidx->changes, node);
+	}
+	if (xmlHashSize(eidx->parents) <= 0) {
+		/* nothing indexed yet */
+		return;
+	}
+
+	edit_index_changed(eidx, node);
+	if (node->type == XML_ELEMENT_NODE && node->parent != NULL &&
+			(sidx = edit_index_lookup(eidx, node->parent)) != NULL && sidx->nodes != NULL) {
+		if (edit_index_key(sibling_index_def(sidx, node->name), node, &key) == 0) {
+			if (xmlHashLookup2(sidx->nodes, node->name, BAD_CAST ((key == NULL) ? "" : key)) == node) {
+				xmlHashRemoveEntry2(sidx->nodes, node->name, BAD_CAST ((key == NULL) ? "" : key), NULL);
 			}
+			free(key);
 		}
 	}
-	xmlXPathFreeObject(operation_nodes);
-	if (defval != NULL) {
-		xmlFree(defval);
-	}
-	if (value != NULL) {
-		xmlFree(value);
+
+	/* the addresses of the freed nodes can be reused */
+	edit_index_drop_subtree(eidx, node);
+}
+
+/**
+ * @brief Start indexing the document modified by edit_config(). Until the
+ * index is freed by edit_index_free(), all the changes of the document must
+ * be announced by edit_index_insert() and edit_index_remove().
+ *
+ * @param[in] doc Document to modify.
+ * @param[in] model Configuration data model, the data are indexed only if it
+ * is compiled.
+ * @param[in] changes Structure to record the changes into, NULL if they are
+ * not recorded.
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the document is neither indexed nor
+ * its changes are recorded.
+ */
+static int edit_index_new(xmlDocPtr doc, xmlDocPtr model, struct edit_changes* changes)
+{
+	struct edit_index* eidx;
+
+	if (model != NULL && model->_private == NULL) {
+		model = NULL;
 	}
-	if (keys != NULL) {
-		keyListFree(keys);
+	if (doc == NULL || doc->_private != NULL || (model == NULL && changes == NULL)) {
+		return (EXIT_FAILURE);
 	}
 
-	if (*error != NULL) {
+	if ((eidx = malloc(sizeof(struct edit_index))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
 		return (EXIT_FAILURE);
+	}
+	if ((eidx->parents = xmlHashCreate(0)) == NULL) {
+		free(eidx);
+		return (EXIT_FAILURE);
+	}
+	eidx->model = model;
+	eidx->changes = changes;
+	doc->_private = eidx;
+
+	return (EXIT_SUCCESS);
+}
+
+static void edit_index_free(xmlDocPtr doc)
+{
+	struct edit_index* eidx = (struct edit_index*)(doc->_private);
+
+	doc->_private = NULL;
+	xmlHashFree(eidx->parents, sibling_index_free);
+	free(eidx);
+}
+
+/**
+ * \brief Find an equivalent of the given edit node on orig_doc document.
+ *
+ * \param[in] orig_doc Original configuration document to edit.
+ * \param[in] edit Element from the edit-config's \<config\>. Its equivalent in
+ *                 orig_doc should be found.
+ * \param[in] keys List of the key elements from the configuration data model.
+ * \return Found equivalent element, NULL if no such element exists.
+ */
+xmlNodePtr find_element_equiv(xmlDocPtr orig_doc, xmlNodePtr edit, xmlDocPtr model, keyList keys)
+{
+	xmlNodePtr orig_parent, node, model_def;
+	struct model_index* idx;
+	int leaf = 0;
+
+	if (edit == NULL || orig_doc == NULL) {
+		return (NULL);
+	}
+
+	/* go recursively to the root */
+	if (edit->parent->type != XML_DOCUMENT_NODE) {
+		orig_parent = find_element_equiv(orig_doc, edit->parent, model, keys);
+	} else {
+		if (orig_doc->children == NULL) {
+			orig_parent = NULL;
+		} else {
+			orig_parent = orig_doc->children->parent;
+		}
+	}
+	if (orig_parent == NULL) {
+		return (NULL);
+	}
+
+	if (model != NULL && model->_private != NULL) {
+		idx = find_element_index(edit, model);
+		leaf = (idx != NULL && idx->type == MODEL_NODE_LEAFLIST);
 	} else {
-		return EXIT_SUCCESS;
+		model_def = find_element_model(edit, model);
+		if (model_def != NULL && xmlStrcmp(model_def->name, BAD_CAST "leaf-list") == 0) {
+			/* check also children text element when checking elements matching */
+			leaf = 1;
+		}
 	}
+
+	/* element check, large sibling sets are indexed */
+	if (edit_index_find(orig_parent, edit, keys, leaf, &node) == EXIT_SUCCESS) {
+		return (node);
+	}
+	node = orig_parent->children;
+	while (node != NULL) {
+		/* compare edit and node */
+		if (matching_elements(edit, node, keys, leaf) == 0) {
+			/* non matching nodes */
+			node = node->next;
+			continue;
+		} else {
+			/* matching nodes found */
+			return (node);
+		}
+	}
+
+	/* no corresponding node found */
+	return (NULL);
 }
 
 /**
@@ -1007,6 +1812,7 @@ static int edit_delete(xmlNodePtr node)
 
 	VERB("Deleting the node %s (%s:%d)", (char*)node->name, __FILE__, __LINE__);
 	if (node != NULL) {
+		edit_index_remove(node);
 		xmlUnlinkNode(node);
 		xmlFreeNode(node);
 	}
@@ -1483,6 +2289,8 @@ static void nc_clear_namespaces(xmlNodePtr node)
  */
 static int edit_create_routine(xmlNodePtr parent, xmlNodePtr edit_node)
 {
+	xmlNodePtr created;
+
 	if (parent == NULL || edit_node == NULL) {
 		ERROR("%s: invalid input parameter.", __func__);
 		return (EXIT_FAILURE);
@@ -1492,17 +2300,18 @@ static int edit_create_routine(xmlNodePtr parent, xmlNodePtr edit_node)
 	VERB("Creating the node %s (%s:%d)", (char*)edit_node->name, __FILE__, __LINE__);
 	if (parent->type == XML_DOCUMENT_NODE) {
 		if (parent->children == NULL) {
-			xmlDocSetRootElement(parent->doc, xmlCopyNode(edit_node, 1));
+			xmlDocSetRootElement(parent->doc, created = xmlCopyNode(edit_node, 1));
 		} else {
 			/* adding root's sibling! */
-			xmlAddChild(parent, xmlCopyNode(edit_node, 1));
+			created = xmlAddChild(parent, xmlCopyNode(edit_node, 1));
 		}
 	} else {
-		if (xmlAddChild(parent, xmlCopyNode(edit_node, 1)) == NULL) {
+		if ((created = xmlAddChild(parent, xmlCopyNode(edit_node, 1))) == NULL) {
 			ERROR("%s: Creating new node (%s) failed (%s:%d)", __func__, (char*)(edit_node->name), __FILE__, __LINE__);
 			return (EXIT_FAILURE);
 		}
 	}
+	edit_index_insert(created);
 
 	return (EXIT_SUCCESS);
 }
@@ -1522,7 +2331,7 @@ static int edit_create_lists(xmlNodePtr parent, xmlNodePtr edit_node, xmlDocPtr
 		*error = NULL;
 	}
 
-	if ((list_type = is_user_ordered_list(find_element_model(edit_node, model))) == 0) {
+	if ((list_type = model_user_ordered(edit_node, model)) == 0) {
 		return (EXIT_FAILURE);
 	}
 	/*
@@ -1544,7 +2353,7 @@ static int edit_create_lists(xmlNodePtr parent, xmlNodePtr edit_node, xmlDocPtr
 			}
 		} else {
 			/* check if the parent is list */
-			if (is_user_ordered_list(find_element_model(parent, model)) != 0) {
+			if (model_user_ordered(parent, model) != 0) {
 				/* we are in the list, so the first nodes must be the keys and
 				 * we have to place this new node only as the first instance of
 				 * it, not as the first child node of its parent
@@ -1618,6 +2427,7 @@ static int edit_create_lists(xmlNodePtr parent, xmlNodePtr edit_node, xmlDocPtr
 	}
 
 	xmlFree(insert);
+	edit_index_insert(created);
 	nc_clear_namespaces(created);
 
 	return (EXIT_SUCCESS);
@@ -1642,7 +2452,7 @@ static int edit_choice_clean(xmlNodePtr parent, xmlNodePtr except_node, xmlDocPt
 	char* msg = NULL;
 	int r;
 
-	if (except_node == NULL || (choice_branch = is_partof_choice(find_element_model(except_node, model))) == NULL) {
+	if (except_node == NULL || (choice_branch = model_choice_branch(except_node, model)) == NULL) {
 		/* ignore request if the except_node is not a part of choice statement */
 		return (EXIT_SUCCESS);
 	}
@@ -1653,7 +2463,7 @@ static int edit_choice_clean(xmlNodePtr parent, xmlNodePtr except_node, xmlDocPt
 			continue;
 		}
 
-		aux = is_partof_choice(find_element_model(child, model));
+		aux = model_choice_branch(child, model);
 		if (aux == NULL) {
 			child = child->next;
 			continue;
@@ -1776,6 +2586,7 @@ static xmlNodePtr edit_create_recursively(xmlDocPtr orig_doc, xmlNodePtr edit_no
 				xmlSetNs(retval, ns_aux);
 			}
 			xmlDocSetRootElement(orig_doc, retval);
+			edit_index_insert(retval);
 			return (retval);
 		}
 
@@ -1785,6 +2596,7 @@ static xmlNodePtr edit_create_recursively(xmlDocPtr orig_doc, xmlNodePtr edit_no
 		}
 		VERB("Creating the parent %s (%s:%d)", (char*)edit_node->name, __FILE__, __LINE__);
 		retval = xmlAddChild(parent, xmlCopyNode(edit_node, 0));
+		edit_index_insert(retval);
 		if (edit_node->ns && parent->ns && xmlStrcmp(edit_node->ns->href, parent->ns->href) == 0) {
 			xmlSetNs(retval, parent->ns);
 		} else if (edit_node->ns) {
@@ -1807,7 +2619,7 @@ static xmlNodePtr edit_create_recursively(xmlDocPtr orig_doc, xmlNodePtr edit_no
  */
 static int edit_create(xmlDocPtr orig_doc, xmlNodePtr edit_node, NC_EDIT_DEFOP_TYPE defop, xmlDocPtr model, keyList keys, const struct nacm_rpc* nacm, struct nc_err** error)
 {
-	xmlNodePtr parent = NULL, model_node;
+	xmlNodePtr parent = NULL;
 	int r;
 	char *msg = NULL;
 
@@ -1849,12 +2661,11 @@ static int edit_create(xmlDocPtr orig_doc, xmlNodePtr edit_node, NC_EDIT_DEFOP_T
 	nc_clear_namespaces(edit_node);
 
 	/* handle user-ordered lists */
-	model_node = find_element_model(edit_node, model);
-	if (is_user_ordered_list(model_node) != 0) {
+	if (model_user_ordered(edit_node, model) != 0) {
 		if (edit_create_lists(parent, edit_node, model, keys, error) == EXIT_FAILURE) {
 			return (EXIT_FAILURE);
 		}
-	} else if (is_partof_choice(model_node) != NULL) {
+	} else if (model_choice_branch(edit_node, model) != NULL) {
 		if (edit_create_choice(parent, edit_node, model, nacm, error) == EXIT_FAILURE) {
 			return (EXIT_FAILURE);
 		}
@@ -1983,6 +2794,7 @@ static int edit_replace(xmlDocPtr orig_doc, xmlNodePtr edit_node, NC_EDIT_DEFOP_
 		 * "moving" of the instance of the list/leaf-list using YANG's insert
 		 * attribute
 		 */
+		edit_index_remove(old);
 		xmlUnlinkNode(old);
 		xmlFreeNode(old);
 		return edit_create(orig_doc, edit_node, defop, model, keys, nacm, error);
@@ -2003,7 +2815,7 @@ static int edit_merge_lists(xmlNodePtr merged_node, xmlNodePtr edit_node, xmlDoc
 	char* insert;
 
 	/* if this is a list/leaf-list, moving using insert attribute can be required */
-	if ((list_type = is_user_ordered_list(find_element_model(merged_node, model))) != 0) {
+	if ((list_type = model_user_ordered(merged_node, model)) != 0) {
 		/* get the insert attribute and remove it from the merged node if already placed in */
 		if ((insert = (char*)xmlGetNsProp(edit_node, BAD_CAST "insert", BAD_CAST NC_NS_YANG)) != NULL) {
 			xmlRemoveProp(xmlHasNsProp(merged_node, BAD_CAST "insert", BAD_CAST NC_NS_YANG));
@@ -2017,12 +2829,13 @@ static int edit_merge_lists(xmlNodePtr merged_node, xmlNodePtr edit_node, xmlDoc
 				if (merged_node->next != NULL) {
 					xmlUnlinkNode(merged_node);
 					xmlAddChild(parent, merged_node);
+					edit_changes_move(merged_node);
 				}
 			} else if (strcmp(insert, "first") == 0) {
 				/* move it to the beginning of the children list */
 				if (merged_node->prev != NULL) {
 					xmlUnlinkNode(merged_node);
-					if (is_user_ordered_list(find_element_model(parent, model)) != 0) {
+					if (model_user_ordered(parent, model) != 0) {
 						/* we are in the list, so the first nodes must be the keys and
 						 * we have to place this new node only as the first instance of
 						 * it, not as the first child node of its parent
@@ -2045,6 +2858,7 @@ static int edit_merge_lists(xmlNodePtr merged_node, xmlNodePtr edit_node, xmlDoc
 						/* it is not a list, so simply place it as the first child */
 						xmlAddPrevSibling(parent->children, merged_node);
 					}
+					edit_changes_move(merged_node);
 				}
 			} else {
 				/* check and remembre the operation to avoid code duplication */
@@ -2083,6 +2897,7 @@ static int edit_merge_lists(xmlNodePtr merged_node, xmlNodePtr edit_node, xmlDoc
 							xmlUnlinkNode(merged_node);
 							xmlAddNextSibling(refnode, merged_node);
 						} /* else nonsense */
+						edit_changes_move(merged_node);
 					} /* else we are referencing the same node as being merged */
 				}
 			}
@@ -2097,6 +2912,15 @@ static int edit_merge_lists(xmlNodePtr merged_node, xmlNodePtr edit_node, xmlDoc
 static xmlNodePtr is_list(xmlNodePtr node, xmlDocPtr model)
 {
 	xmlNodePtr model_node;
+	struct model_index* idx;
+
+	if (model != NULL && model->_private != NULL) {
+		if ((idx = find_element_index(node, model)) == NULL) {
+			WARN("unknown element %s!", (char* )(node->name));
+			return (NULL);
+		}
+		return ((idx->type == MODEL_NODE_LIST) ? idx->def : NULL);
+	}
 
 	model_node = find_element_model(node, model);
 	if (model_node == NULL) {
@@ -2112,6 +2936,15 @@ static xmlNodePtr is_list(xmlNodePtr node, xmlDocPtr model)
 static int is_leaf_list(xmlNodePtr node, xmlDocPtr model)
 {
 	xmlNodePtr model_node;
+	struct model_index* idx;
+
+	if (model != NULL && model->_private != NULL) {
+		if ((idx = find_element_index(node, model)) == NULL) {
+			WARN("unknown element %s!", (char* )(node->name));
+			return (0);
+		}
+		return (idx->type == MODEL_NODE_LEAFLIST);
+	}
 
 	model_node = find_element_model(node, model);
 	if (model_node == NULL) {
@@ -2128,7 +2961,7 @@ static int edit_merge_recursively(xmlNodePtr orig_node, xmlNodePtr edit_node, NC
 {
 	xmlNodePtr children, aux, next, nextchild, parent;
 	int r, access, duplicates;
-	int leaf_list;
+	int leaf_list, unique;
 	char *msg = NULL;
 
 	/* process leaf text nodes - even if we are merging, leaf text nodes are
@@ -2174,11 +3007,13 @@ static int edit_merge_recursively(xmlNodePtr orig_node, xmlNodePtr edit_node, NC
 			}
 
 			if (access == NACM_ACCESS_UPDATE) {
+				edit_index_remove(orig_node);
 				if (xmlReplaceNode(orig_node, aux = xmlCopyNode(edit_node, 1)) == NULL) {
 					ERROR("Replacing text nodes when merging failed (%s:%d)", __FILE__, __LINE__);
 					return EXIT_FAILURE;
 				}
 				xmlFreeNode(orig_node);
+				edit_index_insert(aux);
 				nc_clear_namespaces(aux);
 			} else { /* access == NACM_ACCESS_CREATE */
 				duplicates = 0;
@@ -2199,6 +3034,7 @@ static int edit_merge_recursively(xmlNodePtr orig_node, xmlNodePtr edit_node, NC
 						ERROR("Adding leaf-list node when merging failed (%s:%d)", __FILE__, __LINE__);
 						return EXIT_FAILURE;
 					}
+					edit_index_insert(aux);
 					nc_clear_namespaces(aux);
 				}
 			}
@@ -2207,6 +3043,8 @@ static int edit_merge_recursively(xmlNodePtr orig_node, xmlNodePtr edit_node, NC
 
 	children = edit_node->children;
 	while (children != NULL) {
+		unique = 0;
+
 		/* skip checks if the node is text */
 		if (children->type == XML_TEXT_NODE) {
 			/* find text element to children */
@@ -2228,9 +3066,14 @@ static int edit_merge_recursively(xmlNodePtr orig_node, xmlNodePtr edit_node, NC
 
 			/* find matching element to children */
 			leaf_list = is_leaf_list(children, model);
-			aux = orig_node->children;
-			while (aux != NULL && matching_elements(children, aux, keys, leaf_list) == 0) {
-				aux = aux->next;
+			if (edit_index_find(orig_node, children, keys, leaf_list, &aux) == EXIT_SUCCESS) {
+				/* the indexed siblings are unique */
+				unique = 1;
+			} else {
+				aux = orig_node->children;
+				while (aux != NULL && matching_elements(children, aux, keys, leaf_list) == 0) {
+					aux = aux->next;
+				}
 			}
 		}
 
@@ -2300,6 +3143,10 @@ static int edit_merge_recursively(xmlNodePtr orig_node, xmlNodePtr edit_node, NC
 						if (edit_choice_clean(parent, children, model, nacm, error) == EXIT_FAILURE) {
 							return (EXIT_FAILURE);
 						}
+						if (unique) {
+							/* there is no other matching sibling */
+							next = NULL;
+						}
 					}
 					aux = next;
 				}
@@ -2383,6 +3230,7 @@ int edit_merge(xmlDocPtr orig_doc, xmlNodePtr edit_node, NC_EDIT_DEFOP_TYPE defo
 				ERROR("Adding missing nodes when merging failed (%s:%d)", __FILE__, __LINE__);
 				return EXIT_FAILURE;
 			}
+			edit_index_insert(aux);
 		} else {
 			/* go recursive */
 			VERB("Merging the node %s (%s:%d)", (char*)children->name, __FILE__, __LINE__);
@@ -2395,355 +3243,441 @@ int edit_merge(xmlDocPtr orig_doc, xmlNodePtr edit_node, NC_EDIT_DEFOP_TYPE defo
 			}
 		}
 
-		if (edit_choice_clean(aux->parent, children, model, nacm, error) == EXIT_FAILURE) {
-			return (EXIT_FAILURE);
-		}
+		if (edit_choice_clean(aux->parent, children, model, nacm, error) == EXIT_FAILURE) {
+			return (EXIT_FAILURE);
+		}
+
+		children = children->next;
+	}
+	/* remove the node from the edit document */
+	edit_delete(edit_node);
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief State of the single pass of edit_operations() over the edit-config's
+ * \<config\>.
+ */
+struct edit_pass {
+	/**
+	 * @brief Original configuration document to edit
+	 */
+	xmlDocPtr orig;
+	/**
+	 * @brief Configuration data model (YIN format) and its key statements
+	 */
+	xmlDocPtr model;
+	keyList keys;
+	NC_EDIT_DEFOP_TYPE defop;
+	const struct nacm_rpc* nacm;
+	struct nc_err** error;
+};
+
+/**
+ * @brief Check that all the keys of the list instance are present.
+ *
+ * @param[in] pass State of the edit_operations() pass.
+ * @param[in] node Element from the edit-config's \<config\>.
+ * @return EXIT_SUCCESS or EXIT_FAILURE with the "missing-element" error.
+ */
+static int check_list_keys(struct edit_pass* pass, xmlNodePtr node)
+{
+	xmlNodePtr listdef, child;
+	xmlNodePtr *keys = NULL;
+	struct model_index* idx;
+	int i, ret = EXIT_SUCCESS;
+
+	if (pass->model != NULL && pass->model->_private != NULL) {
+		/* the keys are compiled with the model */
+		if ((idx = find_element_index(node, pass->model)) == NULL) {
+			WARN("unknown element %s!", (char* )(node->name));
+		} else if (idx->type == MODEL_NODE_LIST) {
+			for (i = 0; i < idx->keys_count; i++) {
+				for (child = node->children; child != NULL && xmlStrcmp(child->name, idx->keys[i]) != 0; child = child->next);
+				if (child == NULL) {
+					ret = EXIT_FAILURE;
+					break;
+				}
+			}
+		}
+	} else if (pass->keys != NULL && (listdef = is_list(node, pass->model)) != NULL) {
+		for (i = 0; i < pass->keys->nodesetval->nodeNr; i++) {
+			if (pass->keys->nodesetval->nodeTab[i]->parent == listdef) {
+				break;
+			}
+		}
+
+		/* else list has no keys */
+		if (i < pass->keys->nodesetval->nodeNr) {
+			if (find_key_elems(pass->keys->nodesetval->nodeTab[i], node, 1, &keys)) {
+				ret = EXIT_FAILURE;
+			}
+			free(keys);
+		}
+	}
+
+	if (ret && pass->error != NULL) {
+		*(pass->error) = nc_err_new(NC_ERR_MISSING_ELEM);
+		nc_err_set(*(pass->error), NC_ERR_PARAM_INFO_BADELEM, (char*)node->name);
+		nc_err_set(*(pass->error), NC_ERR_PARAM_MSG, "A list key is missing.");
+	}
+
+	return (ret);
+}
+
+/**
+ * \brief Check edit-config's operation rules for the node.
+ *
+ * In case of the "create" operation, if the configuration data exists, the
+ * "data-exists" error is generated.
+ *
+ * In case of the "delete" operation, if the configuration data does not exist, the
+ * "data-missing" error is generated.
+ *
+ * Both are relaxed for the nodes with the schema default value according to
+ * the with-defaults basic mode.
+ *
+ * \param[in] pass State of the edit_operations() pass.
+ * \param[in] edit Element from the edit-config's \<config\> with the
+ * "delete" or "create" operation.
+ * \param[in] op Operation of the edit node.
+ * \return EXIT_SUCCESS, EXIT_FAILURE with the err structure filled or 2 if
+ * the edit node was valid, but it was removed since there is nothing to do.
+ */
+static int check_edit_op(struct edit_pass* pass, xmlNodePtr edit, NC_EDIT_OP_TYPE op)
+{
+	xmlNodePtr n;
+	xmlChar *defval = NULL, *value = NULL;
+	NC_ERR errtype;
+	int ret = EXIT_FAILURE;
+
+	/* \todo namespace handlings */
+	n = find_element_equiv(pass->orig, edit, pass->model, pass->keys);
+	if (op == NC_EDIT_OP_DELETE && n == NULL) {
+		errtype = NC_ERR_DATA_MISSING;
+		/*
+		 * A valid 'delete' operation attribute for a data node that
+		 * contains its schema default value MUST succeed, even though
+		 * the data node is immediately replaced by the server with the
+		 * default value.
+		 */
+		if (ncdflt_get_basic_mode() != NCWD_MODE_ALL) {
+			goto cleanup;
+		}
+	} else if (op == NC_EDIT_OP_CREATE && n != NULL) {
+		errtype = NC_ERR_DATA_EXISTS;
+		/*
+		 * A valid 'create' operation attribute for a data node that has
+		 * a schema default value defined MUST succeed.
+		 */
+		if (ncdflt_get_basic_mode() != NCWD_MODE_TRIM) {
+			goto cleanup;
+		}
+	} else {
+		return (EXIT_SUCCESS);
+	}
+
+	if ((defval = get_default_value(edit, pass->model)) == NULL ||
+			(value = xmlNodeGetContent(edit)) == NULL) {
+		/* no default value for this node */
+		goto cleanup;
+	}
+	if (xmlStrcmp(defval, value) != 0) {
+		/* node do not contain default value */
+		errtype = NC_ERR_DATA_MISSING;
+		goto cleanup;
+	}
 
-		children = children->next;
+	if (op == NC_EDIT_OP_DELETE) {
+		/* remove delete operation - it is valid but there is no reason to
+		 * really perform it */
+		xmlUnlinkNode(edit);
+		xmlFreeNode(edit);
+		ret = 2;
+	} else {
+		/* remove old node in configuration to allow recreate it by the new
+		 * one with the default value */
+		edit_index_remove(n);
+		xmlUnlinkNode(n);
+		xmlFreeNode(n);
+		ret = EXIT_SUCCESS;
 	}
-	/* remove the node from the edit document */
-	edit_delete(edit_node);
 
-	return EXIT_SUCCESS;
+cleanup:
+	xmlFree(defval);
+	xmlFree(value);
+
+	if (ret == EXIT_FAILURE && pass->error != NULL) {
+		*(pass->error) = nc_err_new(errtype);
+	}
+
+	return (ret);
 }
 
 /**
- * \brief Perform all the edit-config's operations specified in the edit_doc document.
- *
- * \param[in] orig_doc Original configuration document to edit.
- * \param[in] edit_doc XML document covering edit-config's \<config\> element
- *                     supposed to edit orig_doc configuration data.
- * \param[in] defop Default edit-config's operation for this edit-config call.
- * \param[in] model XML form (YIN) of the configuration data model appropriate
- * to the given configuration data.
- * \param[out] err NETCONF error structure.
+ * \brief Perform edit-config's "delete" operation.
  *
- * \return On error, non-zero is returned and err structure is filled. Zero is
- *         returned on success.
+ * \param[in] pass State of the edit_operations() pass.
+ * \param[in] edit_node Node from the edit-config's \<config\> element with
+ * the specified "delete" operation.
+ * \return Zero on success, non-zero otherwise.
  */
-static int edit_operations(xmlDocPtr orig_doc, xmlDocPtr edit_doc, NC_EDIT_DEFOP_TYPE defop, xmlDocPtr model, const struct nacm_rpc* nacm, struct nc_err **error)
+static int edit_delete_op(struct edit_pass* pass, xmlNodePtr edit_node)
 {
-	xmlXPathObjectPtr nodes;
-	int i;
+	xmlNodePtr orig_node;
 	char *msg = NULL;
-	xmlNodePtr orig_node, edit_node;
-	keyList keys;
-
-	keys = get_keynode_list(model);
 
-	if (error != NULL) {
-		*error = NULL;
-	}
-
-	/* default replace */
-	if (defop == NC_EDIT_DEFOP_REPLACE) {
-		/* replace whole document */
-		for (edit_node = edit_doc->children; edit_node != NULL; edit_node = edit_doc->children) {
-			edit_replace(orig_doc, edit_node, defop, model, keys, nacm, error);
+	orig_node = find_element_equiv(pass->orig, edit_node, pass->model, pass->keys);
+	if (orig_node == NULL) {
+		if (pass->error != NULL) {
+			*(pass->error) = nc_err_new(NC_ERR_DATA_MISSING);
 		}
-
-		/* according to RFC 6020 sec. 7.2, default-operation "replace"
-		 * completely replaces data in target datastore, so we are done here
-		 */
-		goto cleanup;
+		return (EXIT_FAILURE);
 	}
-
-	/* delete operations */
-	nodes = get_operation_elements(NC_EDIT_OP_DELETE, edit_doc);
-	if (nodes != NULL) {
-		if (!xmlXPathNodeSetIsEmpty(nodes->nodesetval)) {
-			/* something to delete */
-			for (i = 0; i < nodes->nodesetval->nodeNr; i++) {
-				edit_node = nodes->nodesetval->nodeTab[i];
-				orig_node = find_element_equiv(orig_doc, edit_node, model, keys);
-				if (orig_node == NULL) {
-					xmlXPathFreeObject(nodes);
-					if (error != NULL) {
-						*error = nc_err_new(NC_ERR_DATA_MISSING);
-					}
-					goto error;
-				}
-				for (; orig_node != NULL; orig_node = find_element_equiv(orig_doc, edit_node, model, keys)) {
-					/* NACM */
-					if (nacm_check_data(orig_node, NACM_ACCESS_DELETE, nacm) == NACM_PERMIT) {
-						/* remove the edit node's equivalent from the original document */
-						edit_delete(orig_node);
-					} else {
-						if (error != NULL ) {
-							*error = nc_err_new(NC_ERR_ACCESS_DENIED);
-							if (asprintf(&msg, "deleting \"%s\" data node is not permitted.", (char*) (orig_node->name)) != -1) {
-								nc_err_set(*error, NC_ERR_PARAM_MSG, msg);
-								free(msg);
-							}
-						}
-						xmlXPathFreeObject(nodes);
-						goto error;
-					}
+	for (; orig_node != NULL; orig_node = find_element_equiv(pass->orig, edit_node, pass->model, pass->keys)) {
+		/* NACM */
+		if (nacm_check_data(orig_node, NACM_ACCESS_DELETE, pass->nacm) != NACM_PERMIT) {
+			if (pass->error != NULL) {
+				*(pass->error) = nc_err_new(NC_ERR_ACCESS_DENIED);
+				if (asprintf(&msg, "deleting \"%s\" data node is not permitted.", (char*)(orig_node->name)) != -1) {
+					nc_err_set(*(pass->error), NC_ERR_PARAM_MSG, msg);
+					free(msg);
 				}
-				/* remove the node from the edit document */
-				edit_delete(edit_node);
-				nodes->nodesetval->nodeTab[i] = NULL;
 			}
+			return (EXIT_FAILURE);
 		}
-		xmlXPathFreeObject(nodes);
+		/* remove the edit node's equivalent from the original document */
+		edit_delete(orig_node);
 	}
 
-	/* remove operations */
-	nodes = get_operation_elements(NC_EDIT_OP_REMOVE, edit_doc);
-	if (nodes != NULL) {
-		if (!xmlXPathNodeSetIsEmpty(nodes->nodesetval)) {
-			/* something to remove */
-			for (i = 0; i < nodes->nodesetval->nodeNr; i++) {
-				if (edit_remove(orig_doc, nodes->nodesetval->nodeTab[i], model, keys, nacm, error) != EXIT_SUCCESS) {
-					xmlXPathFreeObject(nodes);
-					goto error;
-				}
-				nodes->nodesetval->nodeTab[i] = NULL;
-			}
-		}
-		xmlXPathFreeObject(nodes);
+	/* remove the node from the edit document */
+	edit_delete(edit_node);
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Process the edit node and its subtree in the document order.
+ *
+ * The effective operation is carried down the tree. The node with its own
+ * operation differing from the effective operation of its parent (and the root
+ * node with the default operation) is the operation point - its descendants
+ * are processed first and then its operation is applied to the rest of its
+ * subtree. Since "create", "replace", "delete" and "remove" apply the whole
+ * subtree, the operations of the descendants of such operation points are only
+ * checked for conflicts and removed.
+ *
+ * @param[in] pass State of the edit_operations() pass.
+ * @param[in] edit Node from the edit-config's \<config\>.
+ * @param[in] supreme Effective operation of the parent, the default operation
+ * for the root.
+ * @param[in] whole Flag if the subtree is applied as a whole by the operation
+ * point of the supreme operation.
+ * @return EXIT_SUCCESS or EXIT_FAILURE with the err structure filled.
+ */
+static int edit_walk(struct edit_pass* pass, xmlNodePtr edit, NC_EDIT_OP_TYPE supreme, int whole)
+{
+	xmlNodePtr child, next;
+	NC_EDIT_OP_TYPE op;
+	int point, r;
+
+	if (edit->type != XML_ELEMENT_NODE) {
+		return (EXIT_SUCCESS);
 	}
 
-	/* replace operations */
-	nodes = get_operation_elements(NC_EDIT_OP_REPLACE, edit_doc);
-	if (nodes != NULL) {
-		if (!xmlXPathNodeSetIsEmpty(nodes->nodesetval)) {
-			/* something to replace */
-			for (i = 0; i < nodes->nodesetval->nodeNr; i++) {
-				if (edit_replace(orig_doc, nodes->nodesetval->nodeTab[i], defop, model, keys, nacm, error) != EXIT_SUCCESS) {
-					xmlXPathFreeObject(nodes);
-					goto error;
-				}
-				nodes->nodesetval->nodeTab[i] = NULL;
-			}
-		}
-		xmlXPathFreeObject(nodes);
+	/* for list instances, all keys must be present */
+	if (check_list_keys(pass, edit) != EXIT_SUCCESS) {
+		return (EXIT_FAILURE);
 	}
 
-	/* create operations */
-	nodes = get_operation_elements(NC_EDIT_OP_CREATE, edit_doc);
-	if (nodes != NULL) {
-		if (!xmlXPathNodeSetIsEmpty(nodes->nodesetval)) {
-			/* something to create */
-			for (i = 0; i < nodes->nodesetval->nodeNr; i++) {
-				if (edit_create(orig_doc, nodes->nodesetval->nodeTab[i], defop, model, keys, nacm, error) != EXIT_SUCCESS) {
-					xmlXPathFreeObject(nodes);
-					goto error;
-				}
-				nodes->nodesetval->nodeTab[i] = NULL;
-			}
-		}
-		xmlXPathFreeObject(nodes);
+	if ((op = get_operation(edit, NC_EDIT_DEFOP_NOTSET, pass->error)) == NC_EDIT_OP_ERROR) {
+		return (EXIT_FAILURE);
 	}
 
-	/* merge operations */
-	nodes = get_operation_elements(NC_EDIT_OP_MERGE, edit_doc);
-	if (nodes != NULL) {
-		if (!xmlXPathNodeSetIsEmpty(nodes->nodesetval)) {
-			/* something to create */
-			for (i = 0; i < nodes->nodesetval->nodeNr; i++) {
-				if (edit_merge(orig_doc, nodes->nodesetval->nodeTab[i], defop, model, keys, nacm, error) != EXIT_SUCCESS) {
-					xmlXPathFreeObject(nodes);
-					goto error;
-				}
-				nodes->nodesetval->nodeTab[i] = NULL;
-			}
+	/*
+	 * In case of the removal ("remove" and "delete") operations, the
+	 * supreme operation (including the default operation) cannot be the
+	 * creation ("create or "replace") operation and vice versa.
+	 */
+	if (((op == NC_EDIT_OP_DELETE || op == NC_EDIT_OP_REMOVE) && (supreme == NC_EDIT_OP_CREATE || supreme == NC_EDIT_OP_REPLACE)) ||
+			((op == NC_EDIT_OP_CREATE || op == NC_EDIT_OP_REPLACE) && (supreme == NC_EDIT_OP_DELETE || supreme == NC_EDIT_OP_REMOVE))) {
+		if (pass->error != NULL) {
+			*(pass->error) = nc_err_new(NC_ERR_OP_FAILED);
 		}
-		xmlXPathFreeObject(nodes);
+		return (EXIT_FAILURE);
 	}
 
-	/* default merge */
-	if (defop == NC_EDIT_DEFOP_MERGE || defop == NC_EDIT_DEFOP_NOTSET) {
-		/* replace whole document */
-		if (edit_doc->children != NULL) {
-			for (edit_node = edit_doc->children; edit_node != NULL; edit_node = edit_doc->children) {
-				if (edit_merge(orig_doc, edit_doc->children, defop, model, keys, nacm, error) != EXIT_SUCCESS) {
-					goto error;
-				}
-			}
+	if (op == NC_EDIT_OP_CREATE || op == NC_EDIT_OP_DELETE) {
+		if ((r = check_edit_op(pass, edit, op)) == 2) {
+			/* nothing to do with the node */
+			return (EXIT_SUCCESS);
+		} else if (r != EXIT_SUCCESS) {
+			return (EXIT_FAILURE);
 		}
 	}
 
-cleanup:
-
-	if (keys != NULL) {
-		keyListFree(keys);
+	if (whole || op == NC_EDIT_OP_NOTSET || op == supreme) {
+		if (op != NC_EDIT_OP_NOTSET) {
+			/* operation duplicity or operation inside the subtree of the
+			 * supreme operation point -> remove subordinate operation */
+			xmlRemoveProp(xmlHasNsProp(edit, BAD_CAST NC_EDIT_ATTR_OP, BAD_CAST NC_NS_BASE));
+			nc_clear_namespaces(edit);
+		}
+		/* the root with the default operation is the operation point */
+		point = (!whole && edit->parent->type == XML_DOCUMENT_NODE && supreme != NC_EDIT_OP_NOTSET);
+		op = supreme;
+	} else {
+		point = 1;
 	}
 
-	return EXIT_SUCCESS;
-
-error:
-
-	if (keys != NULL ) {
-		keyListFree(keys);
+	/* descendants first, the applied edit nodes are removed from the edit document */
+	for (child = edit->children; child != NULL; child = next) {
+		next = child->next;
+		if (edit_walk(pass, child, op, whole || (point && op != NC_EDIT_OP_MERGE)) != EXIT_SUCCESS) {
+			return (EXIT_FAILURE);
+		}
 	}
 
-	if (error != NULL && *error == NULL) {
-		*error = nc_err_new(NC_ERR_OP_FAILED);
+	if (!point) {
+		return (EXIT_SUCCESS);
 	}
 
-	return EXIT_FAILURE;
+	switch (op) {
+	case NC_EDIT_OP_MERGE:
+		return (edit_merge(pass->orig, edit, pass->defop, pass->model, pass->keys, pass->nacm, pass->error));
+	case NC_EDIT_OP_REPLACE:
+		return (edit_replace(pass->orig, edit, pass->defop, pass->model, pass->keys, pass->nacm, pass->error));
+	case NC_EDIT_OP_CREATE:
+		return (edit_create(pass->orig, edit, pass->defop, pass->model, pass->keys, pass->nacm, pass->error));
+	case NC_EDIT_OP_DELETE:
+		return (edit_delete_op(pass, edit));
+	case NC_EDIT_OP_REMOVE:
+		return (edit_remove(pass->orig, edit, pass->model, pass->keys, pass->nacm, pass->error));
+	default:
+		ERROR("Unsupported edit operation %d (%s:%d).", op, __FILE__, __LINE__);
+		return (EXIT_FAILURE);
+	}
 }
 
-static int compact_edit_operations_recursively(xmlNodePtr node, NC_EDIT_OP_TYPE supreme_op)
+/**
+ * \brief Perform all the edit-config's operations specified in the edit_doc
+ * document in a single depth-first pass, see edit_walk().
+ *
+ * \param[in] orig_doc Original configuration document to edit.
+ * \param[in] edit_doc XML document covering edit-config's \<config\> element
+ *                     supposed to edit orig_doc configuration data.
+ * \param[in] defop Default edit-config's operation for this edit-config call.
+ * \param[in] model XML form (YIN) of the configuration data model appropriate
+ * to the given configuration data.
+ * \param[out] err NETCONF error structure.
+ *
+ * \return On error, non-zero is returned and err structure is filled. Zero is
+ *         returned on success.
+ */
+static int edit_operations(xmlDocPtr orig_doc, xmlDocPtr edit_doc, NC_EDIT_DEFOP_TYPE defop, xmlDocPtr model, const struct nacm_rpc* nacm, struct nc_err **error)
 {
-	NC_EDIT_OP_TYPE op;
-	xmlNodePtr children;
-	int ret;
+	struct edit_pass pass;
+	xmlNodePtr root, next;
+	NC_EDIT_OP_TYPE supreme;
+	int ret = EXIT_SUCCESS;
 
-	assert(node);
+	if (error != NULL) {
+		*error = NULL;
+	}
 
-	op = get_operation(node, NC_EDIT_DEFOP_NOTSET, NULL);
-	switch ((int)op) {
-	case NC_EDIT_OP_ERROR:
-		return EXIT_FAILURE;
+	/* to start the pass, use defop as root's supreme operation */
+	switch (defop) {
+	case NC_EDIT_DEFOP_NOTSET:
+	case NC_EDIT_DEFOP_MERGE:
+		supreme = NC_EDIT_OP_MERGE;
 		break;
-	case 0:
-		/* no operation defined -> go recursively, but use supreme
-		 * operation, it may be the default operation and in such a case
-		 * remove it */
-		op = supreme_op;
+	case NC_EDIT_DEFOP_REPLACE:
+		/*
+		 * according to RFC 6020 sec. 7.2, default-operation "replace"
+		 * completely replaces data in target datastore
+		 */
+		supreme = NC_EDIT_OP_REPLACE;
+		break;
+	case NC_EDIT_DEFOP_NONE:
+		supreme = NC_EDIT_OP_NOTSET;
 		break;
 	default:
-		/* any operation specified */
-		if (op == supreme_op) {
-			/* operation duplicity -> remove subordinate duplicated operation */
-			/* remove operation attribute */
-			xmlRemoveProp(xmlHasNsProp(node, BAD_CAST NC_EDIT_ATTR_OP, BAD_CAST NC_NS_BASE));
-			nc_clear_namespaces(node);
+		ERROR("Unsupported default edit operation %d (%s:%d).", defop, __FILE__, __LINE__);
+		if (error != NULL) {
+			*error = nc_err_new(NC_ERR_OP_FAILED);
 		}
-		break;
+		return (EXIT_FAILURE);
 	}
 
-	/* go recursive */
-	for (children = node->children; children != NULL; children = children->next) {
-		ret = compact_edit_operations_recursively(children, op);
-		if (ret == EXIT_FAILURE) {
-			return EXIT_FAILURE;
+	pass.orig = orig_doc;
+	pass.model = model;
+	pass.keys = get_keynode_list(model);
+	pass.defop = defop;
+	pass.nacm = nacm;
+	pass.error = error;
+
+	for (root = edit_doc->children; root != NULL; root = next) {
+		next = root->next;
+		if ((ret = edit_walk(&pass, root, supreme, 0)) != EXIT_SUCCESS) {
+			break;
 		}
 	}
-	return EXIT_SUCCESS;
-}
 
-static int compact_edit_operations(xmlDocPtr edit_doc, NC_EDIT_DEFOP_TYPE defop)
-{
-	xmlNodePtr root;
-	NC_EDIT_OP_TYPE op;
+	keyListFree(pass.keys);
 
-	if (edit_doc == NULL) {
-		return EXIT_FAILURE;
+	if (ret != EXIT_SUCCESS && error != NULL && *error == NULL) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
 	}
 
-	/* to start recursive check, use defop as root's supreme operation */
-	for (root = edit_doc->children; root != NULL; root = root->next) {
-		if (root->type != XML_ELEMENT_NODE) {
-			continue;
-		}
-
-		switch (defop) {
-		case NC_EDIT_DEFOP_NOTSET:
-		case NC_EDIT_DEFOP_MERGE:
-			op = NC_EDIT_OP_MERGE;
-			break;
-		case NC_EDIT_DEFOP_REPLACE:
-			op = NC_EDIT_OP_REPLACE;
-			break;
-		case NC_EDIT_DEFOP_NONE:
-			op = NC_EDIT_OP_NOTSET;
-			break;
-		default:
-			return EXIT_FAILURE;
-		}
-
-		if (compact_edit_operations_recursively(root, op) != EXIT_SUCCESS) {
-			return (EXIT_FAILURE);
-		}
-	}
-	return EXIT_SUCCESS;
+	return (ret);
 }
 
-static int check_list_keys(xmlDocPtr edit, xmlDocPtr model, struct nc_err **error)
+/**
+ * \brief Perform edit-config changes according to the given parameters,
+ * common part of edit_config() and edit_config_changes().
+ *
+ * \param[in] changes Structure to record the changes into, NULL if they are
+ * not recorded.
+ */
+static int edit_config_(xmlDocPtr repo, xmlDocPtr edit, struct ncds_ds* ds, NC_EDIT_DEFOP_TYPE defop, const struct nacm_rpc* nacm, struct edit_changes* changes, struct nc_err **error)
 {
-	xmlNodePtr listdef;
-	xmlNodePtr *keys = NULL;
-	xmlNodePtr node, next;
-	keyList modelkeys;
-	int ret = EXIT_SUCCESS;
-	int i;
+	int indexed;
 
-	modelkeys = get_keynode_list(model);
-	if (!modelkeys) {
-		/* no keys in the model */
-		return ret;
+	if (repo == NULL || edit == NULL) {
+		return (EXIT_FAILURE);
 	}
 
-	node = xmlDocGetRootElement(edit);
-	while (node) {
-		if ((listdef = is_list(node, model)) != NULL) {
-			for (i = 0; i < modelkeys->nodesetval->nodeNr; i++) {
-				if (modelkeys->nodesetval->nodeTab[i]->parent == listdef) {
-					break;
-				}
-			}
-
-			if (i < modelkeys->nodesetval->nodeNr) {
-				/* find out if all the keys are present in edit data */
-				if (find_key_elems(modelkeys->nodesetval->nodeTab[i], node, 1, &keys)) {
-					ret = EXIT_FAILURE;
-					goto cleanup;
-				}
-				free(keys);
-				keys = NULL;
-
-			} /* else list has no keys */
-		}
-
-		/* go to the next element to process (depth-first processing) */
-		/* children first */
-		next = node->children;
-		if (next) {
-			/* skip comments and other garbage */
-			while(next && next->type != XML_ELEMENT_NODE) {
-				next = next->next;
-			}
-		}
+	/* index the large lists in the modified data when searched for the first time */
+	indexed = (edit_index_new(repo, ds->ext_model, changes) == EXIT_SUCCESS);
 
-		if (!next) {
-			/* try siblings */
-			next = node->next;
-			while(next && next->type != XML_ELEMENT_NODE) {
-				next = next->next;
-			}
+	/* check and perform operations in a single pass */
+	if (edit_operations(repo, edit, defop, ds->ext_model, nacm, error) != EXIT_SUCCESS) {
+		goto error_cleanup;
+	}
 
-			while(!next) {
-				/* go back through parents */
-				if (node->parent == (xmlNodePtr)node->doc) {
-					/* we are done */
-					goto cleanup;
-				}
-				node = node->parent;
+	/* with defaults capability */
+	if (ncdflt_get_basic_mode() == NCWD_MODE_TRIM) {
+		/* server work in trim basic mode and therefore all default
+		 * values must be removed from the datastore, the removals
+		 * are announced to the index (and the recorded changes).
+		 */
+		ncdflt_default_values(repo, ds->ext_model, NCWD_MODE_TRIM);
+	}
 
-				/* the parent is already checked, so go to its next sibling */
-				next = node->next;
-				while(next && next->type != XML_ELEMENT_NODE) {
-					next = next->next;
-				}
-			}
-		}
-		node = next;
+	if (indexed) {
+		edit_index_free(repo);
 	}
 
-cleanup:
+	return EXIT_SUCCESS;
 
-	keyListFree(modelkeys);
+error_cleanup:
 
-	if (ret && error != NULL) {
-		*error = nc_err_new(NC_ERR_MISSING_ELEM);
-		nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, (char*)node->name);
-		nc_err_set(*error, NC_ERR_PARAM_MSG, "A list key is missing.");
+	if (indexed) {
+		edit_index_free(repo);
 	}
 
-	return ret;
+	return EXIT_FAILURE;
 }
 
 /**
@@ -2762,47 +3696,53 @@ cleanup:
  */
 int edit_config(xmlDocPtr repo, xmlDocPtr edit, struct ncds_ds* ds, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE UNUSED(errop), const struct nacm_rpc* nacm, struct nc_err **error)
 {
-	if (repo == NULL || edit == NULL) {
-		return (EXIT_FAILURE);
-	}
+	return (edit_config_(repo, edit, ds, defop, nacm, NULL, error));
+}
 
-	/* check validity - for list instances, all keys must be present */
-	if (check_list_keys(edit, ds->ext_model, error) != EXIT_SUCCESS) {
-		goto error_cleanup;
-	}
-	/* check operations */
-	if (check_edit_ops(NC_CHECK_EDIT_DELETE, defop, repo, edit, ds->ext_model, error) != EXIT_SUCCESS) {
-		goto error_cleanup;
-	}
-	if (check_edit_ops(NC_CHECK_EDIT_CREATE, defop, repo, edit, ds->ext_model, error) != EXIT_SUCCESS) {
-		goto error_cleanup;
-	}
+int edit_config_changes(xmlDocPtr repo, xmlDocPtr edit, struct ncds_ds* ds, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE UNUSED(errop), const struct nacm_rpc* nacm, int dryrun, struct ncds_change** changes, struct nc_err **error)
+{
+	struct edit_changes record;
+	xmlDocPtr doc, edit_doc;
+	int ret;
 
-	if (compact_edit_operations(edit, defop) != EXIT_SUCCESS) {
-		ERROR("Compacting edit-config operations failed.");
-		if (error != NULL) {
-			*error = nc_err_new(NC_ERR_OP_FAILED);
+	if (repo == NULL || edit == NULL || changes == NULL) {
+		return (EXIT_FAILURE);
+	}
+	*changes = NULL;
+
+	if (dryrun) {
+		/* the changes are applied to copies, the edit is consumed by the
+		 * operations and repo is changed by them */
+		doc = xmlCopyDoc(repo, 1);
+		edit_doc = xmlCopyDoc(edit, 1);
+		if (doc == NULL || edit_doc == NULL) {
+			ERROR("Copying the configuration data failed (%s:%d).", __FILE__, __LINE__);
+			xmlFreeDoc(doc);
+			xmlFreeDoc(edit_doc);
+			if (error != NULL) {
+				*error = nc_err_new(NC_ERR_OP_FAILED);
+			}
+			return (EXIT_FAILURE);
 		}
-		goto error_cleanup;
+	} else {
+		doc = repo;
+		edit_doc = edit;
 	}
 
-	/* perform operations */
-	if (edit_operations(repo, edit, defop, ds->ext_model, nacm, error) != EXIT_SUCCESS) {
-		goto error_cleanup;
-	}
+	memset(&record, 0, sizeof record);
+	record.model = ds->ext_model;
+	record.keys = get_keynode_list(ds->ext_model);
 
-	/* with defaults capability */
-	if (ncdflt_get_basic_mode() == NCWD_MODE_TRIM) {
-		/* server work in trim basic mode and therefore all default
-		 * values must be removed from the datastore.
-		 */
-		ncdflt_default_values(repo, ds->ext_model, NCWD_MODE_TRIM);
-	}
+	ret = edit_config_(doc, edit_doc, ds, defop, nacm, &record, error);
 
-	return EXIT_SUCCESS;
+	keyListFree(record.keys);
+	if (dryrun) {
+		xmlFreeDoc(doc);
+		xmlFreeDoc(edit_doc);
+	}
 
-error_cleanup:
+	/* even on error, the caller gets the changes made before it */
+	*changes = record.first;
 
-	return EXIT_FAILURE;
+	return (ret);
 }
-
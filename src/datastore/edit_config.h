@@ -39,6 +39,7 @@
 
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
+#include <libxml/hash.h>
 
 #include "datastore_internal.h"
 #include "../netconf.h"
@@ -49,10 +50,105 @@
 #define NC_EDIT_CONFIG_H_
 
 typedef xmlXPathObjectPtr keyList;
-#define keyListFree(x) xmlXPathFreeObject((xmlXPathObjectPtr)x)
 
+/**
+ * @brief Get all the key statements from the configuration data model. If the
+ * model is compiled by model_index_build(), the list kept in the index is
+ * returned instead of evaluating the model again.
+ *
+ * @param[in] model Configuration data model (YIN format)
+ * @return List of the key statements, NULL if there is none. Caller is
+ * supposed to release it by keyListFree().
+ */
 keyList get_keynode_list(xmlDocPtr model);
 
+/**
+ * @brief Release the list returned by get_keynode_list(). The list kept in the
+ * index of a compiled model is not freed.
+ *
+ * @param[in] keys List of the key statements
+ */
+void keyListFree(keyList keys);
+
+/**
+ * @brief Kind of the data model statement defining a data node
+ */
+typedef enum {
+	MODEL_NODE_OTHER, /**< any other statement with a name */
+	MODEL_NODE_CONTAINER, /**< container statement */
+	MODEL_NODE_LEAF, /**< leaf statement */
+	MODEL_NODE_LEAFLIST, /**< leaf-list statement */
+	MODEL_NODE_LIST, /**< list statement */
+	MODEL_NODE_ANYXML /**< anyxml statement */
+} MODEL_NODE_TYPE;
+
+/**
+ * @brief Data model (YIN) compiled for resolving the definitions of the data
+ * nodes, see model_index_build(). It is kept in the _private pointer of the
+ * model document.
+ */
+struct model_index {
+	/**
+	 * @brief Definition of the node in the model, the module statement
+	 * in the root of the index
+	 */
+	xmlNodePtr def;
+	/**
+	 * @brief Name of the node, interned in the dictionary
+	 */
+	const xmlChar* name;
+	MODEL_NODE_TYPE type;
+	/**
+	 * @brief 1 for the list, 2 for the leaf-list ordered by user, 0 otherwise
+	 */
+	int user_ordered;
+	/**
+	 * @brief Branch of the choice the node belongs to, NULL if it is not
+	 * a part of any choice
+	 */
+	xmlNodePtr choice;
+	/**
+	 * @brief The default and key statements of the node, NULL if missing
+	 */
+	xmlNodePtr dflt, key;
+	/**
+	 * @brief Names of the list keys, interned in the dictionary
+	 */
+	const xmlChar** keys;
+	int keys_count;
+	/**
+	 * @brief Definitions of the child nodes hashed by their name, NULL if
+	 * there is none
+	 */
+	xmlHashTablePtr children;
+	/**
+	 * @brief Dictionary of all the names in the index, only in the root
+	 */
+	xmlDictPtr dict;
+	/**
+	 * @brief All the key statements of the model returned by
+	 * get_keynode_list(), only in the root
+	 */
+	keyList keynodes;
+};
+
+/**
+ * @brief Compile the data model into the index used by find_element_model()
+ * and the edit-config operations. The model MUST NOT be changed until the
+ * index is freed by model_index_free().
+ *
+ * @param[in] model Configuration data model (YIN format)
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int model_index_build(xmlDocPtr model);
+
+/**
+ * @brief Free the index of the data model built by model_index_build().
+ *
+ * @param[in] model Configuration data model (YIN format)
+ */
+void model_index_free(xmlDocPtr model);
+
 /**
  * \brief Compare 2 elements and decide if they are equal for NETCONF.
  *
@@ -104,6 +200,37 @@ xmlNodePtr find_element_model(xmlNodePtr node, xmlDocPtr model);
  */
 int edit_config(xmlDocPtr repo, xmlDocPtr edit, struct ncds_ds* ds, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE UNUSED(errop), const struct nacm_rpc* nacm, struct nc_err **error);
 
+/**
+ * @brief Update the index and the recorded changes of the document modified by
+ * edit_config() before the node is unlinked from it and freed. It does
+ * nothing for other documents.
+ *
+ * @param[in] node Node to be removed.
+ */
+void edit_index_remove(xmlNodePtr node);
+
+/**
+ * @brief Perform edit-config changes the same way as edit_config() and return
+ * the list of the changes in the order they were applied.
+ *
+ * @param[in] repo XML document to change (target NETCONF repository).
+ * @param[in] edit Content of the edit-config's \<config\> element as an XML
+ * document defining the changes to perform.
+ * @param[in] ds Datastore structure where the edit-config will be performed.
+ * @param[in] defop Default edit-config's operation for this edit-config call.
+ * @param[in] errop NETCONF edit-config's error option defining reactions to an error.
+ * @param[in] nacm NACM structure of the request RPC to check Access Rights
+ * @param[in] dryrun If set, the changes are applied to copies of repo and
+ * edit, both documents are left untouched.
+ * @param[out] changes List of changes, NULL if nothing was changed. On error,
+ * it contains the changes made before the error was detected. Caller is
+ * supposed to free it by ncds_changes_free().
+ * @param[out] err NETCONF error structure.
+ * @return On error, non-zero is returned and err structure is filled. Zero is
+ * returned on success.
+ */
+int edit_config_changes(xmlDocPtr repo, xmlDocPtr edit, struct ncds_ds* ds, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, const struct nacm_rpc* nacm, int dryrun, struct ncds_change** changes, struct nc_err **error);
+
 int edit_replace_nacmcheck(xmlNodePtr orig_node, xmlDocPtr edit_doc, xmlDocPtr model, keyList keys, const struct nacm_rpc* nacm, struct nc_err** error);
 int edit_merge(xmlDocPtr orig_doc, xmlNodePtr edit_node, NC_EDIT_DEFOP_TYPE defop, xmlDocPtr model, keyList keys, const struct nacm_rpc* nacm, struct nc_err** error);
 
@@ -0,0 +1,751 @@
+/**
+ * \file datastore_binary.c
+ * \author Radek Krejci <rkrejci@cesnet.cz>
+ * \brief Compact binary format of the file datastore.
+ *
+ * Copyright (c) 2012-2014 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * ALTERNATIVELY, provided that this notice is retained in full, this
+ * product may be distributed under the terms of the GNU General Public
+ * License (GPL) version 2 or later, in which case the provisions
+ * of the GPL apply INSTEAD OF those given above.
+ *
+ * This software is provided ``as is, and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose are disclaimed.
+ * In no event shall the company or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+#include <libxml/hash.h>
+#include <libxml/dict.h>
+
+#include "../../netconf_internal.h"
+#include "datastore_binary.h"
+
+static const char rcsid[] __attribute__((used)) ="$Id: "__FILE__": "RCSID" $";
+
+/* Types of the node records */
+#define BIN_ELEMENT 'E'
+#define BIN_TEXT 'T'
+#define BIN_CDATA 'D'
+#define BIN_COMMENT 'C'
+#define BIN_PI 'P'
+
+/* Index of the missing string (no namespace, default namespace prefix) */
+#define BIN_NONE 0xffffffffU
+
+/* Size of the file header: magic, version, count and size of the strings */
+#define BIN_HEADER_SIZE (sizeof(NCDS_BIN_MAGIC) + 3 * 4)
+
+/* Maximal depth of the elements, protects the stack against broken files */
+#define BIN_MAX_DEPTH 1024
+
+/**
+ * @brief Growing buffer the binary file is composed in.
+ */
+struct bin_buf {
+	unsigned char* data;
+	size_t len, size;
+	int failed;
+};
+
+/**
+ * @brief State of writing a document.
+ */
+struct bin_writer {
+	/* interned strings and their indexes (increased by 1) */
+	struct bin_buf strings;
+	uint32_t count;
+	xmlHashTablePtr ids;
+	/* node records */
+	struct bin_buf nodes;
+};
+
+static void bin_put(struct bin_buf* buf, const void* data, size_t len)
+{
+	unsigned char* new_data;
+	size_t new_size;
+
+	if (buf->failed) {
+		return;
+	}
+	if (buf->len + len > buf->size) {
+		for (new_size = (buf->size > 0) ? buf->size : 4096; new_size < buf->len + len; new_size *= 2);
+		if ((new_data = realloc(buf->data, new_size)) == NULL) {
+			ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
+			buf->failed = 1;
+			return;
+		}
+		buf->data = new_data;
+		buf->size = new_size;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void bin_set32(struct bin_buf* buf, size_t offset, uint32_t value)
+{
+	if (buf->failed) {
+		return;
+	}
+	buf->data[offset] = value & 0xff;
+	buf->data[offset + 1] = (value >> 8) & 0xff;
+	buf->data[offset + 2] = (value >> 16) & 0xff;
+	buf->data[offset + 3] = (value >> 24) & 0xff;
+}
+
+static void bin_put32(struct bin_buf* buf, uint32_t value)
+{
+	unsigned char bytes[4] = {value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, (value >> 24) & 0xff};
+
+	bin_put(buf, bytes, 4);
+}
+
+/**
+ * @brief Put the number in the variable-length encoding, 7 bits per byte
+ * starting with the least significant ones, the highest bit marks that
+ * another byte follows.
+ */
+static void bin_put_num(struct bin_buf* buf, uint32_t value)
+{
+	unsigned char bytes[5];
+	size_t len = 0;
+
+	do {
+		bytes[len] = value & 0x7f;
+		value >>= 7;
+		if (value) {
+			bytes[len] |= 0x80;
+		}
+		len++;
+	} while (value);
+
+	bin_put(buf, bytes, len);
+}
+
+/**
+ * @brief Put the index of the string, BIN_NONE is stored as 0.
+ */
+static void bin_put_id(struct bin_buf* buf, uint32_t id)
+{
+	bin_put_num(buf, (id == BIN_NONE) ? 0 : id + 1);
+}
+
+static void bin_put_value(struct bin_buf* buf, const xmlChar* value)
+{
+	size_t len = (value != NULL) ? strlen((const char*)value) : 0;
+
+	bin_put_num(buf, len);
+	bin_put(buf, value, len);
+}
+
+/**
+ * @brief Get the index of the string in the string table, add it if it is not
+ * there yet.
+ */
+static uint32_t bin_string(struct bin_writer* w, const xmlChar* str)
+{
+	uintptr_t id;
+
+	if (str == NULL) {
+		return (BIN_NONE);
+	}
+
+	if ((id = (uintptr_t)xmlHashLookup(w->ids, str)) != 0) {
+		return (id - 1);
+	}
+
+	id = w->count++;
+	if (xmlHashAddEntry(w->ids, str, (void*)(id + 1)) != 0) {
+		w->strings.failed = 1;
+	}
+	bin_put_value(&w->strings, str);
+	bin_put(&w->strings, "", 1);
+
+	return (id);
+}
+
+/**
+ * @brief Append the block of the node records.
+ *
+ * @param[in] w Writer state.
+ * @param[in] first First node of the block.
+ * @param[in] depth Depth of the nodes, the document deeper than the reader
+ * accepts makes the writing fail.
+ */
+static void bin_write_nodes(struct bin_writer* w, xmlNodePtr first, int depth)
+{
+	xmlNodePtr node;
+	xmlNsPtr ns;
+	xmlAttrPtr attr;
+	xmlChar* value;
+	uint32_t count;
+	size_t block;
+	unsigned char kind;
+
+	if (depth > BIN_MAX_DEPTH) {
+		if (!w->nodes.failed) {
+			ERROR("%s: the document is nested deeper than %d levels.", __func__, BIN_MAX_DEPTH);
+		}
+		w->nodes.failed = 1;
+		return;
+	}
+
+	/* length of the block is filled at the end */
+	block = w->nodes.len;
+	bin_put32(&w->nodes, 0);
+
+	for (node = first; node != NULL; node = node->next) {
+		switch (node->type) {
+		case XML_ELEMENT_NODE:
+			kind = BIN_ELEMENT;
+			bin_put(&w->nodes, &kind, 1);
+			bin_put_id(&w->nodes, bin_string(w, node->name));
+			bin_put_id(&w->nodes, bin_string(w, (node->ns != NULL) ? node->ns->href : NULL));
+			bin_put_id(&w->nodes, bin_string(w, (node->ns != NULL) ? node->ns->prefix : NULL));
+
+			for (count = 0, ns = node->nsDef; ns != NULL; ns = ns->next, count++);
+			bin_put_num(&w->nodes, count);
+			for (ns = node->nsDef; ns != NULL; ns = ns->next) {
+				bin_put_id(&w->nodes, bin_string(w, ns->prefix));
+				bin_put_id(&w->nodes, bin_string(w, ns->href));
+			}
+
+			for (count = 0, attr = node->properties; attr != NULL; attr = attr->next, count++);
+			bin_put_num(&w->nodes, count);
+			for (attr = node->properties; attr != NULL; attr = attr->next) {
+				bin_put_id(&w->nodes, bin_string(w, attr->name));
+				bin_put_id(&w->nodes, bin_string(w, (attr->ns != NULL) ? attr->ns->href : NULL));
+				bin_put_id(&w->nodes, bin_string(w, (attr->ns != NULL) ? attr->ns->prefix : NULL));
+				value = xmlNodeGetContent((xmlNodePtr)attr);
+				bin_put_value(&w->nodes, value);
+				xmlFree(value);
+			}
+
+			bin_write_nodes(w, node->children, depth + 1);
+			break;
+		case XML_TEXT_NODE:
+		case XML_CDATA_SECTION_NODE:
+		case XML_COMMENT_NODE:
+			kind = (node->type == XML_TEXT_NODE) ? BIN_TEXT : ((node->type == XML_COMMENT_NODE) ? BIN_COMMENT : BIN_CDATA);
+			bin_put(&w->nodes, &kind, 1);
+			bin_put_value(&w->nodes, node->content);
+			break;
+		case XML_PI_NODE:
+			kind = BIN_PI;
+			bin_put(&w->nodes, &kind, 1);
+			bin_put_id(&w->nodes, bin_string(w, node->name));
+			bin_put_value(&w->nodes, node->content);
+			break;
+		default:
+			/* DTD and entities are not a part of the configuration data */
+			VERB("%s: skipping the node of type %d.", __func__, node->type);
+			break;
+		}
+	}
+
+	bin_set32(&w->nodes, block, w->nodes.len - block - 4);
+}
+
+int ncds_bin_write(xmlDocPtr doc, FILE* file)
+{
+	struct bin_writer w;
+	struct bin_buf header;
+	int ret = EXIT_SUCCESS;
+
+	memset(&w, 0, sizeof(w));
+	memset(&header, 0, sizeof(header));
+	if ((w.ids = xmlHashCreate(0)) == NULL) {
+		ERROR("%s: creating the hash table failed.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	bin_write_nodes(&w, doc->children, 0);
+
+	bin_put(&header, NCDS_BIN_MAGIC, sizeof(NCDS_BIN_MAGIC));
+	bin_put32(&header, NCDS_BIN_VERSION);
+	bin_put32(&header, w.count);
+	bin_put32(&header, w.strings.len);
+
+	if (header.failed || w.strings.failed || w.nodes.failed) {
+		ret = EXIT_FAILURE;
+	} else if (fwrite(header.data, 1, header.len, file) != header.len ||
+			fwrite(w.strings.data, 1, w.strings.len, file) != w.strings.len ||
+			fwrite(w.nodes.data, 1, w.nodes.len, file) != w.nodes.len) {
+		ERROR("%s: writing the binary datastore failed (%s).", __func__, strerror(errno));
+		ret = EXIT_FAILURE;
+	}
+
+	xmlHashFree(w.ids, NULL);
+	free(header.data);
+	free(w.strings.data);
+	free(w.nodes.data);
+
+	return (ret);
+}
+
+static int bin_get_num(const struct ncds_bin_image* image, size_t* offset, size_t end, uint32_t* value)
+{
+	unsigned int shift;
+	unsigned char byte;
+
+	*value = 0;
+	for (shift = 0; shift < 35; shift += 7) {
+		if (*offset >= end) {
+			return (EXIT_FAILURE);
+		}
+		byte = image->data[(*offset)++];
+		*value |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return (EXIT_SUCCESS);
+		}
+	}
+
+	return (EXIT_FAILURE);
+}
+
+static int bin_get32(const struct ncds_bin_image* image, size_t* offset, size_t end, uint32_t* value)
+{
+	const unsigned char* p;
+
+	if (*offset + 4 > end) {
+		return (EXIT_FAILURE);
+	}
+	p = image->data + *offset;
+	*value = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	*offset += 4;
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Get the string of the index, fails for an invalid index.
+ */
+static int bin_get_string(const struct ncds_bin_image* image, size_t* offset, size_t end, int optional, const xmlChar** str)
+{
+	uint32_t id;
+
+	if (bin_get_num(image, offset, end, &id)) {
+		return (EXIT_FAILURE);
+	}
+	if (id == 0 && optional) {
+		*str = NULL;
+		return (EXIT_SUCCESS);
+	}
+	if (id == 0 || id > image->strings_count) {
+		return (EXIT_FAILURE);
+	}
+	*str = image->strings[id - 1];
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Get the length-prefixed value, only its position in the image.
+ */
+static int bin_get_value(const struct ncds_bin_image* image, size_t* offset, size_t end, const char** value, uint32_t* len)
+{
+	if (bin_get_num(image, offset, end, len) || *len > end - *offset) {
+		return (EXIT_FAILURE);
+	}
+	*value = (const char*)image->data + *offset;
+	*offset += *len;
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Find the namespace declaration in scope of the node, declare it on
+ * the node if there is none.
+ */
+static xmlNsPtr bin_ns(xmlDocPtr doc, xmlNodePtr node, const xmlChar* href, const xmlChar* prefix)
+{
+	xmlNsPtr ns;
+
+	if ((ns = xmlSearchNs(doc, node, prefix)) != NULL && xmlStrEqual(ns->href, href)) {
+		return (ns);
+	}
+	if ((ns = xmlNewNs(node, href, prefix)) == NULL) {
+		ns = xmlSearchNsByHref(doc, node, href);
+	}
+
+	return (ns);
+}
+
+/**
+ * @brief Process the block of the node records. Without the document, the
+ * records are only checked.
+ *
+ * @param[in] image Image of the binary datastore file.
+ * @param[in] offset Offset of the block.
+ * @param[in] doc Document to build, NULL to check the block only.
+ * @param[in] parent Parent of the nodes.
+ * @param[in] depth Depth of the nodes.
+ * @param[in] defer Depth of the elements whose children are not decoded,
+ * -1 to decode everything.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int bin_read_nodes(const struct ncds_bin_image* image, size_t offset, xmlDocPtr doc, xmlNodePtr parent, int depth, int defer)
+{
+	const xmlChar *name, *href, *prefix;
+	const char* value;
+	xmlChar* aux;
+	xmlNodePtr node = NULL;
+	xmlNsPtr ns;
+	uint32_t len, count, i;
+	size_t end, block;
+	unsigned char kind;
+
+	if (depth > BIN_MAX_DEPTH || bin_get32(image, &offset, image->size, &len) || len > image->size - offset) {
+		return (EXIT_FAILURE);
+	}
+	end = offset + len;
+
+	while (offset < end) {
+		kind = image->data[offset++];
+		switch (kind) {
+		case BIN_ELEMENT:
+			if (bin_get_string(image, &offset, end, 0, &name) ||
+					bin_get_string(image, &offset, end, 1, &href) ||
+					bin_get_string(image, &offset, end, 1, &prefix) ||
+					bin_get_num(image, &offset, end, &count)) {
+				return (EXIT_FAILURE);
+			}
+			if (doc != NULL) {
+				node = xmlAddChild(parent, xmlNewDocNode(doc, NULL, name, NULL));
+				if (node == NULL) {
+					return (EXIT_FAILURE);
+				}
+			}
+
+			/* namespace declarations */
+			for (i = 0; i < count; i++) {
+				const xmlChar *def_prefix, *def_href;
+
+				if (bin_get_string(image, &offset, end, 1, &def_prefix) ||
+						bin_get_string(image, &offset, end, 0, &def_href)) {
+					return (EXIT_FAILURE);
+				}
+				if (doc != NULL) {
+					xmlNewNs(node, def_href, def_prefix);
+				}
+			}
+			if (doc != NULL && href != NULL) {
+				xmlSetNs(node, bin_ns(doc, node, href, prefix));
+			}
+
+			/* attributes */
+			if (bin_get_num(image, &offset, end, &count)) {
+				return (EXIT_FAILURE);
+			}
+			for (i = 0; i < count; i++) {
+				if (bin_get_string(image, &offset, end, 0, &name) ||
+						bin_get_string(image, &offset, end, 1, &href) ||
+						bin_get_string(image, &offset, end, 1, &prefix) ||
+						bin_get_value(image, &offset, end, &value, &len)) {
+					return (EXIT_FAILURE);
+				}
+				if (doc != NULL) {
+					ns = (href != NULL) ? bin_ns(doc, node, href, prefix) : NULL;
+					aux = xmlStrndup(BAD_CAST value, len);
+					xmlNewNsProp(node, ns, name, aux);
+					xmlFree(aux);
+				}
+			}
+
+			/* children */
+			block = offset;
+			if (bin_get32(image, &offset, end, &len) || len > end - offset) {
+				return (EXIT_FAILURE);
+			}
+			if (doc != NULL && depth == defer) {
+				/* remember where the children are, they are decoded on demand */
+				node->_private = (void*)(uintptr_t)block;
+			} else if (bin_read_nodes(image, block, doc, node, depth + 1, defer)) {
+				return (EXIT_FAILURE);
+			}
+			offset += len;
+			break;
+		case BIN_TEXT:
+		case BIN_CDATA:
+		case BIN_COMMENT:
+			if (bin_get_value(image, &offset, end, &value, &len)) {
+				return (EXIT_FAILURE);
+			}
+			if (doc != NULL) {
+				if (kind == BIN_TEXT) {
+					node = xmlNewDocTextLen(doc, BAD_CAST value, len);
+				} else if (kind == BIN_CDATA) {
+					node = xmlNewCDataBlock(doc, BAD_CAST value, len);
+				} else {
+					aux = xmlStrndup(BAD_CAST value, len);
+					node = xmlNewDocComment(doc, aux);
+					xmlFree(aux);
+				}
+				if (node == NULL || xmlAddChild(parent, node) == NULL) {
+					return (EXIT_FAILURE);
+				}
+			}
+			break;
+		case BIN_PI:
+			if (bin_get_string(image, &offset, end, 0, &name) ||
+					bin_get_value(image, &offset, end, &value, &len)) {
+				return (EXIT_FAILURE);
+			}
+			if (doc != NULL) {
+				aux = xmlStrndup(BAD_CAST value, len);
+				node = xmlNewDocPI(doc, name, aux);
+				xmlFree(aux);
+				if (node == NULL || xmlAddChild(parent, node) == NULL) {
+					return (EXIT_FAILURE);
+				}
+			}
+			break;
+		default:
+			return (EXIT_FAILURE);
+		}
+	}
+
+	return (offset == end ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+int ncds_bin_open(int fd, struct ncds_bin_image* image)
+{
+	struct stat statbuf;
+	size_t offset, end;
+	uint32_t version = 0, strings_size = 0, len = 0, i;
+	void* data;
+
+	memset(image, 0, sizeof(struct ncds_bin_image));
+
+	if (fstat(fd, &statbuf) == -1) {
+		ERROR("%s: stat() failed (%s).", __func__, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	if ((size_t)statbuf.st_size < BIN_HEADER_SIZE) {
+		VERB("%s: the file is too short to be a binary datastore.", __func__);
+		return (EXIT_FAILURE);
+	}
+	if ((data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		ERROR("%s: mmap() failed (%s).", __func__, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	image->data = data;
+	image->size = statbuf.st_size;
+
+	/* header */
+	offset = sizeof(NCDS_BIN_MAGIC);
+	if (memcmp(image->data, NCDS_BIN_MAGIC, sizeof(NCDS_BIN_MAGIC)) != 0) {
+		ERROR("%s: the file is not a binary datastore.", __func__);
+		goto error;
+	}
+	bin_get32(image, &offset, image->size, &version);
+	bin_get32(image, &offset, image->size, &image->strings_count);
+	bin_get32(image, &offset, image->size, &strings_size);
+	if (version != NCDS_BIN_VERSION) {
+		ERROR("%s: unsupported version %u of the binary datastore.", __func__, version);
+		goto error;
+	}
+	if (strings_size > image->size - offset || image->strings_count > strings_size / 2) {
+		goto corrupted;
+	}
+
+	/* index of the strings */
+	if (image->strings_count > 0 && (image->strings = malloc(image->strings_count * sizeof(xmlChar*))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		goto error;
+	}
+	end = offset + strings_size;
+	for (i = 0; i < image->strings_count; i++) {
+		if (bin_get_num(image, &offset, end, &len) || len >= end - offset || image->data[offset + len] != '\0') {
+			goto corrupted;
+		}
+		image->strings[i] = image->data + offset;
+		offset += len + 1;
+	}
+	if (offset != end) {
+		goto corrupted;
+	}
+
+	/* node records */
+	image->nodes = offset;
+	if (bin_read_nodes(image, offset, NULL, NULL, 0, 0)) {
+		goto corrupted;
+	}
+	bin_get32(image, &offset, image->size, &len);
+	if (offset + len != image->size) {
+		goto corrupted;
+	}
+
+	return (EXIT_SUCCESS);
+
+corrupted:
+	ERROR("%s: the binary datastore is corrupted.", __func__);
+error:
+	ncds_bin_close(image);
+	return (EXIT_FAILURE);
+}
+
+void ncds_bin_close(struct ncds_bin_image* image)
+{
+	if (image->data != NULL) {
+		munmap((void*)image->data, image->size);
+	}
+	free(image->strings);
+	memset(image, 0, sizeof(struct ncds_bin_image));
+}
+
+xmlDocPtr ncds_bin_read(const struct ncds_bin_image* image, int lazy)
+{
+	xmlDocPtr doc;
+
+	if ((doc = xmlNewDoc(BAD_CAST "1.0")) == NULL) {
+		return (NULL);
+	}
+	/* intern the names and keep the encoding as the parser does */
+	doc->dict = xmlDictCreate();
+	doc->encoding = xmlStrdup(BAD_CAST "UTF-8");
+
+	/* with lazy, children of the root element children (depth 1) are deferred */
+	if (bin_read_nodes(image, image->nodes, doc, (xmlNodePtr)doc, 0, lazy ? 1 : -1)) {
+		ERROR("%s: decoding the binary datastore failed.", __func__);
+		xmlFreeDoc(doc);
+		return (NULL);
+	}
+
+	return (doc);
+}
+
+int ncds_bin_pending(const xmlNodePtr node)
+{
+	return (node != NULL && node->type == XML_ELEMENT_NODE && node->_private != NULL);
+}
+
+int ncds_bin_materialize(const struct ncds_bin_image* image, xmlNodePtr node)
+{
+	size_t offset;
+
+	if (!ncds_bin_pending(node)) {
+		return (EXIT_SUCCESS);
+	}
+
+	offset = (uintptr_t)node->_private;
+	node->_private = NULL;
+	if (bin_read_nodes(image, offset, node->doc, node, 2, -1)) {
+		ERROR("%s: decoding the binary datastore failed.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+void ncds_bin_discard(xmlNodePtr node)
+{
+	if (ncds_bin_pending(node)) {
+		node->_private = NULL;
+	}
+}
+
+API int ncds_bin_import(const char* xml_path, const char* bin_path)
+{
+	xmlDocPtr doc;
+	FILE* file;
+	int ret;
+
+	if (xml_path == NULL || bin_path == NULL) {
+		ERROR("%s: invalid parameter.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	/* keep even the redundant namespace declarations */
+	if ((doc = xmlReadFile(xml_path, NULL, (NC_XMLREAD_OPTIONS) & ~XML_PARSE_NSCLEAN)) == NULL) {
+		ERROR("%s: reading the file %s failed.", __func__, xml_path);
+		return (EXIT_FAILURE);
+	}
+	if ((file = fopen(bin_path, "w")) == NULL) {
+		ERROR("%s: opening the file %s failed (%s).", __func__, bin_path, strerror(errno));
+		xmlFreeDoc(doc);
+		return (EXIT_FAILURE);
+	}
+
+	ret = ncds_bin_write(doc, file);
+	if (fclose(file) != 0) {
+		ERROR("%s: writing the file %s failed (%s).", __func__, bin_path, strerror(errno));
+		ret = EXIT_FAILURE;
+	}
+	xmlFreeDoc(doc);
+
+	return (ret);
+}
+
+API int ncds_bin_export(const char* bin_path, const char* xml_path)
+{
+	struct ncds_bin_image image;
+	xmlDocPtr doc;
+	int fd;
+
+	if (bin_path == NULL || xml_path == NULL) {
+		ERROR("%s: invalid parameter.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	if ((fd = open(bin_path, O_RDONLY)) == -1) {
+		ERROR("%s: opening the file %s failed (%s).", __func__, bin_path, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	if (ncds_bin_open(fd, &image)) {
+		close(fd);
+		return (EXIT_FAILURE);
+	}
+	doc = ncds_bin_read(&image, 0);
+	ncds_bin_close(&image);
+	close(fd);
+	if (doc == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	if (xmlSaveFormatFile(xml_path, doc, 1) == -1) {
+		ERROR("%s: writing the file %s failed.", __func__, xml_path);
+		xmlFreeDoc(doc);
+		return (EXIT_FAILURE);
+	}
+	xmlFreeDoc(doc);
+
+	return (EXIT_SUCCESS);
+}
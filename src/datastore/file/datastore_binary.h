@@ -0,0 +1,149 @@
+/**
+ * \file datastore_binary.h
+ * \author Radek Krejci <rkrejci@cesnet.cz>
+ * \brief Compact binary format of the file datastore.
+ *
+ * Copyright (c) 2012-2014 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * ALTERNATIVELY, provided that this notice is retained in full, this
+ * product may be distributed under the terms of the GNU General Public
+ * License (GPL) version 2 or later, in which case the provisions
+ * of the GPL apply INSTEAD OF those given above.
+ *
+ * This software is provided ``as is, and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose are disclaimed.
+ * In no event shall the company or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+
+#ifndef NC_DATASTORE_BINARY_H_
+#define NC_DATASTORE_BINARY_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <libxml/tree.h>
+
+/* Magic bytes starting the binary datastore file */
+#define NCDS_BIN_MAGIC "NCDSBIN"
+
+/* Version of the binary datastore format */
+#define NCDS_BIN_VERSION 1
+
+/**
+ * @brief Binary datastore file mapped into the memory.
+ *
+ * The file consists of a header, a table of the interned strings (names of
+ * the elements and attributes, namespace prefixes and URIs) and the records
+ * of the document nodes in the document order. The strings are referenced by
+ * their indexes, the values (texts, attribute values) are prefixed by their
+ * length. The numbers are stored in a variable-length encoding, except the
+ * header and the lengths of the blocks of the records, which are 32 bit
+ * little-endian. Each element record ends with the block of its children
+ * records, so the children can be skipped and decoded later.
+ */
+struct ncds_bin_image {
+	/**
+	 * mapped content of the file
+	 */
+	const unsigned char* data;
+	size_t size;
+	/**
+	 * interned strings, they point into data
+	 */
+	const xmlChar** strings;
+	uint32_t strings_count;
+	/**
+	 * offset of the block of the document children records
+	 */
+	size_t nodes;
+};
+
+/**
+ * @brief Write the document in the binary format. The document nested deeper
+ * than the binary reader accepts is refused.
+ *
+ * @param[in] doc Document to write.
+ * @param[in] file File to write into, it is not flushed.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int ncds_bin_write(xmlDocPtr doc, FILE* file);
+
+/**
+ * @brief Map the binary datastore file into the memory and check its
+ * structure, so the decoding of its content cannot fail later.
+ *
+ * @param[in] fd Opened binary datastore file.
+ * @param[out] image Image of the file to fill, it must be released by
+ * ncds_bin_close().
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int ncds_bin_open(int fd, struct ncds_bin_image* image);
+
+/**
+ * @brief Release the image, nodes of the documents read from it must not be
+ * materialized anymore.
+ *
+ * @param[in] image Image to release, it can be empty.
+ */
+void ncds_bin_close(struct ncds_bin_image* image);
+
+/**
+ * @brief Build the document from the image.
+ *
+ * @param[in] image Image of the binary datastore file.
+ * @param[in] lazy If set, the content of the children of the root element
+ * is not decoded, ncds_bin_materialize() must be called before accessing it.
+ *
+ * @return Decoded document, NULL on error.
+ */
+xmlDocPtr ncds_bin_read(const struct ncds_bin_image* image, int lazy);
+
+/**
+ * @brief Check if the content of the node was not decoded yet.
+ */
+int ncds_bin_pending(const xmlNodePtr node);
+
+/**
+ * @brief Decode the content of the node left out by the lazy ncds_bin_read().
+ * Nothing is done for other nodes.
+ *
+ * @param[in] image Image the node was read from.
+ * @param[in] node Node to complete.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int ncds_bin_materialize(const struct ncds_bin_image* image, xmlNodePtr node);
+
+/**
+ * @brief Forget the content of the node left out by the lazy ncds_bin_read()
+ * without decoding it. Nothing is done for other nodes.
+ *
+ * @param[in] node Node whose content is dropped.
+ */
+void ncds_bin_discard(xmlNodePtr node);
+
+#endif /* NC_DATASTORE_BINARY_H_ */
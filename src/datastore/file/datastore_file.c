@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
@@ -72,28 +73,176 @@ static const char rcsid[] __attribute__((used)) ="$Id: "__FILE__": "RCSID" $";
   <candidate modified=\"false\" lock=\"\"/>\
 </datastores>"
 
-static struct timespec tv_timeout;
-static sigset_t fullsigset;
+/*
+ * The datastore is locked by the process-shared rwlock in the shared memory,
+ * or by the semaphore if the shared memory is not available. The read-only
+ * operations share the lock (see file_rdlock()), the others hold it
+ * exclusively with all the signals blocked, so they are not interrupted in
+ * the middle of changing the datastore.
+ */
+#define LOCK(file_ds, ret) ret = file_lock(file_ds)
+#define UNLOCK(file_ds) file_unlock(file_ds)
+
+/**
+ * @brief Acquire the lock of the datastore and account the time spent waiting.
+ *
+ * @param file_ds File datastore structure
+ * @param exclusive Acquire the lock exclusively
+ *
+ * @return 0 on success, non-zero when the locking timed out
+ */
+static int file_lock_wait(struct ncds_ds_file* file_ds, int exclusive)
+{
+	struct timespec timeout, start, end;
+	unsigned long long wait = 0;
+	int ret;
+
+	/* try it first without any waiting */
+	if (file_ds->ds_lock.shared != NULL) {
+		if (exclusive) {
+			ret = pthread_rwlock_trywrlock(&file_ds->ds_lock.shared->rwlock);
+		} else {
+			ret = pthread_rwlock_tryrdlock(&file_ds->ds_lock.shared->rwlock);
+		}
+	} else {
+		ret = sem_trywait(file_ds->ds_lock.lock);
+	}
+
+	if (ret != 0) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_sec += NCDS_LOCK_TIMEOUT;
+		if (file_ds->ds_lock.shared != NULL) {
+			if (exclusive) {
+				ret = pthread_rwlock_timedwrlock(&file_ds->ds_lock.shared->rwlock, &timeout);
+			} else {
+				ret = pthread_rwlock_timedrdlock(&file_ds->ds_lock.shared->rwlock, &timeout);
+			}
+		} else {
+			while ((ret = sem_timedwait(file_ds->ds_lock.lock, &timeout)) == -1 && errno == EINTR);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		wait = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+	}
+
+	pthread_mutex_lock(&file_ds->ds_lock.stats.lock);
+	if (ret != 0) {
+		file_ds->ds_lock.stats.timeouts++;
+	} else if (exclusive) {
+		file_ds->ds_lock.stats.writes++;
+	} else {
+		file_ds->ds_lock.stats.reads++;
+	}
+	file_ds->ds_lock.stats.wait_usec += wait;
+	if (wait > file_ds->ds_lock.stats.max_wait_usec) {
+		file_ds->ds_lock.stats.max_wait_usec = wait;
+	}
+	pthread_mutex_unlock(&file_ds->ds_lock.stats.lock);
+
+	return (ret);
+}
+
+static void file_lock_release(struct ncds_ds_file* file_ds)
+{
+	if (file_ds->ds_lock.shared != NULL) {
+		pthread_rwlock_unlock(&file_ds->ds_lock.shared->rwlock);
+	} else {
+		sem_post(file_ds->ds_lock.lock);
+	}
+}
+
+/**
+ * @brief Get the cached serialized content of the datastore.
+ *
+ * @return Pointer to the cache slot, NULL for an invalid target.
+ */
+static char** file_cache_slot(struct ncds_ds_file* file_ds, NC_DATASTORE target)
+{
+	switch (target) {
+	case NC_DATASTORE_RUNNING:
+		return (&file_ds->cache.running);
+	case NC_DATASTORE_STARTUP:
+		return (&file_ds->cache.startup);
+	case NC_DATASTORE_CANDIDATE:
+		return (&file_ds->cache.candidate);
+	default:
+		return (NULL);
+	}
+}
+
+/**
+ * @brief Drop the cached serialized content of all the datastores, it MUST
+ * be called whenever the xml can be changed.
+ */
+static void file_cache_drop(struct ncds_ds_file* file_ds)
+{
+	pthread_mutex_lock(&file_ds->cache.lock);
+	free(file_ds->cache.running);
+	free(file_ds->cache.startup);
+	free(file_ds->cache.candidate);
+	file_ds->cache.running = file_ds->cache.startup = file_ds->cache.candidate = NULL;
+	pthread_mutex_unlock(&file_ds->cache.lock);
+}
 
-#define LOCK(file_ds, ret) {\
-	sigfillset(&fullsigset);\
-	sigprocmask(SIG_SETMASK, &fullsigset, &(file_ds->ds_lock.sigset));\
-	clock_gettime(CLOCK_REALTIME, &tv_timeout);\
-	tv_timeout.tv_sec += NCDS_LOCK_TIMEOUT;\
-	if (sem_timedwait(file_ds->ds_lock.lock, &tv_timeout) == -1 && errno == ETIMEDOUT) {\
-		ret = 1;\
-		sigprocmask(SIG_SETMASK, &(file_ds->ds_lock.sigset), NULL);\
-	} else {\
-		ret = 0;\
-		file_ds->ds_lock.holding_lock = 1;\
-	}\
+static void file_shm_publish(struct ncds_ds_file* file_ds);
+
+/*
+ * the lock can be used from more threads, so all the state except the signal
+ * mask of the thread holding the lock is kept on the stack
+ */
+static int file_lock(struct ncds_ds_file* file_ds)
+{
+	sigset_t fullsigset, origsigset;
+
+	sigfillset(&fullsigset);
+	sigprocmask(SIG_SETMASK, &fullsigset, &origsigset);
+	if (file_lock_wait(file_ds, 1)) {
+		sigprocmask(SIG_SETMASK, &origsigset, NULL);
+		return (1);
+	}
+	file_ds->ds_lock.sigset = origsigset;
+	file_ds->ds_lock.holding_lock = 1;
+	if (file_ds->ds_lock.shared != NULL) {
+		file_ds->ds_lock.locked_gen = file_ds->ds_lock.shared->gen;
+	}
+
+	/* only the exclusive holder changes the xml */
+	file_cache_drop(file_ds);
+
+	return (0);
 }
-#define UNLOCK(file_ds) {\
-	sem_post(file_ds->ds_lock.lock);\
-	file_ds->ds_lock.holding_lock = 0;\
-	sigprocmask(SIG_SETMASK, &(file_ds->ds_lock.sigset), NULL);\
+
+static void file_unlock(struct ncds_ds_file* file_ds)
+{
+	sigset_t origsigset = file_ds->ds_lock.sigset;
+
+	/* the changed content is published before anyone else can access it */
+	if (file_ds->shm_image != NULL && file_ds->ds_lock.shared != NULL &&
+			file_ds->ds_lock.gen == file_ds->ds_lock.shared->gen &&
+			file_ds->ds_lock.locked_gen != file_ds->ds_lock.shared->gen) {
+		file_shm_publish(file_ds);
+	}
+
+	file_ds->ds_lock.holding_lock = 0;
+	file_lock_release(file_ds);
+	sigprocmask(SIG_SETMASK, &origsigset, NULL);
 }
 
+/* types of the journal records */
+#define JOURNAL_EDIT 'e'
+#define JOURNAL_COPY 'c'
+#define JOURNAL_DELETE 'd'
+#define JOURNAL_LOCK 'l'
+#define JOURNAL_UNLOCK 'u'
+
+/* magic string starting the journal file */
+#define JOURNAL_MAGIC "NCDS-JOURNAL"
+
+/* FNV-1a offset basis used for the journal record checksums */
+#define JOURNAL_CHECKSUM_INIT 2166136261U
+
+static void* file_compact_thread(void* arg);
+
 /**
  * @brief Determine if the datastore is accessible (is not NETCONF locked) for the
  * specified session. This function MUST be called between LOCK and UNLOCK
@@ -190,6 +339,36 @@ API int ncds_file_set_path(struct ncds_ds* datastore, const char* path)
 	return 0;
 }
 
+API int ncds_file_get_lock_stats(struct ncds_ds* datastore, unsigned long long* reads, unsigned long long* writes, unsigned long long* timeouts, unsigned long long* wait_usec, unsigned long long* max_wait_usec)
+{
+	struct ncds_ds_file * file_ds = (struct ncds_ds_file*)datastore;
+
+	if (datastore == NULL || (datastore->type != NCDS_TYPE_FILE && datastore->type != NCDS_TYPE_BIN && datastore->type != NCDS_TYPE_SHM) || file_ds->journal.path == NULL) {
+		ERROR ("Invalid datastore.");
+		return -1;
+	}
+
+	pthread_mutex_lock(&file_ds->ds_lock.stats.lock);
+	if (reads != NULL) {
+		*reads = file_ds->ds_lock.stats.reads;
+	}
+	if (writes != NULL) {
+		*writes = file_ds->ds_lock.stats.writes;
+	}
+	if (timeouts != NULL) {
+		*timeouts = file_ds->ds_lock.stats.timeouts;
+	}
+	if (wait_usec != NULL) {
+		*wait_usec = file_ds->ds_lock.stats.wait_usec;
+	}
+	if (max_wait_usec != NULL) {
+		*max_wait_usec = file_ds->ds_lock.stats.max_wait_usec;
+	}
+	pthread_mutex_unlock(&file_ds->ds_lock.stats.lock);
+
+	return 0;
+}
+
 /**
  * @brief Checks if the structure of an XML matches the expected one
  * @param[in] doc Document to check.
@@ -259,6 +438,26 @@ static xmlDocPtr file_create_xmlframe(void)
 	return doc;
 }
 
+/**
+ * @brief Check if the candidate has no changes against the running, i.e. it
+ * has no content of its own and it is read from the running.
+ *
+ * @param candidate xml node of the candidate datastore
+ *
+ * @return 1 if the candidate is not modified, 0 otherwise
+ */
+static int file_candidate_clean(xmlNodePtr candidate)
+{
+	xmlChar* modified;
+	int ret;
+
+	modified = xmlGetProp(candidate, BAD_CAST "modified");
+	ret = (modified == NULL || xmlStrcmp(modified, BAD_CAST "true") != 0);
+	xmlFree(modified);
+
+	return (ret);
+}
+
 static int file_fill_dsnodes(struct ncds_ds_file* ds)
 {
 	xmlNodePtr aux;
@@ -299,6 +498,15 @@ static int file_fill_dsnodes(struct ncds_ds_file* ds)
 		goto invalid_ds;
 	}
 
+	if (file_candidate_clean(ds->candidate)) {
+		/* a copy of the running stored by the older versions, it is never read */
+		ncds_bin_discard(ds->candidate);
+		while ((aux = ds->candidate->children) != NULL) {
+			xmlUnlinkNode(aux);
+			xmlFreeNode(aux);
+		}
+	}
+
 	return (EXIT_SUCCESS);
 
 invalid_ds:
@@ -308,134 +516,514 @@ invalid_ds:
 	return (EXIT_FAILURE);
 }
 
-int ncds_file_changed(struct ncds_ds* ds)
+/**
+ * @brief Read the datastore document in the binary format, its content is
+ * decoded lazily.
+ *
+ * @param fd Opened file in the binary format
+ * @param image Image to keep the mapped file in
+ *
+ * @return Read document, NULL on error
+ */
+static xmlDocPtr file_read_image(int fd, struct ncds_bin_image* image)
 {
-	time_t t;
-	struct stat statbuf;
+	xmlDocPtr doc;
 
-	/* get current time */
-	if ((t = time(NULL)) == ((time_t)(-1))) {
-		ERROR("time() failed (%s)", strerror(errno));
-		/* we do not know, so answer that file was changed */
-		return (1);
+	if (ncds_bin_open(fd, image)) {
+		return (NULL);
 	}
-
-	/* check when the file was modified */
-	if (stat(((struct ncds_ds_file*)ds)->path, &statbuf) == 0) {
-		if (statbuf.st_mtime < ds->last_access) {
-			/* file was not modified */
-			return (0);
-		}
+	if ((doc = ncds_bin_read(image, 1)) == NULL) {
+		ncds_bin_close(image);
 	}
-	return (1);
+
+	return (doc);
 }
 
 /**
- * @ingroup store
- * @brief Initialization of the file datastore
+ * @brief Read the datastore document from the file in the format of the
+ * datastore type. The content of the binary datastore is decoded lazily, so
+ * its file stays mapped in the image as long as the document is used.
  *
- * @file_ds File datastore structure
+ * @param file_ds File datastore structure
+ * @param fd Opened datastore file
+ * @param path Path of the datastore file
+ * @param image Image to keep the mapped binary datastore file in
  *
- * @return 0 on success, non-zero else
+ * @return Read document, NULL on error
  */
-int ncds_file_init(struct ncds_ds* ds)
+static xmlDocPtr file_read(struct ncds_ds_file* file_ds, int fd, const char* path, struct ncds_bin_image* image)
 {
-	struct stat st;
-	char* new_path = NULL, *sempath, *dir_name, *file_name, *dup_path;
-	struct dirent * file_info;
-	DIR * dir;
+	memset(image, 0, sizeof(struct ncds_bin_image));
+	if (file_ds->ds.type != NCDS_TYPE_BIN) {
+		return (xmlReadFd(fd, path, NULL, NC_XMLREAD_OPTIONS));
+	}
+
+	return (file_read_image(fd, image));
+}
+
+/**
+ * @brief Read the datastore document from the file of the given path, see
+ * file_read(). The image of the binary datastore is kept in the file_ds.
+ */
+static xmlDocPtr file_read_path(struct ncds_ds_file* file_ds, const char* path)
+{
+	xmlDocPtr doc;
 	int fd;
-	mode_t mask;
-	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
 
-	file_ds->xml = xmlReadFile(file_ds->path, NULL, NC_XMLREAD_OPTIONS);
-	while (file_ds->xml == NULL || file_structure_check(file_ds->xml) == 0) { /* while is used for break */
-		WARN("Failed to parse the datastore (%s).", file_ds->path);
-		/*
-		 * Try to use a backup datastore that we can use instead the main one
-		 */
-		if (stat(file_ds->path, &st) == -1) {
-			ERROR("Unable to work with datastore file (%s), trying to use a backup datastore.", strerror(errno));
-		} else if (st.st_size > 0) {
-			/* there are some data in the datastore file */
-			WARN("Datastore file contains some data, trying to use a backup datastore...");
-		} else { /* st.st_size == 0 */
-			/* nothing needed, just use the datastore file and create an empty datastore inside it */
-			break;
-		}
+	if (file_ds->ds.type != NCDS_TYPE_BIN) {
+		return (xmlReadFile(path, NULL, NC_XMLREAD_OPTIONS));
+	}
 
-		/* create a temporary file where an empty datastore will be created */
-		dup_path = strdup(file_ds->path);
-		file_name = basename(dup_path);
-		dir_name = dirname(dup_path);
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		return (NULL);
+	}
+	ncds_bin_close(&file_ds->bin);
+	doc = file_read(file_ds, fd, path, &file_ds->bin);
+	close(fd);
 
-		/* cleanup so far structures because new will be created */
-		fclose(file_ds->file);
-		xmlFreeDoc(file_ds->xml);
-		file_ds->file = NULL;
-		file_ds->xml = NULL;
+	return (doc);
+}
 
-		/* checking if there are any valid backup datastores */
-		if ((dir = opendir(dir_name)) == NULL) {
-			ERROR("Unable to open datastore directory %s (%s).", dir_name, strerror(errno));
-			free(dup_path);
+/**
+ * @brief Decode all the content of the datastore not accessed yet, so the
+ * whole document can be written.
+ *
+ * @param file_ds File datastore structure
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_materialize(struct ncds_ds_file* file_ds)
+{
+	if (ncds_bin_materialize(&file_ds->bin, file_ds->running) ||
+			ncds_bin_materialize(&file_ds->bin, file_ds->startup) ||
+			ncds_bin_materialize(&file_ds->bin, file_ds->candidate)) {
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Write the datastore document in the binary format.
+ *
+ * @param file_ds File datastore structure
+ * @param file File to write into, it is not flushed
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_write_image(struct ncds_ds_file* file_ds, FILE* file)
+{
+	/* the content not decoded yet is written too */
+	if (file_materialize(file_ds)) {
+		return (EXIT_FAILURE);
+	}
+
+	return (ncds_bin_write(file_ds->xml, file));
+}
+
+/**
+ * @brief Write the datastore document into the file in the format of the
+ * datastore type.
+ *
+ * @param file_ds File datastore structure
+ * @param file File to write into, it is not flushed
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_write(struct ncds_ds_file* file_ds, FILE* file)
+{
+	if (file_ds->ds.type != NCDS_TYPE_BIN) {
+		/* the content attached from the shared image is decoded lazily as well */
+		if (file_materialize(file_ds)) {
 			return (EXIT_FAILURE);
 		}
+		return ((xmlDocFormatDump(file, file_ds->xml, 1) == -1) ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
 
-		for (errno = 0; (file_info = readdir(dir)) != NULL;) {
-			if (errno) {
-				ERROR("Unable to read datastore directory %s (%s).", dir_name, strerror(errno));
-				free(dup_path);
-				return (EXIT_FAILURE);
-			}
+	return (file_write_image(file_ds, file));
+}
 
-			/* check if readed file contains original file name */
-			if (strncmp(file_info->d_name, file_name, strlen(file_name)) != 0) {
-				continue;
-			}
+static void file_id_set(struct ncds_ds_file* file_ds, const struct stat* statbuf)
+{
+	file_ds->fileid.dev = statbuf->st_dev;
+	file_ds->fileid.ino = statbuf->st_ino;
+	file_ds->fileid.mtime = statbuf->st_mtim;
+	file_ds->fileid.size = statbuf->st_size;
+}
 
-			/* we have some file that could be a backup datastore from some previous run */
-			if (asprintf(&new_path, "%s/%s", dir_name, file_info->d_name) == -1) {
-				ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
-				free(dup_path);
-				return (EXIT_FAILURE);
-			}
-			nc_clip_occurences_with(new_path, '/', '/');
+static int file_id_equal(const struct ds_fileid_s* fileid, const struct stat* statbuf)
+{
+	return (fileid->dev == statbuf->st_dev && fileid->ino == statbuf->st_ino &&
+			fileid->mtime.tv_sec == statbuf->st_mtim.tv_sec &&
+			fileid->mtime.tv_nsec == statbuf->st_mtim.tv_nsec &&
+			fileid->size == statbuf->st_size);
+}
 
-			file_ds->xml = xmlReadFile(new_path, NULL, NC_XMLREAD_OPTIONS);
-			if (file_ds->xml == NULL || file_structure_check(file_ds->xml) == 0) {
-				/* bad backup datastore, try another one */
-				free(new_path);
-				new_path = NULL;
-				continue;
-			} else {
-				/* we found a correct backup datastore, use it */
-				WARN("Using %s as a backup datastore.", new_path);
-				file_ds->file = fopen(new_path, "r+");
-				if (file_ds->file == NULL) {
-					/* ok, that is not so correct as we thought, wtf?!? */
-					ERROR("Unable to open backup datastore (%s)", strerror(errno));
-					xmlFreeDoc(file_ds->xml);
-					file_ds->xml = NULL;
-					free(new_path);
-					new_path = NULL;
+/**
+ * @brief Check if the datastore file is the one loaded into the xml.
+ *
+ * @return non-zero if the file is the same, zero if it was replaced
+ */
+static int file_id_match(struct ncds_ds_file* file_ds, const struct stat* statbuf)
+{
+	if (file_ds->ds.last_access == 0) {
+		/* nothing loaded yet */
+		return (0);
+	}
 
-					/* try another file in backup datastore directory */
-					continue;
-				}
+	return (file_id_equal(&file_ds->fileid, statbuf));
+}
 
-				/* now it is surely correct, not like a few lines above :) */
-				free(file_ds->path);
-				file_ds->path = new_path;
-				break;
+int ncds_file_changed(struct ncds_ds* ds)
+{
+	struct stat statbuf;
+
+	/* check if the file was replaced */
+	if (stat(((struct ncds_ds_file*)ds)->path, &statbuf) == 0) {
+		if (file_id_match((struct ncds_ds_file*)ds, &statbuf)) {
+			/* file was not modified, but there can be new changes in the journal */
+			if (((struct ncds_ds_file*)ds)->journal.fd == -1 ||
+					(fstat(((struct ncds_ds_file*)ds)->journal.fd, &statbuf) == 0 && statbuf.st_size <= ((struct ncds_ds_file*)ds)->journal.size)) {
+				return (0);
 			}
 		}
+	}
+	return (1);
+}
 
-		free(dup_path);
-		closedir(dir);
-
-		if (file_ds->file == NULL) {
-			/* no previous backup datastore found, create a new one */
+/**
+ * @brief Open the lock of the datastore and the shared memory of all the
+ * processes using the datastore.
+ *
+ * @param file_ds File datastore structure
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_lock_open(struct ncds_ds_file* file_ds)
+{
+	char* sempath;
+	mode_t mask;
+	pthread_rwlockattr_t rwattr;
+	struct timespec timeout;
+	int fd, locked;
+
+	/*
+	 * open and eventually create a lock
+	 */
+	/* first - prepare the path, there must be a separate lock for each
+	 * datastore(set), so name it according to the filepath with a special prefix.
+	 * Slashes in the path are replaced with underscores.
+	 * Sequences of slashes are treated as a single slash character.
+	 */
+	if (asprintf(&sempath, "%s/%s", NCDS_LOCK, file_ds->path) == -1) {
+		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		return (EXIT_FAILURE);
+	}
+	nc_clip_occurences_with(sempath, '/', '_');
+	/* recreate initial backslash in the semaphore name */
+	sempath[0] = '/';
+	/* and then create the lock (actually it is a semaphore) */
+	mask = umask(0000);
+	if ((file_ds->ds_lock.lock = sem_open (sempath, O_CREAT, FILE_PERM, 1)) == SEM_FAILED) {
+		umask(mask);
+		return (EXIT_FAILURE);
+	}
+	umask(mask);
+	free (sempath);
+
+	/*
+	 * the shared memory with the generation counter is named the same way,
+	 * when not available, the datastore file is checked on every access
+	 */
+	if (asprintf(&sempath, "%s/%s", NCDS_SHM, file_ds->path) == -1) {
+		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		return (EXIT_FAILURE);
+	}
+	nc_clip_occurences_with(sempath, '/', '_');
+	sempath[0] = '/';
+	fd = shm_open(sempath, O_CREAT | O_RDWR, FILE_PERM);
+	if (fd != -1) {
+		/* umask is process-wide, so set the permissions on the descriptor,
+		 * it fails harmlessly if another user created the object */
+		fchmod(fd, FILE_PERM);
+	}
+	if (fd == -1 || ftruncate(fd, sizeof(struct ds_shared_s)) == -1 ||
+			(file_ds->ds_lock.shared = mmap(NULL, sizeof(struct ds_shared_s), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		WARN("Unable to use the shared memory %s (%s), datastore changes will be checked in the file.", sempath, strerror(errno));
+		file_ds->ds_lock.shared = NULL;
+	} else {
+		/* the first process initiates the shared lock */
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_sec += NCDS_LOCK_TIMEOUT;
+		if ((locked = (sem_timedwait(file_ds->ds_lock.lock, &timeout) == 0)) == 0) {
+			WARN("Locking datastore file timeouted, initiating its shared lock anyway.");
+		}
+		if (file_ds->ds_lock.shared->rwlock_init != NCDS_SHM_MAGIC) {
+			pthread_rwlockattr_init(&rwattr);
+			pthread_rwlockattr_setpshared(&rwattr, PTHREAD_PROCESS_SHARED);
+#ifdef __GLIBC__
+			/* do not let the readers starve the writers */
+			pthread_rwlockattr_setkind_np(&rwattr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+			pthread_rwlock_init(&file_ds->ds_lock.shared->rwlock, &rwattr);
+			pthread_rwlockattr_destroy(&rwattr);
+			file_ds->ds_lock.shared->rwlock_init = NCDS_SHM_MAGIC;
+		}
+		if (locked) {
+			sem_post(file_ds->ds_lock.lock);
+		}
+	}
+	if (fd != -1) {
+		close(fd);
+	}
+	free (sempath);
+
+	/* and so is the image of the datastore content */
+	if (file_ds->ds.type == NCDS_TYPE_SHM) {
+		if (asprintf(&file_ds->shm_image, "%s/%s", NCDS_SHM_IMAGE, file_ds->path) == -1) {
+			ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+			file_ds->shm_image = NULL;
+			return (EXIT_FAILURE);
+		}
+		nc_clip_occurences_with(file_ds->shm_image, '/', '_');
+		file_ds->shm_image[0] = '/';
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Replace the xml with the image of the datastore content published
+ * in the shared memory (NCDS_TYPE_SHM). This function MUST be called ONLY
+ * with the lock of the datastore held, at least shared.
+ *
+ * The image is in the binary format, so it is only mapped and the content
+ * of the individual datastores is decoded when accessed. The state of the
+ * journal is taken from the shared memory, the journal is not replayed.
+ *
+ * @param file_ds File datastore structure
+ * @param t Current time
+ *
+ * @return EXIT_SUCCESS, EXIT_FAILURE when there is no image of the current
+ * content or it cannot be used
+ */
+static int file_shm_attach(struct ncds_ds_file* file_ds, time_t t)
+{
+	struct ncds_bin_image image;
+	struct stat statbuf;
+	xmlDocPtr new_xml;
+	int fd;
+
+	if (file_ds->shm_image == NULL || file_ds->ds_lock.shared == NULL ||
+			file_ds->ds_lock.shared->image_gen == 0 || file_ds->ds_lock.shared->image_gen != file_ds->ds_lock.shared->gen) {
+		return (EXIT_FAILURE);
+	}
+	/* the image outlives the processes, it must belong to the current datastore file */
+	if (stat(file_ds->path, &statbuf) == -1 || !file_id_equal(&file_ds->ds_lock.shared->fileid, &statbuf)) {
+		return (EXIT_FAILURE);
+	}
+
+	if ((fd = shm_open(file_ds->shm_image, O_RDONLY, 0)) == -1) {
+		WARN("Unable to open the datastore image %s (%s), reading the datastore file.", file_ds->shm_image, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	new_xml = file_read_image(fd, &image);
+	close(fd);
+	if (new_xml == NULL) {
+		return (EXIT_FAILURE);
+	}
+	if (file_structure_check(new_xml) == 0) {
+		xmlFreeDoc(new_xml);
+		ncds_bin_close(&image);
+		return (EXIT_FAILURE);
+	}
+
+	xmlFreeDoc(file_ds->xml);
+	file_ds->xml = new_xml;
+	ncds_bin_close(&file_ds->bin);
+	file_ds->bin = image;
+	file_fill_dsnodes(file_ds);
+
+	file_ds->fileid = file_ds->ds_lock.shared->fileid;
+	file_ds->journal.gen = file_ds->ds_lock.shared->journal_gen;
+	file_ds->journal.size = file_ds->ds_lock.shared->journal_size;
+	file_ds->journal.records = file_ds->ds_lock.shared->journal_records;
+
+	file_ds->ds.last_access = t;
+	file_ds->ds_lock.checked = t;
+	file_ds->ds_lock.gen = file_ds->ds_lock.shared->gen;
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Publish the current content of the datastore as its image in the
+ * shared memory (NCDS_TYPE_SHM), so the other processes attach it instead of
+ * reading the datastore file. This function MUST be called ONLY between
+ * file_ds_lock() and file_ds_unlock().
+ *
+ * The image is replaced as a whole, the processes attached to the previous
+ * one keep it mapped until they attach the new one.
+ *
+ * @param file_ds File datastore structure
+ */
+static void file_shm_publish(struct ncds_ds_file* file_ds)
+{
+	struct ds_shared_s* shared = file_ds->ds_lock.shared;
+	FILE* image;
+	int fd, ret;
+
+	/* invalid until it is complete */
+	shared->image_gen = 0;
+
+	shm_unlink(file_ds->shm_image);
+	fd = shm_open(file_ds->shm_image, O_CREAT | O_EXCL | O_RDWR, FILE_PERM);
+	if (fd == -1 || fchmod(fd, FILE_PERM) == -1 || (image = fdopen(fd, "w")) == NULL) {
+		WARN("Unable to publish the datastore image %s (%s), other processes will read the datastore file.", file_ds->shm_image, strerror(errno));
+		if (fd != -1) {
+			close(fd);
+			shm_unlink(file_ds->shm_image);
+		}
+		return;
+	}
+	ret = file_write_image(file_ds, image);
+	if (fclose(image) != 0 || ret) {
+		WARN("Unable to publish the datastore image %s, other processes will read the datastore file.", file_ds->shm_image);
+		shm_unlink(file_ds->shm_image);
+		return;
+	}
+
+	shared->fileid = file_ds->fileid;
+	shared->journal_gen = file_ds->journal.gen;
+	shared->journal_size = file_ds->journal.size;
+	shared->journal_records = file_ds->journal.records;
+	shared->image_gen = shared->gen;
+}
+
+/**
+ * @ingroup store
+ * @brief Initialization of the file datastore
+ *
+ * @file_ds File datastore structure
+ *
+ * @return 0 on success, non-zero else
+ */
+int ncds_file_init(struct ncds_ds* ds)
+{
+	struct stat st;
+	char* new_path = NULL, *dir_name, *file_name, *dup_path;
+	struct dirent * file_info;
+	DIR * dir;
+	int fd, created = 0, attached = 0;
+	mode_t mask;
+	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
+
+	file_ds->journal.fd = -1;
+	pthread_rwlock_init(&file_ds->ds_lock.local, NULL);
+	pthread_mutex_init(&file_ds->ds_lock.stats.lock, NULL);
+	pthread_mutex_init(&file_ds->cache.lock, NULL);
+
+	if (file_ds->ds.type == NCDS_TYPE_SHM) {
+		/* the processes already using the datastore published its content */
+		if (file_lock_open(file_ds)) {
+			return (EXIT_FAILURE);
+		}
+		if (file_lock_wait(file_ds, 0) == 0) {
+			attached = (file_shm_attach(file_ds, time(NULL)) == EXIT_SUCCESS);
+			file_lock_release(file_ds);
+		}
+	}
+
+	if (file_ds->xml == NULL) {
+		file_ds->xml = file_read_path(file_ds, file_ds->path);
+	}
+	while (file_ds->xml == NULL || file_structure_check(file_ds->xml) == 0) { /* while is used for break */
+		WARN("Failed to parse the datastore (%s).", file_ds->path);
+		/*
+		 * Try to use a backup datastore that we can use instead the main one
+		 */
+		if (stat(file_ds->path, &st) == -1) {
+			ERROR("Unable to work with datastore file (%s), trying to use a backup datastore.", strerror(errno));
+		} else if (st.st_size > 0) {
+			/* there are some data in the datastore file */
+			WARN("Datastore file contains some data, trying to use a backup datastore...");
+		} else { /* st.st_size == 0 */
+			/* nothing needed, just use the datastore file and create an empty datastore inside it */
+			break;
+		}
+
+		/* create a temporary file where an empty datastore will be created */
+		dup_path = strdup(file_ds->path);
+		file_name = basename(dup_path);
+		dir_name = dirname(dup_path);
+
+		/* cleanup so far structures because new will be created */
+		fclose(file_ds->file);
+		xmlFreeDoc(file_ds->xml);
+		file_ds->file = NULL;
+		file_ds->xml = NULL;
+
+		/* checking if there are any valid backup datastores */
+		if ((dir = opendir(dir_name)) == NULL) {
+			ERROR("Unable to open datastore directory %s (%s).", dir_name, strerror(errno));
+			free(dup_path);
+			return (EXIT_FAILURE);
+		}
+
+		for (errno = 0; (file_info = readdir(dir)) != NULL;) {
+			if (errno) {
+				ERROR("Unable to read datastore directory %s (%s).", dir_name, strerror(errno));
+				free(dup_path);
+				return (EXIT_FAILURE);
+			}
+
+			/* check if readed file contains original file name */
+			if (strncmp(file_info->d_name, file_name, strlen(file_name)) != 0) {
+				continue;
+			}
+
+			/* we have some file that could be a backup datastore from some previous run */
+			if (asprintf(&new_path, "%s/%s", dir_name, file_info->d_name) == -1) {
+				ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+				free(dup_path);
+				return (EXIT_FAILURE);
+			}
+			nc_clip_occurences_with(new_path, '/', '/');
+
+			file_ds->xml = file_read_path(file_ds, new_path);
+			if (file_ds->xml == NULL || file_structure_check(file_ds->xml) == 0) {
+				/* bad backup datastore, try another one */
+				free(new_path);
+				new_path = NULL;
+				continue;
+			} else {
+				/* we found a correct backup datastore, use it */
+				WARN("Using %s as a backup datastore.", new_path);
+				file_ds->file = fopen(new_path, "r+");
+				if (file_ds->file == NULL) {
+					/* ok, that is not so correct as we thought, wtf?!? */
+					ERROR("Unable to open backup datastore (%s)", strerror(errno));
+					xmlFreeDoc(file_ds->xml);
+					file_ds->xml = NULL;
+					free(new_path);
+					new_path = NULL;
+
+					/* try another file in backup datastore directory */
+					continue;
+				}
+
+				/* now it is surely correct, not like a few lines above :) */
+				free(file_ds->path);
+				file_ds->path = new_path;
+				break;
+			}
+		}
+
+		free(dup_path);
+		closedir(dir);
+
+		if (file_ds->file == NULL) {
+			/* no previous backup datastore found, create a new one */
 
 			/* Create file based on original name */
 			if (asprintf(&new_path, "%s.XXXXXX", file_ds->path) == -1) {
@@ -470,69 +1058,738 @@ int ncds_file_init(struct ncds_ds* ds)
 		if (file_ds->xml == NULL) {
 			return (EXIT_FAILURE);
 		}
-		xmlDocFormatDump(file_ds->file, file_ds->xml, 1);
+		file_write(file_ds, file_ds->file);
 		WARN("File %s was empty. Basic structure created.", file_ds->path);
+		created = 1;
 	}
 
 	/* init value */
-	file_ds->xml_rollback = NULL;
+	file_ds->rollback.store = file_ds->rollback.valid = file_ds->rollback.commit = 0;
+	file_ds->rollback.doc = NULL;
+	file_ds->rollback.modified = NULL;
 
 	/* get pointers to running, startup and candidate nodes in xml */
 	if (file_fill_dsnodes(file_ds) != EXIT_SUCCESS) {
 		return (EXIT_FAILURE);
 	}
 
-	/* unlock forgotten locks if any */
-	xmlSetProp (file_ds->running, BAD_CAST "lock", BAD_CAST "");
-	xmlSetProp (file_ds->startup, BAD_CAST "lock", BAD_CAST "");
-	xmlSetProp (file_ds->candidate, BAD_CAST "lock", BAD_CAST "");
+	/* unlock forgotten locks if any, the published ones are held by the running processes */
+	if (!attached) {
+		xmlSetProp (file_ds->running, BAD_CAST "lock", BAD_CAST "");
+		xmlSetProp (file_ds->startup, BAD_CAST "lock", BAD_CAST "");
+		xmlSetProp (file_ds->candidate, BAD_CAST "lock", BAD_CAST "");
+	}
+
+	if (file_ds->ds.type != NCDS_TYPE_SHM && file_lock_open(file_ds)) {
+		return (EXIT_FAILURE);
+	}
 
 	/*
-	 * open and eventually create a lock
-	 */
-	/* first - prepare the path, there must be a separate lock for each
-	 * datastore(set), so name it according to the filepath with a special prefix.
-	 * Slashes in the path are replaced with underscores.
-	 * Sequences of slashes are treated as a single slash character.
+	 * open the journal of the datastore changes, it is replayed by the first
+	 * file_reload(), without the journal the whole file is always rewritten
 	 */
-	if (asprintf(&sempath, "%s/%s", NCDS_LOCK, file_ds->path) == -1) {
+	if (asprintf(&file_ds->journal.path, "%s%s", file_ds->path, NCDS_FILE_JOURNAL_SUFFIX) == -1) {
 		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		file_ds->journal.path = NULL;
 		return (EXIT_FAILURE);
 	}
-	nc_clip_occurences_with(sempath, '/', '_');
-	/* recreate initial backslash in the semaphore name */
-	sempath[0] = '/';
-	/* and then create the lock (actually it is a semaphore) */
-	mask = umask(0000);
-	if ((file_ds->ds_lock.lock = sem_open (sempath, O_CREAT, FILE_PERM, 1)) == SEM_FAILED) {
-		umask(mask);
-		return (EXIT_FAILURE);
+	mask = umask(MASK_PERM);
+	file_ds->journal.fd = open(file_ds->journal.path, O_RDWR | O_CREAT, FILE_PERM);
+	umask(mask);
+	if (file_ds->journal.fd == -1) {
+		WARN("Unable to open the datastore journal %s (%s), the journal will not be used.", file_ds->journal.path, strerror(errno));
+	} else if (created && ftruncate(file_ds->journal.fd, 0) == -1) {
+		/* a journal of some previous datastore must not be applied to the new one */
+		WARN("Unable to clear the datastore journal %s (%s), the journal will not be used.", file_ds->journal.path, strerror(errno));
+		close(file_ds->journal.fd);
+		file_ds->journal.fd = -1;
+	}
+
+	pthread_mutex_init(&file_ds->compact.mutex, NULL);
+	pthread_cond_init(&file_ds->compact.cond, NULL);
+	if (file_ds->journal.fd != -1) {
+		if (pthread_create(&file_ds->compact.thread, NULL, file_compact_thread, file_ds) != 0) {
+			WARN("Unable to start the datastore journal compaction thread, the journal will be compacted synchronously.");
+		} else {
+			file_ds->compact.running = 1;
+		}
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+void ncds_file_free(struct ncds_ds* ds)
+{
+	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
+
+	if (file_ds != NULL) {
+		/* ncds_ds_file specific part */
+		if (file_ds->compact.running) {
+			pthread_mutex_lock(&file_ds->compact.mutex);
+			file_ds->compact.quit = 1;
+			pthread_cond_signal(&file_ds->compact.cond);
+			pthread_mutex_unlock(&file_ds->compact.mutex);
+			pthread_join(file_ds->compact.thread, NULL);
+		}
+		if (file_ds->journal.path != NULL) {
+			if (file_ds->journal.fd != -1) {
+				close(file_ds->journal.fd);
+			}
+			free(file_ds->journal.path);
+			pthread_mutex_destroy(&file_ds->compact.mutex);
+			pthread_cond_destroy(&file_ds->compact.cond);
+			pthread_rwlock_destroy(&file_ds->ds_lock.local);
+			pthread_mutex_destroy(&file_ds->ds_lock.stats.lock);
+			pthread_mutex_destroy(&file_ds->cache.lock);
+		}
+		if (file_ds->file != NULL) {
+			fclose(file_ds->file);
+		}
+		free(file_ds->path);
+		free(file_ds->shm_image);
+		xmlFreeDoc(file_ds->xml);
+		ncds_bin_close(&file_ds->bin);
+		xmlFreeDoc(file_ds->rollback.doc);
+		xmlFree(file_ds->rollback.modified);
+		free(file_ds->cache.running);
+		free(file_ds->cache.startup);
+		free(file_ds->cache.candidate);
+		if (file_ds->ds_lock.lock != NULL) {
+			if (file_ds->ds_lock.holding_lock) {
+				file_lock_release(file_ds);
+			}
+			sem_close(file_ds->ds_lock.lock);
+		}
+		if (file_ds->ds_lock.shared != NULL) {
+			munmap(file_ds->ds_lock.shared, sizeof(struct ds_shared_s));
+		}
+	}
+}
+
+/**
+ * @brief Get the xml node of the specified datastore type with its content
+ * ready to be accessed. Except the file_rdlock(), it MUST be called ONLY
+ * between file_ds_lock() and file_ds_unlock().
+ *
+ * @param file_ds File datastore structure
+ * @param target Datastore type
+ *
+ * @return xml node of the datastore, NULL for an invalid target
+ */
+static xmlNodePtr file_ds_node(struct ncds_ds_file* file_ds, NC_DATASTORE target)
+{
+	xmlNodePtr node;
+
+	switch(target) {
+	case NC_DATASTORE_RUNNING:
+		node = file_ds->running;
+		break;
+	case NC_DATASTORE_STARTUP:
+		node = file_ds->startup;
+		break;
+	case NC_DATASTORE_CANDIDATE:
+		node = file_ds->candidate;
+		break;
+	default:
+		return (NULL);
+	}
+
+	/* the content of the binary datastore is decoded when needed for the first time */
+	if (ncds_bin_pending(node) && ncds_bin_materialize(&file_ds->bin, node)) {
+		return (NULL);
+	}
+
+	return (node);
+}
+
+/**
+ * @brief Get the xml node holding the current content of the datastore. It
+ * is the running for the candidate without any changes, otherwise it is the
+ * same as file_ds_node().
+ */
+static xmlNodePtr file_ds_content(struct ncds_ds_file* file_ds, NC_DATASTORE target)
+{
+	if (target == NC_DATASTORE_CANDIDATE && file_candidate_clean(file_ds->candidate)) {
+		target = NC_DATASTORE_RUNNING;
+	}
+
+	return (file_ds_node(file_ds, target));
+}
+
+/**
+ * @brief Check if the content of the datastore was not decoded yet, so
+ * file_ds_content() would change the xml.
+ */
+static int file_pending(struct ncds_ds_file* file_ds, NC_DATASTORE target)
+{
+	switch(target) {
+	case NC_DATASTORE_RUNNING:
+		return (ncds_bin_pending(file_ds->running));
+	case NC_DATASTORE_STARTUP:
+		return (ncds_bin_pending(file_ds->startup));
+	case NC_DATASTORE_CANDIDATE:
+		return (ncds_bin_pending(file_candidate_clean(file_ds->candidate) ? file_ds->running : file_ds->candidate));
+	default:
+		return (0);
+	}
+}
+
+/**
+ * @brief Move the list of nodes under the new parent, possibly into another
+ * document.
+ *
+ * @param src_doc Document the nodes currently belong to
+ * @param first First node of the list
+ * @param dst_doc Document of the new parent
+ * @param parent New parent of the nodes
+ */
+static void file_move_nodes(xmlDocPtr src_doc, xmlNodePtr first, xmlDocPtr dst_doc, xmlNodePtr parent)
+{
+	xmlNodePtr node, next;
+
+	for (node = first; node != NULL; node = next) {
+		next = node->next;
+		xmlUnlinkNode(node);
+		if (src_doc != dst_doc) {
+			/* fix the dictionary strings and namespaces referencing the source document */
+			xmlDOMWrapAdoptNode(NULL, src_doc, node, dst_doc, parent, 0);
+		}
+		xmlAddChild(parent, node);
+	}
+}
+
+/**
+ * @brief Remove the current content of the datastore before it is replaced.
+ * If requested by file_rollback_store(), the content is kept as the version
+ * to return to by file_rollback_restore(), otherwise it is freed.
+ *
+ * @param file_ds File datastore structure
+ * @param target Datastore type
+ * @param target_ds xml node of the datastore
+ */
+static void file_drop_content(struct ncds_ds_file* file_ds, NC_DATASTORE target, xmlNodePtr target_ds)
+{
+	xmlNodePtr del;
+
+	if (file_ds->rollback.store) {
+		file_ds->rollback.store = 0;
+		file_ds->rollback.target = target;
+		file_ds->rollback.modified = xmlGetProp(target_ds, BAD_CAST "modified");
+		file_ds->rollback.doc = xmlNewDoc(BAD_CAST "1.0");
+		xmlDocSetRootElement(file_ds->rollback.doc, xmlNewDocNode(file_ds->rollback.doc, NULL, BAD_CAST "rollback", NULL));
+		file_move_nodes(file_ds->xml, target_ds->children, file_ds->rollback.doc, xmlDocGetRootElement(file_ds->rollback.doc));
+		return;
+	}
+
+	while ((del = target_ds->children) != NULL) {
+		xmlUnlinkNode(del);
+		xmlFreeNode(del);
+	}
+}
+
+/**
+ * @brief Parse the serialized configuration into the document with the
+ * top-level configuration elements as its root siblings, i.e. the form of
+ * the configuration passed to the file datastore as a document.
+ *
+ * @param config Serialized configuration, possibly with the XML declaration.
+ *
+ * @return NULL on error, the document on success.
+ */
+static xmlDocPtr file_read_config(const char* config)
+{
+	xmlDocPtr config_doc;
+	xmlNodePtr aux_node, root;
+	char* aux = NULL;
+	const char* configp;
+
+	if (strncmp(config, "<?xml", 5) == 0) {
+		if ((configp = strchr(config, '>')) == NULL) {
+			ERROR("%s: invalid config.", __func__);
+			return (NULL);
+		}
+		++configp;
+		while (*configp == ' ' || *configp == '\n' || *configp == '\t') {
+			++configp;
+		}
+	} else {
+		configp = config;
+	}
+	if (asprintf(&aux, "<config>%s</config>", configp) == -1) {
+		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		return (NULL);
+	}
+
+	/* read config to XML doc */
+	if ((config_doc = xmlReadMemory (aux, strlen(aux), NULL, NULL, NC_XMLREAD_OPTIONS)) == NULL) {
+		free(aux);
+		ERROR("%s: Reading xml data failed!", __func__);
+		return (NULL);
+	}
+	free(aux);
+	/* magic - get off the root config element and move all children to the 1st level */
+	root = xmlDocGetRootElement(config_doc);
+	for (aux_node = root->children; aux_node != NULL; aux_node = root->children) {
+		xmlUnlinkNode(aux_node);
+		xmlAddNextSibling(config_doc->last, aux_node);
+	}
+	xmlUnlinkNode(root);
+	xmlFreeNode(root);
+
+	return (config_doc);
+}
+
+/**
+ * @brief Serialize the configuration document for the journal record, so
+ * file_read_config() gets the same configuration from it.
+ *
+ * @return NULL on error, the serialized configuration on success.
+ */
+static char* file_dump_config(xmlDocPtr config_doc)
+{
+	xmlBufferPtr resultbuffer;
+	xmlNodePtr aux_node;
+	char* data;
+
+	if ((resultbuffer = xmlBufferCreate()) == NULL) {
+		ERROR("%s: xmlBufferCreate failed (%s:%d).", __func__, __FILE__, __LINE__);
+		return (NULL);
+	}
+	for (aux_node = config_doc->children; aux_node != NULL; aux_node = aux_node->next) {
+		xmlNodeDump(resultbuffer, config_doc, aux_node, 0, 0);
+	}
+	data = strdup((char*)xmlBufferContent(resultbuffer));
+	xmlBufferFree(resultbuffer);
+
+	return (data);
+}
+
+/*
+ * The following functions change the datastore xml tree as the particular
+ * operations require. They are used when the operation is performed as well as
+ * when it is replayed from the journal, so they must not depend on anything
+ * else than their parameters and the current content of the datastore.
+ */
+
+static int file_editconfig_apply(struct ncds_ds_file* file_ds, NC_DATASTORE target, xmlNodePtr target_ds, xmlDocPtr config_doc, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, const struct nacm_rpc* nacm, struct nc_err** error)
+{
+	xmlDocPtr datastore_doc;
+	xmlNodePtr aux_node, root, content;
+	int retval = EXIT_SUCCESS;
+
+	/* the candidate without any changes is edited as a copy of the running */
+	if ((content = file_ds_content(file_ds, target)) == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	/* create an XML doc with a copy of the datastore configuration */
+	datastore_doc = xmlNewDoc (BAD_CAST "1.0");
+	xmlDocSetRootElement(datastore_doc, xmlCopyNode(content->children, 1));
+	if (content->children) {
+		for (root = content->children->next; root != NULL; root = aux_node) {
+			aux_node = root->next;
+			xmlAddNextSibling(datastore_doc->last, xmlCopyNode(root, 1));
+		}
+	}
+
+	/* preform edit config */
+	if (edit_config(datastore_doc, config_doc, (struct ncds_ds*)file_ds, defop, errop, nacm, error)) {
+		retval = EXIT_FAILURE;
+	} else {
+		/* replace datastore by edited configuration, the edited copy is moved, not copied again */
+		file_drop_content(file_ds, target, target_ds);
+		file_move_nodes(datastore_doc, datastore_doc->children, file_ds->xml, target_ds);
+
+		/*
+		 * if we are changing candidate, mark it as modified, since we need
+		 * this information for locking - according to RFC, candidate cannot
+		 * be locked since it has been modified and not committed.
+		 */
+		if (target == NC_DATASTORE_CANDIDATE) {
+			xmlSetProp(target_ds, BAD_CAST "modified", BAD_CAST "true");
+		}
+	}
+
+	xmlFreeDoc(datastore_doc);
+
+	return retval;
+}
+
+static void file_copyconfig_apply(struct ncds_ds_file* file_ds, NC_DATASTORE target, xmlNodePtr target_ds, NC_DATASTORE source, xmlNodePtr config)
+{
+	xmlNodePtr copy;
+
+	if (target == NC_DATASTORE_CANDIDATE && source == NC_DATASTORE_RUNNING) {
+		/* drop the changes of the candidate, it is read from the running again */
+		file_drop_content(file_ds, target, target_ds);
+		xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "false");
+		return;
+	}
+
+	/* the source can be the target itself, so copy it before dropping the target */
+	copy = (config != NULL) ? xmlCopyNodeList(config) : NULL;
+
+	/* drop current target configuration */
+	file_drop_content(file_ds, target, target_ds);
+
+	/* copy new target configuration */
+	if (copy != NULL) {
+		xmlAddChildList(target_ds, copy);
+	}
+
+	/*
+	 * if we are changing candidate, mark it as modified, since we need
+	 * this information for locking - according to RFC, candidate cannot
+	 * be locked since it has been modified and not committed.
+	 */
+	if (target == NC_DATASTORE_CANDIDATE) {
+		xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "true");
+	}
+}
+
+static void file_commit_apply(struct ncds_ds_file* file_ds)
+{
+	if (file_candidate_clean(file_ds->candidate)) {
+		/* no changes to commit, the candidate is read from the running */
+		return;
+	}
+
+	/* move the changed content of the candidate into the running, no copy is needed */
+	file_ds->rollback.commit = file_ds->rollback.store;
+	file_drop_content(file_ds, NC_DATASTORE_RUNNING, file_ds->running);
+	file_move_nodes(file_ds->xml, file_ds->candidate->children, file_ds->xml, file_ds->running);
+	xmlSetProp (file_ds->candidate, BAD_CAST "modified", BAD_CAST "false");
+}
+
+static void file_deleteconfig_apply(struct ncds_ds_file* file_ds, NC_DATASTORE target, xmlNodePtr target_ds)
+{
+	file_drop_content(file_ds, target, target_ds);
+
+	/*
+	 * if we are changing the candidate, mark it as modified, since we need
+	 * this information for locking - according to RFC, candidate cannot
+	 * be locked since it has been modified and not committed.
+	 */
+	if (target == NC_DATASTORE_CANDIDATE) {
+		xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "true");
+	}
+}
+
+static void file_lock_apply(xmlNodePtr target_ds, const char* sid, const char* locktime)
+{
+	xmlSetProp (target_ds, BAD_CAST "lock", BAD_CAST sid);
+	xmlSetProp (target_ds, BAD_CAST "locktime", BAD_CAST locktime);
+}
+
+static void file_unlock_apply(NC_DATASTORE target, xmlNodePtr target_ds)
+{
+	xmlNodePtr del;
+
+	if (target == NC_DATASTORE_CANDIDATE) {
+		/* drop the changes of the candidate without decoding them */
+		ncds_bin_discard(target_ds);
+		while ((del = target_ds->children) != NULL) {
+			xmlUnlinkNode (del);
+			xmlFreeNode (del);
+		}
+
+		/* mark candidate as not modified, it is read from the running again */
+		xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "false");
+	}
+
+	/* unlock datastore */
+	xmlSetProp (target_ds, BAD_CAST "lock", BAD_CAST "");
+	xmlSetProp (target_ds, BAD_CAST "locktime", BAD_CAST "");
+}
+
+/**
+ * @brief Apply a record read from the journal to the datastore.
+ *
+ * @param file_ds File datastore structure
+ * @param op Type of the record
+ * @param target Datastore type the record changes
+ * @param arg Additional argument of the operation (default operation of
+ * the edit-config, source of the copy-config)
+ * @param data Data of the record
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_journal_apply(struct ncds_ds_file* file_ds, char op, NC_DATASTORE target, int arg, char* data)
+{
+	xmlNodePtr target_ds, source_ds;
+	xmlDocPtr config_doc;
+	struct nc_err* e = NULL;
+	char *aux;
+	int ret = EXIT_SUCCESS;
+
+	if ((target_ds = file_ds_node(file_ds, target)) == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	switch (op) {
+	case JOURNAL_EDIT:
+		if ((config_doc = file_read_config(data)) == NULL) {
+			return (EXIT_FAILURE);
+		}
+		ret = file_editconfig_apply(file_ds, target, target_ds, config_doc, arg, NC_EDIT_ERROPT_STOP, NULL, &e);
+		xmlFreeDoc(config_doc);
+		if (e != NULL) {
+			nc_err_free(e);
+		}
+		break;
+	case JOURNAL_COPY:
+		if (arg == NC_DATASTORE_CONFIG) {
+			if ((config_doc = file_read_config(data)) == NULL) {
+				return (EXIT_FAILURE);
+			}
+			file_copyconfig_apply(file_ds, target, target_ds, arg, config_doc->children);
+			xmlFreeDoc(config_doc);
+		} else {
+			if ((source_ds = file_ds_content(file_ds, arg)) == NULL) {
+				return (EXIT_FAILURE);
+			}
+			if (target == NC_DATASTORE_RUNNING && arg == NC_DATASTORE_CANDIDATE) {
+				file_commit_apply(file_ds);
+			} else {
+				file_copyconfig_apply(file_ds, target, target_ds, arg, source_ds->children);
+			}
+		}
+		break;
+	case JOURNAL_DELETE:
+		file_deleteconfig_apply(file_ds, target, target_ds);
+		break;
+	case JOURNAL_LOCK:
+		if ((aux = strchr(data, '\n')) == NULL) {
+			return (EXIT_FAILURE);
+		}
+		*aux = '\0';
+		file_lock_apply(target_ds, data, aux + 1);
+		break;
+	case JOURNAL_UNLOCK:
+		file_unlock_apply(target, target_ds);
+		break;
+	default:
+		ret = EXIT_FAILURE;
+		break;
+	}
+
+	return (ret);
+}
+
+static unsigned int file_journal_checksum(unsigned int sum, const char* data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		sum = (sum ^ (unsigned char)data[i]) * 16777619U;
+	}
+
+	return (sum);
+}
+
+/**
+ * @brief Start an empty journal belonging to the current dump of the datastore file.
+ *
+ * @param file_ds File datastore structure
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_journal_reset(struct ncds_ds_file* file_ds)
+{
+	char header[64];
+	int len;
+
+	file_ds->journal.size = 0;
+	file_ds->journal.records = 0;
+
+	len = snprintf(header, sizeof(header), "%s %llu\n", JOURNAL_MAGIC, file_ds->journal.gen);
+	if (ftruncate(file_ds->journal.fd, 0) == -1 ||
+			pwrite(file_ds->journal.fd, header, len, 0) != len ||
+			fdatasync(file_ds->journal.fd) == -1) {
+		ERROR("%s: resetting the journal %s failed (%s)", __func__, file_ds->journal.path, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	file_ds->journal.size = len;
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Replay the journal records not yet applied to the datastore. This
+ * function MUST be called ONLY between file_ds_lock() and file_ds_unlock().
+ *
+ * The replay stops at the first incomplete or damaged record, such a record
+ * is a remnant of a writer crashed in the middle of appending it and it is
+ * overwritten by the next record.
+ *
+ * @param file_ds File datastore structure
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_journal_load(struct ncds_ds_file* file_ds)
+{
+	struct stat statbuf;
+	char *buf, *p, *end, *nl, *data, *aux, op;
+	unsigned long long gen;
+	unsigned int sum;
+	int target, arg, n;
+	size_t len;
+	ssize_t r;
+	off_t from = file_ds->journal.size, done;
+
+	if (fstat(file_ds->journal.fd, &statbuf) == -1) {
+		ERROR("%s: stat() of the journal %s failed (%s)", __func__, file_ds->journal.path, strerror(errno));
+		return (EXIT_FAILURE);
+	}
+	if (statbuf.st_size <= from) {
+		return (EXIT_SUCCESS);
+	}
+
+	if ((buf = malloc(statbuf.st_size - from + 1)) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (EXIT_FAILURE);
+	}
+	for (done = 0; done < statbuf.st_size - from; done += r) {
+		if ((r = pread(file_ds->journal.fd, buf + done, statbuf.st_size - from - done, from + done)) <= 0) {
+			if (r == -1 && errno == EINTR) {
+				r = 0;
+				continue;
+			}
+			break;
+		}
+	}
+	buf[done] = '\0';
+	p = buf;
+	end = buf + done;
+
+	if (from == 0) {
+		/* check that the journal belongs to the current dump of the datastore file */
+		if ((nl = memchr(p, '\n', end - p)) == NULL || sscanf(p, JOURNAL_MAGIC" %llu\n", &gen) != 1 || gen != file_ds->journal.gen) {
+			/* stale journal left by a compaction interrupted after the dump */
+			free(buf);
+			return (EXIT_SUCCESS);
+		}
+		p = nl + 1;
+	}
+
+	while ((nl = memchr(p, '\n', end - p)) != NULL) {
+		*nl = '\0';
+		if (sscanf(p, "%c %d %d %zu %x%n", &op, &target, &arg, &len, &sum, &n) != 5 || p + n != nl) {
+			break;
+		}
+		data = nl + 1;
+		if (len >= (size_t)(end - data) || data[len] != '\n') {
+			break;
+		}
+		aux = strrchr(p, ' ');
+		if (file_journal_checksum(file_journal_checksum(JOURNAL_CHECKSUM_INIT, p, aux - p), data, len) != sum) {
+			break;
+		}
+		data[len] = '\0';
+
+		if (file_journal_apply(file_ds, op, target, arg, data)) {
+			ERROR("%s: applying record %u of the journal %s failed, ignoring the rest of the journal.", __func__, file_ds->journal.records + 1, file_ds->journal.path);
+			break;
+		}
+		file_ds->journal.records++;
+		p = data + len + 1;
+	}
+	file_ds->journal.size = from + (p - buf);
+
+	free(buf);
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Announce a change of the datastore to the other processes. This
+ * function MUST be called ONLY between file_ds_lock() and file_ds_unlock().
+ */
+static void file_gen_bump(struct ncds_ds_file* file_ds)
+{
+	if (file_ds->ds_lock.shared != NULL) {
+		file_ds->ds_lock.gen = ++(file_ds->ds_lock.shared->gen);
+	}
+}
+
+/**
+ * @brief Load the changes of the datastore file and the journal, see file_reload().
+ */
+static int file_reload_file(struct ncds_ds_file* file_ds, time_t t)
+{
+	xmlDocPtr new_xml;
+	xmlChar* gen;
+	struct stat statbuf;
+	struct ncds_bin_image image;
+
+	/* check if the file was replaced */
+	if (stat(file_ds->path, &statbuf) == 0) {
+		if (file_id_match(file_ds, &statbuf)) {
+			/* file was not modified, only replay the new journal records */
+			if (file_ds->journal.fd == -1) {
+				return (EXIT_SUCCESS);
+			}
+			if (fstat(file_ds->journal.fd, &statbuf) == 0 && statbuf.st_size >= file_ds->journal.size) {
+				return (file_journal_load(file_ds));
+			}
+			/* journal was compacted in the meantime */
+		}
+	}
+
+	/* file was replaced, reopen it */
+	fclose(file_ds->file);
+	file_ds->file = fopen(file_ds->path, "r+");
+	if (file_ds->file == NULL) {
+		ERROR("%s: reopenening the file %s failed (%s)", __func__, file_ds->path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/* read exactly the opened file, so its identification matches the content */
+	if (fstat(fileno(file_ds->file), &statbuf) == -1) {
+		ERROR("%s: stat() of the file %s failed (%s)", __func__, file_ds->path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	new_xml = file_read(file_ds, fileno(file_ds->file), file_ds->path, &image);
+	if (new_xml == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	xmlFreeDoc (file_ds->xml);
+	file_ds->xml = new_xml;
+	ncds_bin_close(&file_ds->bin);
+	file_ds->bin = image;
+
+	if (file_fill_dsnodes (file_ds)) {
+		xmlFreeDoc (new_xml);
+		return EXIT_FAILURE;
+	}
+
+	/* update access time */
+	file_ds->ds.last_access = t;
+	file_id_set(file_ds, &statbuf);
+
+	/* replay the whole journal of this file dump */
+	gen = xmlGetProp(xmlDocGetRootElement(file_ds->xml), BAD_CAST "journal");
+	file_ds->journal.gen = (gen != NULL) ? strtoull((char*)gen, NULL, 10) : 0;
+	xmlFree(gen);
+	file_ds->journal.size = 0;
+	file_ds->journal.records = 0;
+	if (file_ds->journal.fd != -1) {
+		return (file_journal_load(file_ds));
 	}
-	umask(mask);
-	free (sempath);
 
-	return (EXIT_SUCCESS);
+	return EXIT_SUCCESS;
+
 }
 
-void ncds_file_free(struct ncds_ds* ds)
+/**
+ * @brief Check if the xml is up to date, i.e. no change was announced in the
+ * shared memory and the datastore file was checked recently.
+ */
+static int file_fresh(struct ncds_ds_file* file_ds, time_t t)
 {
-	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
-
-	if (file_ds != NULL) {
-		/* ncds_ds_file specific part */
-		if (file_ds->file != NULL) {
-			fclose(file_ds->file);
-		}
-		free(file_ds->path);
-		xmlFreeDoc(file_ds->xml);
-		xmlFreeDoc(file_ds->xml_rollback);
-		if (file_ds->ds_lock.lock != NULL) {
-			if (file_ds->ds_lock.holding_lock) {
-				sem_post (file_ds->ds_lock.lock);
-			}
-			sem_close(file_ds->ds_lock.lock);
-		}
-	}
+	return (file_ds->ds_lock.shared != NULL && file_ds->ds.last_access != 0 &&
+			file_ds->ds_lock.shared->gen == file_ds->ds_lock.gen &&
+			t >= file_ds->ds_lock.checked && t - file_ds->ds_lock.checked < NCDS_FILE_CHECK_INTERVAL);
 }
 
 /**
@@ -541,7 +1798,11 @@ void ncds_file_free(struct ncds_ds* ds)
  *
  * Tries to read from the datastore and find the datastore root elements.
  * If succussfully, the old xml is freed and replaced with a new one.
- * If it fails, the structure is preserved as it was.
+ * If it fails, the structure is preserved as it was. Then the changes
+ * appended to the journal are replayed. The file is not checked at all
+ * when no change was announced in the shared memory (except the changes
+ * made outside libnetconf, which are checked once per
+ * NCDS_FILE_CHECK_INTERVAL).
  *
  * @param file_ds Pointer to the datastorage structure
  *
@@ -549,8 +1810,6 @@ void ncds_file_free(struct ncds_ds* ds)
  */
 static int file_reload(struct ncds_ds_file* file_ds)
 {
-	xmlDocPtr new_xml;
-	struct stat statbuf;
 	time_t t;
 
 	if (file_ds == NULL || !file_ds->ds_lock.holding_lock) {
@@ -564,45 +1823,95 @@ static int file_reload(struct ncds_ds_file* file_ds)
 		WARN("Setting datastore access time failed (%s)", strerror(errno));
 	}
 
-	/* check when the file was modified */
-	if (stat(file_ds->path, &statbuf) == 0) {
-		if (statbuf.st_mtime < file_ds->ds.last_access) {
-			/* file was not modified */
-			return (EXIT_SUCCESS);
-		}
+	/* changes replayed from other processes are not a part of any rollback */
+	file_ds->rollback.store = 0;
+
+	if (file_fresh(file_ds, t)) {
+		/* nothing changed since the last access */
+		return (EXIT_SUCCESS);
 	}
 
-	/* file was modified, it may be necessary to reopen it */
-	fclose(file_ds->file);
-	file_ds->file = fopen(file_ds->path, "r+");
-	if (file_ds->file == NULL) {
-		ERROR("%s: reopenening the file %s failed (%s)", __func__, file_ds->path, strerror(errno));
-		return EXIT_FAILURE;
+	if (file_ds->shm_image != NULL && file_ds->ds.last_access != 0 && file_ds->ds_lock.shared != NULL &&
+			file_ds->ds_lock.gen == file_ds->ds_lock.shared->gen &&
+			file_ds->ds_lock.shared->image_gen == file_ds->ds_lock.gen) {
+		/* the xml is the published image, the file is not checked at all */
+		file_ds->ds_lock.checked = t;
+		return (EXIT_SUCCESS);
+	} else if (file_shm_attach(file_ds, t) == EXIT_SUCCESS) {
+		return (EXIT_SUCCESS);
 	}
 
-	new_xml = xmlReadFile (file_ds->path, NULL, NC_XMLREAD_OPTIONS);
-	if (new_xml == NULL) {
-		return EXIT_FAILURE;
+	if (file_reload_file(file_ds, t)) {
+		return (EXIT_FAILURE);
+	}
+	file_ds->ds_lock.checked = t;
+	if (file_ds->ds_lock.shared != NULL) {
+		file_ds->ds_lock.gen = file_ds->ds_lock.shared->gen;
 	}
 
-	xmlFreeDoc (file_ds->xml);
-	file_ds->xml = new_xml;
+	return (EXIT_SUCCESS);
+}
 
-	if (file_fill_dsnodes (file_ds)) {
-		xmlFreeDoc (new_xml);
-		return EXIT_FAILURE;
+/**
+ * @brief Get shared access to the datastore for a read-only operation and
+ * reload the xml if needed. The access must be released by file_rdunlock().
+ *
+ * The readers of one process share the xml, so the first of them noticing
+ * a change reloads it with the local lock held exclusively. The same way,
+ * the content of the binary datastore is decoded by the first reader
+ * accessing it.
+ *
+ * @param file_ds File datastore structure
+ * @param target Datastore type to read
+ *
+ * @return 0 on success, 1 when the locking timed out, -1 when the reload
+ * failed (the access is released then)
+ */
+static int file_rdlock(struct ncds_ds_file* file_ds, NC_DATASTORE target)
+{
+	int ret;
+
+	if (file_lock_wait(file_ds, 0)) {
+		return (1);
 	}
 
-	/* update access time */
-	file_ds->ds.last_access = t;
+	pthread_rwlock_rdlock(&file_ds->ds_lock.local);
+	if (!file_fresh(file_ds, time(NULL)) || file_pending(file_ds, target)) {
+		pthread_rwlock_unlock(&file_ds->ds_lock.local);
+		pthread_rwlock_wrlock(&file_ds->ds_lock.local);
+		/* no writer can run now, we share its lock */
+		file_ds->ds_lock.holding_lock = 1;
+		file_cache_drop(file_ds);
+		ret = file_reload(file_ds);
+		if (ret == EXIT_SUCCESS && file_pending(file_ds, target) && file_ds_content(file_ds, target) == NULL) {
+			ret = EXIT_FAILURE;
+		}
+		file_ds->ds_lock.holding_lock = 0;
+		pthread_rwlock_unlock(&file_ds->ds_lock.local);
+		if (ret) {
+			file_lock_release(file_ds);
+			return (-1);
+		}
+		pthread_rwlock_rdlock(&file_ds->ds_lock.local);
+	}
 
-	return EXIT_SUCCESS;
+	return (0);
+}
 
+static void file_rdunlock(struct ncds_ds_file* file_ds)
+{
+	pthread_rwlock_unlock(&file_ds->ds_lock.local);
+	file_lock_release(file_ds);
 }
 
 /**
- * @brief Write the current version of the configuration to a file. This function MUST be
- * called ONLY between file_ds_lock() and file_ds_unlock().
+ * @brief Write the current version of the configuration to a file and start
+ * a new journal. This function MUST be called ONLY between file_ds_lock() and
+ * file_ds_unlock().
+ *
+ * The configuration is written into a temporary file, which then replaces
+ * the datastore file, so the datastore file always contains a complete
+ * configuration, even after a crash in the middle of writing it.
  *
  * @param file_ds Datastore to sync.
  *
@@ -610,6 +1919,10 @@ static int file_reload(struct ncds_ds_file* file_ds)
  */
 static int file_sync(struct ncds_ds_file* file_ds)
 {
+	char gen[24], *path = NULL, *tmp_path = NULL, *name;
+	struct stat statbuf;
+	FILE* tmp_file = NULL;
+	int fd = -1, dir_fd;
 	time_t t;
 
 	if (file_ds == NULL || !file_ds->ds_lock.holding_lock) {
@@ -617,17 +1930,64 @@ static int file_sync(struct ncds_ds_file* file_ds)
 		return EXIT_FAILURE;
 	}
 
-	/* erase actual config */
-	if (ftruncate (fileno(file_ds->file), 0) == -1) {
-		ERROR ("%s: truncate() of file %s failed (%s)", __func__, file_ds->path, strerror(errno));
-		return EXIT_FAILURE;
-	}
-	rewind (file_ds->file);
+	/* mark the dump so that the journal of the previous one is not replayed on it */
+	snprintf(gen, sizeof(gen), "%llu", file_ds->journal.gen + 1);
+	xmlSetProp(xmlDocGetRootElement(file_ds->xml), BAD_CAST "journal", BAD_CAST gen);
 
-	if(xmlDocFormatDump(file_ds->file, file_ds->xml, 1) == -1) {
-		ERROR("%s: storing repository into the file %s failed.", __func__, file_ds->path);
+	/* create the temporary file in the same directory as the (real) datastore file */
+	if ((path = realpath(file_ds->path, NULL)) == NULL) {
+		ERROR("%s: resolving the path %s failed (%s)", __func__, file_ds->path, strerror(errno));
 		return (EXIT_FAILURE);
 	}
+	name = strrchr(path, '/');
+	if (asprintf(&tmp_path, "%.*s/.%s.XXXXXX", (int)(name - path), path, name + 1) == -1) {
+		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		free(path);
+		return (EXIT_FAILURE);
+	}
+	if ((fd = mkstemp(tmp_path)) == -1 || (tmp_file = fdopen(fd, "r+")) == NULL) {
+		ERROR("%s: creating a temporary file %s failed (%s)", __func__, tmp_path, strerror(errno));
+		goto error;
+	}
+
+	/* keep the permissions of the replaced file */
+	if (fstat(fileno(file_ds->file), &statbuf) == 0) {
+		if (fchmod(fd, statbuf.st_mode & 07777) == -1 || fchown(fd, statbuf.st_uid, statbuf.st_gid) == -1) {
+			VERB("%s: keeping the permissions of the file %s failed (%s)", __func__, file_ds->path, strerror(errno));
+		}
+	}
+
+	if (file_write(file_ds, tmp_file) || fflush(tmp_file) != 0 || fsync(fd) == -1) {
+		ERROR("%s: storing repository into the file %s failed.", __func__, tmp_path);
+		goto error;
+	}
+
+	if (rename(tmp_path, path) == -1) {
+		ERROR("%s: replacing the file %s failed (%s)", __func__, path, strerror(errno));
+		goto error;
+	}
+
+	/* the dump (i.e. the rename) must be on the disk before its journal is dropped */
+	*name = '\0';
+	if ((dir_fd = open((name == path) ? "/" : path, O_RDONLY)) != -1) {
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+
+	fclose(file_ds->file);
+	file_ds->file = tmp_file;
+	if (fstat(fd, &statbuf) == 0) {
+		file_id_set(file_ds, &statbuf);
+	}
+	file_gen_bump(file_ds);
+	free(tmp_path);
+	free(path);
+
+	file_ds->journal.gen++;
+	if (file_ds->journal.fd != -1 && file_journal_reset(file_ds)) {
+		/* the old journal is ignored anyway, try it again with the next change */
+		file_ds->journal.size = 0;
+	}
 
 	/* update last access time */
 	if ((t = time(NULL)) == ((time_t)(-1))) {
@@ -637,8 +1997,166 @@ static int file_sync(struct ncds_ds_file* file_ds)
 	}
 
 	return EXIT_SUCCESS;
+
+error:
+	if (tmp_file != NULL) {
+		fclose(tmp_file);
+	} else if (fd != -1) {
+		close(fd);
+	}
+	if (fd != -1) {
+		unlink(tmp_path);
+	}
+	free(tmp_path);
+	free(path);
+
+	return (EXIT_FAILURE);
+}
+
+/**
+ * @brief Store a change of the datastore by appending it to the journal. This
+ * function MUST be called ONLY between file_ds_lock() and file_ds_unlock(),
+ * after the change was applied to the xml. If the journal cannot be used, the
+ * whole datastore is written by file_sync().
+ *
+ * @param file_ds Datastore to sync.
+ * @param op Type of the change.
+ * @param target Changed datastore type.
+ * @param arg Additional argument of the change for file_journal_apply().
+ * @param data Data of the change, can be NULL.
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int file_journal_append(struct ncds_ds_file* file_ds, char op, NC_DATASTORE target, int arg, const char* data)
+{
+	char *header = NULL, *record = NULL;
+	struct stat statbuf;
+	size_t len;
+	int hlen, rlen;
+	ssize_t r;
+	off_t done;
+
+	if (file_ds->journal.fd == -1) {
+		return (file_sync(file_ds));
+	}
+
+	if (data == NULL) {
+		data = "";
+	}
+	len = strlen(data);
+
+	if (file_ds->journal.size == 0) {
+		/* the journal belongs to the previous dump of the datastore */
+		if (file_journal_reset(file_ds)) {
+			return (file_sync(file_ds));
+		}
+	} else if (fstat(file_ds->journal.fd, &statbuf) == -1 || (statbuf.st_size != file_ds->journal.size &&
+			ftruncate(file_ds->journal.fd, file_ds->journal.size) == -1)) {
+		/* cannot drop a damaged tail of the journal */
+		return (file_sync(file_ds));
+	}
+
+	if ((hlen = asprintf(&header, "%c %d %d %zu", op, target, arg, len)) == -1 ||
+			(rlen = asprintf(&record, "%s %08x\n%s\n", header,
+					file_journal_checksum(file_journal_checksum(JOURNAL_CHECKSUM_INIT, header, hlen), data, len), data)) == -1) {
+		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		free(header);
+		return (EXIT_FAILURE);
+	}
+	free(header);
+
+	for (done = 0; done < rlen; done += r) {
+		if ((r = pwrite(file_ds->journal.fd, record + done, rlen - done, file_ds->journal.size + done)) == -1) {
+			if (errno == EINTR) {
+				r = 0;
+				continue;
+			}
+			break;
+		}
+	}
+	free(record);
+	if (done < rlen || fdatasync(file_ds->journal.fd) == -1) {
+		ERROR("%s: writing into the journal %s failed (%s)", __func__, file_ds->journal.path, strerror(errno));
+		return (file_sync(file_ds));
+	}
+	file_ds->journal.size += rlen;
+	file_ds->journal.records++;
+	file_gen_bump(file_ds);
+
+	/* compact the journal if it is getting too long */
+	if (file_ds->journal.records >= NCDS_FILE_JOURNAL_RECORDS_MAX ||
+			(!file_ds->compact.running && file_ds->journal.records >= NCDS_FILE_JOURNAL_RECORDS)) {
+		return (file_sync(file_ds));
+	} else if (file_ds->journal.records >= NCDS_FILE_JOURNAL_RECORDS || file_ds->journal.size >= NCDS_FILE_JOURNAL_SIZE) {
+		pthread_mutex_lock(&file_ds->compact.mutex);
+		file_ds->compact.request = 1;
+		pthread_cond_signal(&file_ds->compact.cond);
+		pthread_mutex_unlock(&file_ds->compact.mutex);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Thread compacting the journal into the datastore file when asked by
+ * file_journal_append().
+ */
+static void* file_compact_thread(void* arg)
+{
+	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)arg;
+	int ret;
+
+	pthread_mutex_lock(&file_ds->compact.mutex);
+	while (!file_ds->compact.quit) {
+		if (!file_ds->compact.request) {
+			pthread_cond_wait(&file_ds->compact.cond, &file_ds->compact.mutex);
+			continue;
+		}
+		file_ds->compact.request = 0;
+		pthread_mutex_unlock(&file_ds->compact.mutex);
+
+		LOCK(file_ds, ret);
+		if (ret == 0) {
+			/* the journal could have been compacted meanwhile, e.g. by another process */
+			if (file_reload(file_ds) == EXIT_SUCCESS && file_ds->journal.size > 0 &&
+					(file_ds->journal.records >= NCDS_FILE_JOURNAL_RECORDS || file_ds->journal.size >= NCDS_FILE_JOURNAL_SIZE)) {
+				file_sync(file_ds);
+			}
+			UNLOCK(file_ds);
+		}
+
+		pthread_mutex_lock(&file_ds->compact.mutex);
+	}
+	pthread_mutex_unlock(&file_ds->compact.mutex);
+
+	return (NULL);
+}
+
+/**
+ * @brief Free the version of the datastore kept for the rollback.
+ *
+ * @param file_ds File datastore structure
+ */
+static void file_rollback_free(struct ncds_ds_file* file_ds)
+{
+	xmlFreeDoc(file_ds->rollback.doc);
+	file_ds->rollback.doc = NULL;
+	xmlFree(file_ds->rollback.modified);
+	file_ds->rollback.modified = NULL;
+	file_ds->rollback.valid = 0;
+	file_ds->rollback.store = 0;
+	file_ds->rollback.commit = 0;
 }
 
+/**
+ * @brief Mark the current state of the datastore as the one to return to
+ * by file_rollback_restore(). Nothing is copied, the content replaced by the
+ * following operation is kept instead of being freed.
+ *
+ * @param file_ds File datastore structure
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
 static int file_rollback_store(struct ncds_ds_file* file_ds)
 {
 	if (file_ds == NULL) {
@@ -646,30 +2164,56 @@ static int file_rollback_store(struct ncds_ds_file* file_ds)
 		return (EXIT_FAILURE);
 	}
 
-	xmlFreeDoc(file_ds->xml_rollback);
-	file_ds->xml_rollback = xmlCopyDoc(file_ds->xml, 1);
+	file_rollback_free(file_ds);
+	file_ds->rollback.valid = 1;
+	file_ds->rollback.store = 1;
 
 	return (EXIT_SUCCESS);
 }
 
 static int file_rollback_restore(struct ncds_ds_file* file_ds)
 {
+	xmlNodePtr target_ds, candidate, del;
+
 	if (file_ds == NULL || !file_ds->ds_lock.holding_lock) {
 		ERROR("%s: invalid parameter.", __func__);
 		return (EXIT_FAILURE);
 	}
 
-	if (file_ds->xml_rollback == NULL) {
+	if (!file_ds->rollback.valid) {
 		ERROR("No backup repository for rollback operation (datastore %d).", file_ds->ds.id);
 		return (EXIT_FAILURE);
 	}
 
-	xmlFreeDoc(file_ds->xml);
-	file_ds->xml = file_ds->xml_rollback;
-	file_ds->xml_rollback = NULL;
-	file_ds->ds.last_access = 0;
+	if (file_ds->rollback.doc == NULL) {
+		/* the operation did not change the datastore */
+		file_rollback_free(file_ds);
+		return (EXIT_SUCCESS);
+	}
 
-	file_fill_dsnodes(file_ds);
+	/* put back the replaced content */
+	if ((target_ds = file_ds_node(file_ds, file_ds->rollback.target)) == NULL) {
+		return (EXIT_FAILURE);
+	}
+	if (file_ds->rollback.commit) {
+		/* the committed changes are the changes of the candidate again */
+		if ((candidate = file_ds_node(file_ds, NC_DATASTORE_CANDIDATE)) == NULL) {
+			return (EXIT_FAILURE);
+		}
+		file_move_nodes(file_ds->xml, target_ds->children, file_ds->xml, candidate);
+		xmlSetProp(candidate, BAD_CAST "modified", BAD_CAST "true");
+	}
+	while ((del = target_ds->children) != NULL) {
+		xmlUnlinkNode(del);
+		xmlFreeNode(del);
+	}
+	file_move_nodes(file_ds->rollback.doc, xmlDocGetRootElement(file_ds->rollback.doc)->children, file_ds->xml, target_ds);
+	if (file_ds->rollback.modified != NULL) {
+		xmlSetProp(target_ds, BAD_CAST "modified", file_ds->rollback.modified);
+	} else {
+		xmlUnsetProp(target_ds, BAD_CAST "modified");
+	}
+	file_rollback_free(file_ds);
 
 	return (file_sync(file_ds));
 }
@@ -680,7 +2224,7 @@ int ncds_file_rollback(struct ncds_ds* ds)
 
 	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
 
-	if (file_ds == NULL || file_ds->ds.type != NCDS_TYPE_FILE) {
+	if (file_ds == NULL || (file_ds->ds.type != NCDS_TYPE_FILE && file_ds->ds.type != NCDS_TYPE_BIN && file_ds->ds.type != NCDS_TYPE_SHM)) {
 		return (EXIT_FAILURE);
 	}
 
@@ -758,7 +2302,7 @@ int ncds_file_lock(struct ncds_ds* ds, const struct nc_session* session, NC_DATA
 	xmlNodePtr target_ds;
 	struct nc_session* no_session;
 	int retval = EXIT_SUCCESS, ret;
-	char* t;
+	char *t, *record;
 
 	assert(error);
 
@@ -811,14 +2355,18 @@ int ncds_file_lock(struct ncds_ds* ds, const struct nc_session* session, NC_DATA
 			nc_err_set(*error, NC_ERR_PARAM_MSG, "Candidate datastore not locked but already modified.");
 			retval = EXIT_FAILURE;
 		} else {
-			xmlSetProp (target_ds, BAD_CAST "lock", BAD_CAST session->session_id);
-			xmlSetProp (target_ds, BAD_CAST "locktime", BAD_CAST (t = nc_time2datetime(time(NULL), NULL)));
+			t = nc_time2datetime(time(NULL), NULL);
+			file_lock_apply(target_ds, session->session_id, t);
+			if (asprintf(&record, "%s\n%s", session->session_id, t) == -1) {
+				record = NULL;
+			}
 			free(t);
-			if (file_sync(file_ds)) {
+			if (record == NULL || file_journal_append(file_ds, JOURNAL_LOCK, target, 0, record)) {
 				*error = nc_err_new(NC_ERR_OP_FAILED);
 				nc_err_set(*error, NC_ERR_PARAM_MSG, "Datastore file synchronisation failed.");
 				retval = EXIT_FAILURE;
 			}
+			free(record);
 		}
 		xmlFree(modified);
 	}
@@ -833,7 +2381,7 @@ int ncds_file_lock(struct ncds_ds* ds, const struct nc_session* session, NC_DATA
 int ncds_file_unlock(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE target, struct nc_err** error)
 {
 	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
-	xmlNodePtr target_ds, del;
+	xmlNodePtr target_ds;
 	struct nc_session* no_session;
 	int retval = EXIT_SUCCESS, ret;
 
@@ -885,25 +2433,8 @@ int ncds_file_unlock(struct ncds_ds* ds, const struct nc_session* session, NC_DA
 		retval = EXIT_FAILURE;
 	} else {
 		/* the datastore is locked by request originating session */
-
-		if (target == NC_DATASTORE_CANDIDATE) {
-			/* drop current candidate configuration */
-			while ((del = file_ds->candidate->children) != NULL) {
-				xmlUnlinkNode (file_ds->candidate->children);
-				xmlFreeNode (del);
-			}
-
-			/* copy running into candidate configuration */
-			xmlAddChildList(file_ds->candidate, xmlCopyNodeList(file_ds->running->children));
-
-			/* mark candidate as not modified */
-			xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "false");
-		}
-
-		/* unlock datastore */
-		xmlSetProp (target_ds, BAD_CAST "lock", BAD_CAST "");
-		xmlSetProp (target_ds, BAD_CAST "locktime", BAD_CAST "");
-		if (file_sync(file_ds)) {
+		file_unlock_apply(target, target_ds);
+		if (file_journal_append(file_ds, JOURNAL_UNLOCK, target, 0, NULL)) {
 			*error = nc_err_new(NC_ERR_OP_FAILED);
 			nc_err_set(*error, NC_ERR_PARAM_MSG, "Datastore file synchronisation failed.");
 			retval = EXIT_FAILURE;
@@ -920,95 +2451,167 @@ int ncds_file_unlock(struct ncds_ds* ds, const struct nc_session* session, NC_DA
 	return (retval);
 }
 
+/**
+ * @brief Get shared access to the content of the datastore for the getconfig.
+ *
+ * @return xml node of the datastore, NULL on error with the error filled.
+ * The access must be released by file_rdunlock() on success.
+ */
+static xmlNodePtr file_getconfig_rdlock(struct ncds_ds_file* file_ds, NC_DATASTORE source, struct nc_err** error)
+{
+	int ret;
+
+	/* check validity of function parameters */
+	if (file_cache_slot(file_ds, source) == NULL) {
+		ERROR("%s: invalid target.", __func__);
+		*error = nc_err_new(NC_ERR_BAD_ELEM);
+		nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "source");
+		return (NULL);
+	}
+
+	if ((ret = file_rdlock(file_ds, source)) == 1) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		nc_err_set(*error, NC_ERR_PARAM_MSG, "Locking datastore file timeouted.");
+		return (NULL);
+	} else if (ret) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		return (NULL);
+	}
+
+	/* the content is ready, file_rdlock() decoded it */
+	return (file_ds_content(file_ds, source));
+}
+
 char* ncds_file_getconfig(struct ncds_ds* ds, const struct nc_session* UNUSED(session), NC_DATASTORE source, struct nc_err** error)
 {
 	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
 	xmlNodePtr target_ds, aux_node;
 	xmlBufferPtr resultbuffer;
-	char* data = NULL;
-	int ret;
+	char* data = NULL, **cached;
 
 	assert(error);
 
-	LOCK(file_ds, ret);
-	if (ret) {
+	if ((target_ds = file_getconfig_rdlock(file_ds, source, error)) == NULL) {
+		return (NULL);
+	}
+	/* the candidate without any changes shares the serialized running */
+	cached = file_cache_slot(file_ds, (target_ds == file_ds->running) ? NC_DATASTORE_RUNNING : source);
+
+	/* the serialized content is kept until the datastore is changed */
+	pthread_mutex_lock(&file_ds->cache.lock);
+	if (*cached != NULL) {
+		data = strdup(*cached);
+		pthread_mutex_unlock(&file_ds->cache.lock);
+		file_rdunlock(file_ds);
+		if (data == NULL) {
+			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+			*error = nc_err_new(NC_ERR_OP_FAILED);
+		}
+		return (data);
+	}
+	pthread_mutex_unlock(&file_ds->cache.lock);
+
+	/* the xml is not changed while shared, other readers may dump it meanwhile */
+	resultbuffer = xmlBufferCreate();
+	if (resultbuffer == NULL) {
+		file_rdunlock(file_ds);
+		ERROR("%s: xmlBufferCreate failed (%s:%d).", __func__, __FILE__, __LINE__);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
-		nc_err_set(*error, NC_ERR_PARAM_MSG, "Locking datastore file timeouted.");
-		return NULL;
+		return (NULL);
+	}
+	for (aux_node = target_ds->children; aux_node != NULL; aux_node = aux_node->next) {
+		xmlNodeDump(resultbuffer, file_ds->xml, aux_node, 2, 1);
+	}
+	data = nc_clrwspace((char *) xmlBufferContent(resultbuffer));
+	xmlBufferFree(resultbuffer);
+
+	if (data != NULL) {
+		pthread_mutex_lock(&file_ds->cache.lock);
+		if (*cached == NULL) {
+			*cached = strdup(data);
+		}
+		pthread_mutex_unlock(&file_ds->cache.lock);
 	}
 
-	if (file_reload (file_ds)) {
-		UNLOCK(file_ds);
-		return NULL;
+	file_rdunlock(file_ds);
+	if (data == NULL) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
 	}
+	return (data);
+}
 
-	/* check validity of function parameters */
-	switch(source) {
-	case NC_DATASTORE_RUNNING:
-		target_ds = file_ds->running;
-		break;
-	case NC_DATASTORE_STARTUP:
-		target_ds = file_ds->startup;
-		break;
-	case NC_DATASTORE_CANDIDATE:
-		target_ds = file_ds->candidate;
-		break;
-	default:
-		UNLOCK(file_ds);
-		ERROR("%s: invalid target.", __func__);
-		*error = nc_err_new(NC_ERR_BAD_ELEM);
-		nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "source");
+xmlDocPtr ncds_file_getconfig_xml(struct ncds_ds* ds, const struct nc_session* UNUSED(session), NC_DATASTORE source, struct nc_err** error)
+{
+	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
+	xmlNodePtr target_ds, aux_node, node;
+	xmlDocPtr doc;
+
+	assert(error);
+
+	if ((target_ds = file_getconfig_rdlock(file_ds, source, error)) == NULL) {
 		return (NULL);
-		break;
 	}
 
-	resultbuffer = xmlBufferCreate();
-	if (resultbuffer == NULL) {
-		UNLOCK(file_ds);
-		ERROR("%s: xmlBufferCreate failed (%s:%d).", __func__, __FILE__, __LINE__);
+	if ((doc = xmlNewDoc(BAD_CAST "1.0")) == NULL) {
+		file_rdunlock(file_ds);
+		ERROR("%s: xmlNewDoc failed (%s:%d).", __func__, __FILE__, __LINE__);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
 		return (NULL);
 	}
+
+	/* the same form as parsed from the serialized data, only the elements on the top level */
 	for (aux_node = target_ds->children; aux_node != NULL; aux_node = aux_node->next) {
-		xmlNodeDump(resultbuffer, file_ds->xml, aux_node, 2, 1);
+		if (aux_node->type != XML_ELEMENT_NODE) {
+			continue;
+		}
+		if ((node = xmlDocCopyNode(aux_node, doc, 1)) == NULL) {
+			file_rdunlock(file_ds);
+			xmlFreeDoc(doc);
+			ERROR("%s: xmlDocCopyNode failed (%s:%d).", __func__, __FILE__, __LINE__);
+			*error = nc_err_new(NC_ERR_OP_FAILED);
+			return (NULL);
+		}
+		if (doc->children == NULL) {
+			xmlDocSetRootElement(doc, node);
+		} else {
+			xmlAddNextSibling(doc->last, node);
+		}
 	}
-	data = nc_clrwspace((char *) xmlBufferContent(resultbuffer));
-	xmlBufferFree(resultbuffer);
 
-	UNLOCK(file_ds);
-	return (data);
+	file_rdunlock(file_ds);
+	return (doc);
 }
 
 /**
- * @brief Copy the content of the datastore or externally send
- * the configuration to another datastore
- *
- * @param ds Pointer to a datastore structure
- * @param session Session which the request is a part of
- * @param rpc RPC message with the request
- * @param target Target datastore.
- * @param source Source datastore, if the value is NC_DATASTORE_NONE
- * then the next parameter holds the configration to copy
- * @param config Configuration to be used as the source in the form of a serialized XML.
- * @param error	 Netconf error structure.
+ * @brief Copy the configuration into the datastore, common part of
+ * ncds_file_copyconfig() and ncds_file_copyconfig_xml().
  *
- * @return EXIT_SUCCESS when done without problems
- * 	   EXIT_FAILURE when error occured
- * 	   EXIT_RPC_NOT_APPLICABLE when rpc is not applicable
+ * @param config_doc Source configuration in the form of file_read_config(),
+ * NULL if the source is a datastore.
+ * @param config Serialized source configuration for the journal, NULL to
+ * serialize the config_doc.
  */
-int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, char * config, struct nc_err **error)
+static int file_copyconfig(struct ncds_ds_file* file_ds, const struct nc_session *session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, xmlDocPtr config_doc, const char* config, struct nc_err **error)
 {
-	struct ncds_ds_file* file_ds = (struct ncds_ds_file*)ds;
-	xmlDocPtr config_doc = NULL, aux_doc;
-	xmlNodePtr target_ds, source_ds, aux_node, root;
+	xmlDocPtr aux_doc;
+	xmlNodePtr target_ds, target_content, source_ds, aux_node, root;
 	keyList keys;
-	char *aux = NULL, *configp;
-	int r, ret = 0;
+	char *data = NULL;
+	int r, ret = 0, filtered = 0, commit;
 
 	assert(error);
 
+	if (source == NC_DATASTORE_CONFIG && config_doc != NULL && config == NULL && file_ds->journal.fd != -1) {
+		if ((data = file_dump_config(config_doc)) == NULL) {
+			*error = nc_err_new(NC_ERR_OP_FAILED);
+			return EXIT_FAILURE;
+		}
+		config = data;
+	}
+
 	LOCK(file_ds, ret);
 	if (ret) {
+		free(data);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
 		nc_err_set(*error, NC_ERR_PARAM_MSG, "Locking datastore file timeouted.");
 		return EXIT_FAILURE;
@@ -1016,22 +2619,24 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 
 	if (file_reload (file_ds)) {
 		UNLOCK(file_ds);
+		free(data);
 		return EXIT_FAILURE;
 	}
 	file_rollback_store(file_ds);
 
 	switch(target) {
 	case NC_DATASTORE_RUNNING:
-		target_ds = file_ds->running;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_RUNNING);
 		break;
 	case NC_DATASTORE_STARTUP:
-		target_ds = file_ds->startup;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_STARTUP);
 		break;
 	case NC_DATASTORE_CANDIDATE:
-		target_ds = file_ds->candidate;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_CANDIDATE);
 		break;
 	default:
 		UNLOCK(file_ds);
+		free(data);
 		ERROR("%s: invalid target.", __func__);
 		*error = nc_err_new(NC_ERR_BAD_ELEM);
 		nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "target");
@@ -1039,9 +2644,18 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 		break;
 	}
 
+	if (target_ds == NULL || (target_content = file_ds_content(file_ds, target)) == NULL) {
+		/* decoding the binary datastore failed */
+		UNLOCK(file_ds);
+		free(data);
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		return EXIT_FAILURE;
+	}
+
 	/* isn't target locked? */
 	if (file_ds_access (file_ds, target, session) != 0) {
 		UNLOCK(file_ds);
+		free(data);
 		*error = nc_err_new (NC_ERR_IN_USE);
 		return EXIT_FAILURE;
 	}
@@ -1049,6 +2663,7 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 		/* commit - check also the lock on source (i.e. candidate) datastore */
 		if (file_ds_access (file_ds, source, session) != 0) {
 			UNLOCK(file_ds);
+			free(data);
 			*error = nc_err_new (NC_ERR_IN_USE);
 			return EXIT_FAILURE;
 		}
@@ -1056,55 +2671,30 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 
 	switch(source) {
 	case NC_DATASTORE_RUNNING:
-		source_ds = file_ds->running->children;
-		break;
 	case NC_DATASTORE_STARTUP:
-		source_ds = file_ds->startup->children;
-		break;
 	case NC_DATASTORE_CANDIDATE:
-		source_ds = file_ds->candidate->children;
+		if ((aux_node = file_ds_content(file_ds, source)) == NULL) {
+			UNLOCK(file_ds);
+			free(data);
+			*error = nc_err_new(NC_ERR_OP_FAILED);
+			return EXIT_FAILURE;
+		}
+		source_ds = aux_node->children;
 		break;
 	case NC_DATASTORE_CONFIG:
-		if (config == NULL) {
+		if (config_doc == NULL) {
 			UNLOCK(file_ds);
+			free(data);
 			ERROR("%s: invalid source config.", __func__);
 			*error = nc_err_new(NC_ERR_BAD_ELEM);
 			nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "config");
 			return EXIT_FAILURE;
 		}
-		if (strncmp(config, "<?xml", 5) == 0) {
-			if ((configp = strchr(config, '>')) == NULL) {
-				UNLOCK(file_ds);
-				ERROR("%s: invalid source config.", __func__);
-				*error = nc_err_new(NC_ERR_BAD_ELEM);
-				nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "config");
-				return EXIT_FAILURE;
-			}
-			++configp;
-			while (*configp == ' ' || *configp == '\n' || *configp == '\t') {
-				++configp;
-			}
-		} else {
-			configp = config;
-		}
-		if (asprintf(&aux, "<config>%s</config>", configp) == -1) {
-			UNLOCK(file_ds);
-			ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
-			*error = nc_err_new(NC_ERR_OP_FAILED);
-			return EXIT_FAILURE;
-		}
-		if ((config_doc = xmlReadMemory (aux, strlen(aux), NULL, NULL, NC_XMLREAD_OPTIONS)) == NULL) {
-			free(aux);
-			UNLOCK(file_ds);
-			ERROR("%s: reading source config failed.", __func__);
-			*error = nc_err_new(NC_ERR_OP_FAILED);
-			return EXIT_FAILURE;
-		}
-		free(aux);
-		source_ds = config_doc->children->children;
+		source_ds = config_doc->children;
 		break;
 	default:
 		UNLOCK(file_ds);
+		free(data);
 		ERROR("%s: invalid source.", __func__);
 		*error = nc_err_new(NC_ERR_BAD_ELEM);
 		nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "target");
@@ -1115,11 +2705,23 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 	/* we could still do something with candidate datastore,
 	 * so we have to change the "modified" attribute
 	 */
-	if (source_ds == NULL && target_ds->children == NULL) {
+	if (source_ds == NULL && target_content->children == NULL) {
 		ret = EXIT_RPC_NOT_APPLICABLE;
+		file_copyconfig_apply(file_ds, target, target_ds, source, NULL);
 		goto finish;
 	}
 
+	if (rpc == NULL || rpc->nacm == NULL) {
+		/* discard-changes and commit only drop or move the changes of the candidate */
+		if (target == NC_DATASTORE_CANDIDATE && source == NC_DATASTORE_RUNNING) {
+			file_copyconfig_apply(file_ds, target, target_ds, source, NULL);
+			goto finish;
+		} else if (target == NC_DATASTORE_RUNNING && source == NC_DATASTORE_CANDIDATE) {
+			file_commit_apply(file_ds);
+			goto finish;
+		}
+	}
+
 	aux_doc = xmlNewDoc (BAD_CAST "1.0");
 	if (source_ds) {
 		xmlDocSetRootElement(aux_doc, xmlCopyNode(source_ds, 1));
@@ -1146,6 +2748,7 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 				 * are silently omitted
 				 */
 				nacm_check_data_read(aux_doc, rpc->nacm);
+				filtered = 1;
 			}
 
 			/* RFC 6536, sec. 3.2.4., paragraph 4
@@ -1153,12 +2756,12 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 			 * the client needs access to the modified nodes according to
 			 * the effective access operation of the each modified node.
 			 */
-			if (target_ds->children == NULL) {
+			if (target_content->children == NULL) {
 				/* creating a completely new configuration data */
 				r = nacm_check_data(aux_doc->children, NACM_ACCESS_CREATE, rpc->nacm);
 			} else {
 				/* replacing an old configuration data */
-				r = edit_replace_nacmcheck(target_ds->children, aux_doc, file_ds->ds.ext_model, keys, rpc->nacm, error);
+				r = edit_replace_nacmcheck(target_content->children, aux_doc, file_ds->ds.ext_model, keys, rpc->nacm, error);
 			}
 
 			if (r != NACM_PERMIT) {
@@ -1172,51 +2775,94 @@ int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, c
 					}
 				}
 				UNLOCK(file_ds);
+				free(data);
 				xmlFreeDoc(aux_doc);
 				keyListFree(keys);
-				xmlFreeDoc (config_doc);
 				return (EXIT_FAILURE);
 			}
 			keyListFree(keys);
 		}
 	}
 
-	/* drop current target configuration */
-	while ((aux_node = target_ds->children) != NULL) {
-		xmlUnlinkNode (target_ds->children);
-		xmlFreeNode (aux_node);
+	/* replace the target configuration */
+	commit = (target == NC_DATASTORE_RUNNING && source == NC_DATASTORE_CANDIDATE && !file_candidate_clean(file_ds->candidate));
+	if (commit) {
+		file_ds->rollback.commit = file_ds->rollback.store;
 	}
-
-	/* copy new target configuration */
-	xmlAddChildList(target_ds, xmlCopyNodeList(aux_doc->children));
+	file_copyconfig_apply(file_ds, target, target_ds, source, aux_doc->children);
 	xmlFreeDoc(aux_doc);
+	if (commit) {
+		/* commit filtered by NACM, the candidate is cleared the same way as
+		 * by file_commit_apply() when the commit is replayed */
+		while ((aux_node = file_ds->candidate->children) != NULL) {
+			xmlUnlinkNode(aux_node);
+			xmlFreeNode(aux_node);
+		}
+		xmlSetProp (file_ds->candidate, BAD_CAST "modified", BAD_CAST "false");
+	}
+	if (target == NC_DATASTORE_CANDIDATE && source == NC_DATASTORE_RUNNING) {
+		/* the candidate is read from the running, the content filtered by NACM was not used */
+		filtered = 0;
+	}
 
 finish:
 	/*
-	 * if we are changing candidate, mark it as modified, since we need
-	 * this information for locking - according to RFC, candidate cannot
-	 * be locked since it has been modified and not committed.
+	 * the content filtered by NACM cannot be replayed from the source
+	 * datastore, so the whole datastore is stored
 	 */
-	if (target == NC_DATASTORE_CANDIDATE) {
-		if (source == NC_DATASTORE_RUNNING) {
-			xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "false");
-		} else {
-			xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "true");
-		}
-	}
-
-	if (file_sync (file_ds)) {
+	if (filtered ? file_sync(file_ds) : file_journal_append(file_ds, JOURNAL_COPY, target, source, config)) {
 		UNLOCK(file_ds);
+		free(data);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
 		nc_err_set(*error, NC_ERR_PARAM_MSG, "Datastore file synchronisation failed.");
 		return EXIT_FAILURE;
 	}
 	UNLOCK(file_ds);
+	free(data);
+
+	return ret;
+}
+
+/**
+ * @brief Copy the content of the datastore or externally send
+ * the configuration to another datastore
+ *
+ * @param ds Pointer to a datastore structure
+ * @param session Session which the request is a part of
+ * @param rpc RPC message with the request
+ * @param target Target datastore.
+ * @param source Source datastore, if the value is NC_DATASTORE_NONE
+ * then the next parameter holds the configration to copy
+ * @param config Configuration to be used as the source in the form of a serialized XML.
+ * @param error	 Netconf error structure.
+ *
+ * @return EXIT_SUCCESS when done without problems
+ * 	   EXIT_FAILURE when error occured
+ * 	   EXIT_RPC_NOT_APPLICABLE when rpc is not applicable
+ */
+int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, char * config, struct nc_err **error)
+{
+	xmlDocPtr config_doc = NULL;
+	int ret;
+
+	assert(error);
+
+	if (source == NC_DATASTORE_CONFIG && config != NULL && (config_doc = file_read_config(config)) == NULL) {
+		ERROR("%s: reading source config failed.", __func__);
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		return EXIT_FAILURE;
+	}
+	ret = file_copyconfig((struct ncds_ds_file*)ds, session, rpc, target, source, config_doc, config, error);
+	xmlFreeDoc(config_doc);
 
-	xmlFreeDoc (config_doc);
 	return ret;
 }
 
+int ncds_file_copyconfig_xml(struct ncds_ds *ds, const struct nc_session *session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, xmlDocPtr config, struct nc_err **error)
+{
+	return (file_copyconfig((struct ncds_ds_file*)ds, session, rpc, target, source, config, NULL, error));
+}
+
 /**
  * @brief Delete target datastore
  *
@@ -1230,7 +2876,7 @@ finish:
 int ncds_file_deleteconfig(struct ncds_ds * ds, const struct nc_session * session, NC_DATASTORE target, struct nc_err **error)
 {
 	struct ncds_ds_file * file_ds = (struct ncds_ds_file*)ds;
-	xmlNodePtr target_ds, del;
+	xmlNodePtr target_ds;
 	int ret;
 
 	assert(error);
@@ -1256,10 +2902,10 @@ int ncds_file_deleteconfig(struct ncds_ds * ds, const struct nc_session * sessio
 		return EXIT_FAILURE;
 		break;
 	case NC_DATASTORE_STARTUP:
-		target_ds = file_ds->startup;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_STARTUP);
 		break;
 	case NC_DATASTORE_CANDIDATE:
-		target_ds = file_ds->candidate;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_CANDIDATE);
 		break;
 	default:
 		UNLOCK(file_ds);
@@ -1270,27 +2916,22 @@ int ncds_file_deleteconfig(struct ncds_ds * ds, const struct nc_session * sessio
 		break;
 	}
 
-	if (file_ds_access (file_ds, target, session) != 0) {
+	if (target_ds == NULL) {
+		/* decoding the binary datastore failed */
 		UNLOCK(file_ds);
-		*error = nc_err_new (NC_ERR_IN_USE);
+		*error = nc_err_new(NC_ERR_OP_FAILED);
 		return EXIT_FAILURE;
 	}
 
-	while ((del = target_ds->children) != NULL) {
-		xmlUnlinkNode (target_ds->children);
-		xmlFreeNode (del);
+	if (file_ds_access (file_ds, target, session) != 0) {
+		UNLOCK(file_ds);
+		*error = nc_err_new (NC_ERR_IN_USE);
+		return EXIT_FAILURE;
 	}
 
-	/*
-	 * if we are changing the candidate, mark it as modified, since we need
-	 * this information for locking - according to RFC, candidate cannot
-	 * be locked since it has been modified and not committed.
-	 */
-	if (target == NC_DATASTORE_CANDIDATE) {
-		xmlSetProp (target_ds, BAD_CAST "modified", BAD_CAST "true");
-	}
+	file_deleteconfig_apply(file_ds, target, target_ds);
 
-	if (file_sync (file_ds)) {
+	if (file_journal_append(file_ds, JOURNAL_DELETE, target, 0, NULL)) {
 		UNLOCK(file_ds);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
 		nc_err_set(*error, NC_ERR_PARAM_MSG, "Datastore file synchronisation failed.");
@@ -1302,32 +2943,34 @@ int ncds_file_deleteconfig(struct ncds_ds * ds, const struct nc_session * sessio
 }
 
 /**
- * @brief Perform the edit-config operation
- *
- * @param ds Datastore to edit
- * @param session Session sending the edit request
- * @param rpc
- * @param target Datastore type
- * @param config Edit configuration.
- * @param defop Default edit operation.
- * @param error Netconf error structure
+ * @brief Edit configuration in the datastore, common part of
+ * ncds_file_editconfig() and ncds_file_editconfig_xml().
  *
- * @return EXIT_SUCCESS or EXIT_FAILURE
+ * @param config_doc Edit configuration in the form of file_read_config().
+ * @param config Serialized edit configuration for the journal, NULL to
+ * serialize the config_doc.
  */
-int ncds_file_editconfig(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, const char * config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error)
+static int file_editconfig(struct ncds_ds_file* file_ds, const struct nc_session* session, const nc_rpc* rpc, NC_DATASTORE target, xmlDocPtr config_doc, const char* config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err** error)
 {
-	struct ncds_ds_file * file_ds = (struct ncds_ds_file *)ds;
-	xmlDocPtr config_doc, datastore_doc;
-	xmlNodePtr target_ds, aux_node, root;
+	xmlNodePtr target_ds;
+	char* data = NULL;
 	int retval = EXIT_SUCCESS, ret;
-	char* aux = NULL;
-	const char* configp;
 
 	assert(error);
 
+	if (config == NULL && file_ds->journal.fd != -1) {
+		/* the edit is recorded as it came, the edit_config() can change it */
+		if ((data = file_dump_config(config_doc)) == NULL) {
+			*error = nc_err_new(NC_ERR_OP_FAILED);
+			return EXIT_FAILURE;
+		}
+		config = data;
+	}
+
 	/* lock the datastore */
 	LOCK(file_ds, ret);
 	if (ret) {
+		free(data);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
 		nc_err_set(*error, NC_ERR_PARAM_MSG, "Locking datastore file timeouted.");
 		return EXIT_FAILURE;
@@ -1336,22 +2979,24 @@ int ncds_file_editconfig(struct ncds_ds *ds, const struct nc_session * session,
 	/* reload the datastore content */
 	if (file_reload (file_ds)) {
 		UNLOCK(file_ds);
+		free(data);
 		return EXIT_FAILURE;
 	}
 	file_rollback_store(file_ds);
 
 	switch(target) {
 	case NC_DATASTORE_RUNNING:
-		target_ds = file_ds->running;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_RUNNING);
 		break;
 	case NC_DATASTORE_STARTUP:
-		target_ds = file_ds->startup;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_STARTUP);
 		break;
 	case NC_DATASTORE_CANDIDATE:
-		target_ds = file_ds->candidate;
+		target_ds = file_ds_node(file_ds, NC_DATASTORE_CANDIDATE);
 		break;
 	default:
 		UNLOCK(file_ds);
+		free(data);
 		ERROR("%s: invalid target.", __func__);
 		*error = nc_err_new(NC_ERR_BAD_ELEM);
 		nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "target");
@@ -1359,93 +3004,66 @@ int ncds_file_editconfig(struct ncds_ds *ds, const struct nc_session * session,
 		break;
 	}
 
-	if (file_ds_access (file_ds, target, session) != 0) {
-		UNLOCK(file_ds);
-		*error = nc_err_new (NC_ERR_IN_USE);
-		return EXIT_FAILURE;
-	}
-
-	if (strncmp(config, "<?xml", 5) == 0) {
-		if ((configp = strchr(config, '>')) == NULL) {
-			UNLOCK(file_ds);
-			ERROR("%s: invalid config.", __func__);
-			*error = nc_err_new(NC_ERR_BAD_ELEM);
-			nc_err_set(*error, NC_ERR_PARAM_INFO_BADELEM, "config");
-			return EXIT_FAILURE;
-		}
-		++configp;
-		while (*configp == ' ' || *configp == '\n' || *configp == '\t') {
-			++configp;
-		}
-	} else {
-		configp = config;
-	}
-	if (asprintf(&aux, "<config>%s</config>", configp) == -1) {
+	if (target_ds == NULL) {
+		/* decoding the binary datastore failed */
 		UNLOCK(file_ds);
-		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
+		free(data);
 		*error = nc_err_new(NC_ERR_OP_FAILED);
 		return EXIT_FAILURE;
 	}
 
-	/* read config to XML doc */
-	if ((config_doc = xmlReadMemory (aux, strlen(aux), NULL, NULL, NC_XMLREAD_OPTIONS)) == NULL) {
+	if (file_ds_access (file_ds, target, session) != 0) {
 		UNLOCK(file_ds);
-		free(aux);
-		ERROR("%s: Reading xml data failed!", __func__);
+		free(data);
+		*error = nc_err_new (NC_ERR_IN_USE);
 		return EXIT_FAILURE;
 	}
-	free(aux);
-	/* magic - get off the root config element and move all children to the 1st level */
-	root = xmlDocGetRootElement(config_doc);
-	for (aux_node = root->children; aux_node != NULL; aux_node = root->children) {
-		xmlUnlinkNode(aux_node);
-		xmlAddNextSibling(config_doc->last, aux_node);
-	}
-	aux_node = root->next;
-	xmlUnlinkNode(root);
-	xmlFreeNode(root);
 
-	/* create an XML doc with a copy of the datastore configuration */
-	datastore_doc = xmlNewDoc (BAD_CAST "1.0");
-	xmlDocSetRootElement(datastore_doc, xmlCopyNode(target_ds->children, 1));
-	if (target_ds->children) {
-		for (root = target_ds->children->next; root != NULL; root = aux_node) {
-			aux_node = root->next;
-			xmlAddNextSibling(datastore_doc->last, xmlCopyNode(root, 1));
-		}
+	if (file_editconfig_apply(file_ds, target, target_ds, config_doc, defop, errop, (rpc != NULL) ? rpc->nacm : NULL, error)) {
+		retval = EXIT_FAILURE;
+	} else if (file_journal_append(file_ds, JOURNAL_EDIT, target, defop, config)) {
+		/* sync xml tree with file on the hdd failed */
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		nc_err_set(*error, NC_ERR_PARAM_MSG, "Datastore file synchronisation failed.");
+		retval = EXIT_FAILURE;
 	}
+	UNLOCK(file_ds);
+	free(data);
 
-	/* preform edit config */
-	if (edit_config(datastore_doc, config_doc, (struct ncds_ds*)file_ds, defop, errop, (rpc != NULL) ? rpc->nacm : NULL, error)) {
-		retval = EXIT_FAILURE;
-	} else {
-		/* replace datastore by edited configuration */
-		while ((aux_node = target_ds->children) != NULL) {
-			xmlUnlinkNode(aux_node);
-			xmlFreeNode(aux_node);
-		}
-		xmlAddChildList(target_ds, xmlCopyNodeList(datastore_doc->children));
+	return retval;
+}
 
-		/*
-		 * if we are changing candidate, mark it as modified, since we need
-		 * this information for locking - according to RFC, candidate cannot
-		 * be locked since it has been modified and not committed.
-		 */
-		if (target == NC_DATASTORE_CANDIDATE) {
-			xmlSetProp(target_ds, BAD_CAST "modified", BAD_CAST "true");
-		}
+/**
+ * @brief Perform the edit-config operation
+ *
+ * @param ds Datastore to edit
+ * @param session Session sending the edit request
+ * @param rpc
+ * @param target Datastore type
+ * @param config Edit configuration.
+ * @param defop Default edit operation.
+ * @param error Netconf error structure
+ *
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int ncds_file_editconfig(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, const char * config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error)
+{
+	xmlDocPtr config_doc;
+	int retval;
 
-		/* sync xml tree with file on the hdd */
-		if (file_sync(file_ds)) {
-			*error = nc_err_new(NC_ERR_OP_FAILED);
-			nc_err_set(*error, NC_ERR_PARAM_MSG, "Datastore file synchronisation failed.");
-			retval = EXIT_FAILURE;
-		}
-	}
-	UNLOCK(file_ds);
+	assert(error);
 
-	xmlFreeDoc(datastore_doc);
+	if ((config_doc = file_read_config(config)) == NULL) {
+		*error = nc_err_new(NC_ERR_OP_FAILED);
+		return EXIT_FAILURE;
+	}
+	retval = file_editconfig((struct ncds_ds_file*)ds, session, rpc, target, config_doc, config, defop, errop, error);
 	xmlFreeDoc(config_doc);
 
 	return retval;
 }
+
+int ncds_file_editconfig_xml(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, xmlDocPtr config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error)
+{
+	return (file_editconfig((struct ncds_ds_file*)ds, session, rpc, target, config, NULL, defop, errop, error));
+}
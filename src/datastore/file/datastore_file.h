@@ -42,16 +42,46 @@
 
 #include "../../netconf_internal.h"
 #include "../datastore_internal.h"
+#include "datastore_binary.h"
 #include <semaphore.h>
+#include <pthread.h>
 
 /* Unique name prefix of every semaphore created */
 #define NCDS_LOCK "/NCDS_FLOCK"
 
+/* Unique name prefix of every shared memory object created */
+#define NCDS_SHM "/NCDS_FSHM"
+
+/* Unique name prefix of every shared memory object with the datastore image */
+#define NCDS_SHM_IMAGE "/NCDS_FIMG"
+
+/* Value marking the initiated lock in the shared memory */
+#define NCDS_SHM_MAGIC 0x4e434453
+
+/* Number of seconds the datastore file is not checked for changes made
+ * outside libnetconf when no change is announced in the shared memory
+ */
+#define NCDS_FILE_CHECK_INTERVAL 1
+
 /* Number of seconds waiting for a semaphore increment before
  * giving up and cancelling the locking
  */
 #define NCDS_LOCK_TIMEOUT 5
 
+/* Suffix of the journal file kept next to the datastore file */
+#define NCDS_FILE_JOURNAL_SUFFIX ".journal"
+
+/* Number of records, resp. size of the journal in bytes, making the
+ * background thread compact the journal into the datastore file
+ */
+#define NCDS_FILE_JOURNAL_RECORDS 64
+#define NCDS_FILE_JOURNAL_SIZE (1024*1024)
+
+/* Number of records making the writer compact the journal itself, when
+ * the background thread does not keep up (or it is not running at all)
+ */
+#define NCDS_FILE_JOURNAL_RECORDS_MAX (4*NCDS_FILE_JOURNAL_RECORDS)
+
 /**
  * @brief File datastore implementation-specific ncds_ds structure.
  */
@@ -69,24 +99,144 @@ struct ncds_ds_file {
 	 * @brief File descriptor of an opened file containing the configuration data
 	 */
 	FILE* file;
+	/**
+	 * @brief Identification of the datastore file loaded into the xml, the
+	 * file is always replaced by a new one when written, so a different
+	 * inode (or its modification time in case the inode number was reused)
+	 * means a new content.
+	 */
+	struct ds_fileid_s {
+		dev_t dev;
+		ino_t ino;
+		struct timespec mtime;
+		off_t size;
+	} fileid;
 	/**
 	 * libxml2's document structure of the datastore
 	 */
 	xmlDocPtr xml;
 	/**
-	 * backup libxml2's document structure of the datastore for rollback
+	 * @brief Version of the datastore to return to by the rollback. Instead
+	 * of copying the whole document before each change, the content replaced
+	 * by the change is kept.
 	 */
-	xmlDocPtr xml_rollback;
+	struct ds_rollback_s {
+		/**
+		 * keep the content replaced by the next change
+		 */
+		int store;
+		/**
+		 * there is a version to return to, with doc NULL when the datastore
+		 * was not changed since it was marked
+		 */
+		int valid;
+		/**
+		 * datastore type the replaced content belongs to
+		 */
+		NC_DATASTORE target;
+		/**
+		 * document holding the replaced content as children of its root
+		 */
+		xmlDocPtr doc;
+		/**
+		 * replaced value of the candidate's modified attribute
+		 */
+		xmlChar* modified;
+		/**
+		 * the replaced running was changed by the commit, so the committed
+		 * changes are returned into the candidate as well
+		 */
+		int commit;
+	} rollback;
+	/**
+	 * mapped file of the binary datastore (NCDS_TYPE_BIN), or the mapped
+	 * shared image (NCDS_TYPE_SHM), the xml was read from, the content of
+	 * the individual datastores is decoded from it when accessed for the
+	 * first time
+	 */
+	struct ncds_bin_image bin;
+	/**
+	 * name of the shared memory object with the image of the datastore in
+	 * the binary format published by the last change (NCDS_TYPE_SHM only)
+	 */
+	char* shm_image;
 	/**
-	 * libxml2 Node pointers providing access to individual datastores
+	 * libxml2 Node pointers providing access to individual datastores. The
+	 * candidate not modified since the last commit or discard has no content
+	 * of its own, it is an overlay of the running without any changes.
 	 */
 	xmlNodePtr candidate, running, startup;
+	/**
+	 * @brief Serialized content of the individual datastores as returned by
+	 * ncds_file_getconfig(), dropped whenever the datastore can be changed
+	 */
+	struct ds_cache_s {
+		/**
+		 * lock of the cached strings, the readers share the datastore
+		 */
+		pthread_mutex_t lock;
+		/**
+		 * serialized content, NULL if not cached
+		 */
+		char* running, *startup, *candidate;
+	} cache;
+	/**
+	 * @brief Journal of the changes made since the last full dump of the
+	 * datastore into the file, the changes are appended as they come and
+	 * compacted into the file from time to time.
+	 */
+	struct ds_journal_s {
+		/**
+		 * path to the journal file
+		 */
+		char* path;
+		/**
+		 * file descriptor of the journal file, -1 if the journal is not used
+		 */
+		int fd;
+		/**
+		 * generation of the datastore file dump the journal belongs to
+		 */
+		unsigned long long gen;
+		/**
+		 * size of the valid part of the journal already applied to the xml,
+		 * 0 if the journal does not belong to the current file dump
+		 */
+		off_t size;
+		/**
+		 * number of records in the valid part of the journal
+		 */
+		unsigned int records;
+	} journal;
+	/**
+	 * @brief Background compaction of the journal
+	 */
+	struct ds_compact_s {
+		/**
+		 * compacting thread
+		 */
+		pthread_t thread;
+		/**
+		 * lock and condition for the request and quit flags
+		 */
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		/**
+		 * flags for the thread - compaction requested, thread termination requested
+		 */
+		int request, quit;
+		/**
+		 * Is the thread running
+		 */
+		int running;
+	} compact;
 	/**
 	 * locking structure
 	 */
 	struct ds_lock_s {
 		/**
-		 * semaphore pointer
+		 * semaphore pointer, it protects the datastore when the shared
+		 * memory is not available
 		 */
 		sem_t * lock;
 		/**
@@ -97,6 +247,67 @@ struct ncds_ds_file {
 		 * Am I holding the lock
 		 */
 		int holding_lock;
+		/**
+		 * shared memory of all the processes using the datastore, NULL if not available
+		 */
+		struct ds_shared_s {
+			/**
+			 * generation of the datastore content, incremented with every change
+			 */
+			unsigned long long gen;
+			/**
+			 * NCDS_SHM_MAGIC when the rwlock is initiated
+			 */
+			int rwlock_init;
+			/**
+			 * process-shared lock of the datastore, held shared by the
+			 * read-only operations and exclusively by the others
+			 */
+			pthread_rwlock_t rwlock;
+			/**
+			 * generation of the content published in the shared image
+			 * (NCDS_TYPE_SHM), the image is valid only when it is equal to gen
+			 */
+			unsigned long long image_gen;
+			/**
+			 * identification of the datastore file the content of the
+			 * shared image belongs to
+			 */
+			struct ds_fileid_s fileid;
+			/**
+			 * state of the journal the content of the shared image
+			 * belongs to, see struct ds_journal_s
+			 */
+			unsigned long long journal_gen;
+			off_t journal_size;
+			unsigned int journal_records;
+		} *shared;
+		/**
+		 * lock of the xml in this process, needed for reloading it by the
+		 * readers sharing the rwlock
+		 */
+		pthread_rwlock_t local;
+		/**
+		 * generation of the datastore content loaded into the xml
+		 */
+		unsigned long long gen;
+		/**
+		 * generation of the datastore content when the lock was acquired
+		 * exclusively, the image is published only if it changes meanwhile
+		 */
+		unsigned long long locked_gen;
+		/**
+		 * time of the last check of the datastore file
+		 */
+		time_t checked;
+		/**
+		 * statistics of waiting for the lock in this process
+		 */
+		struct ds_lock_stats_s {
+			pthread_mutex_t lock;
+			unsigned long long reads, writes, timeouts;
+			unsigned long long wait_usec, max_wait_usec;
+		} stats;
 	} ds_lock;
 };
 
@@ -135,6 +346,19 @@ int ncds_file_rollback(struct ncds_ds* ds);
 */
 char* ncds_file_getconfig(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE source, struct nc_err** error);
 
+/**
+ * @brief Perform get-config on the specified repository, the data are
+ * returned as a document instead of the serialized XML.
+ *
+ * @param[in] ds File datastore structure from which the data will be obtained.
+ * @param[in] session Session originating the request.
+ * @param[in] source Datastore (running, startup, candidate) to get the data from.
+ * @param[out] error NETCONF error structure describing the experienced error.
+ * @return NULL on error, document with the top-level configuration elements
+ * as its root siblings on success.
+*/
+xmlDocPtr ncds_file_getconfig_xml(struct ncds_ds* ds, const struct nc_session* session, NC_DATASTORE source, struct nc_err** error);
+
 /**
  * @brief Get lock information about the specified NETCONF datastore
  * @param[in] ds File datastore structure that will be checked.
@@ -187,6 +411,18 @@ void ncds_file_free(struct ncds_ds* ds);
  */
 int ncds_file_copyconfig(struct ncds_ds *ds, const struct nc_session *session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, char *config, struct nc_err **error);
 
+/**
+ * @brief Copy the content of a datastore or externally sent configuration to
+ * the other datastore, the configuration is passed as a document.
+ *
+ * @param config Configuration document with the top-level configuration
+ * elements as its root siblings, used only in case of NC_DATASTORE_CONFIG
+ * value of source parameter.
+ *
+ * The other parameters are the same as for ncds_file_copyconfig().
+ */
+int ncds_file_copyconfig_xml(struct ncds_ds *ds, const struct nc_session *session, const nc_rpc* rpc, NC_DATASTORE target, NC_DATASTORE source, xmlDocPtr config, struct nc_err **error);
+
 /**
  * @brief Delete the target datastore
  *
@@ -213,4 +449,15 @@ int ncds_file_deleteconfig(struct ncds_ds * ds, const struct nc_session * sessio
  */
 int ncds_file_editconfig(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, const char * config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error);
 
+/**
+ * @brief Perform the edit-config operation, the edit configuration is passed
+ * as a document.
+ *
+ * @param[in] config Edit configuration document with the top-level elements
+ * as its root siblings, its content can be changed.
+ *
+ * The other parameters are the same as for ncds_file_editconfig().
+ */
+int ncds_file_editconfig_xml(struct ncds_ds *ds, const struct nc_session * session, const nc_rpc* rpc, NC_DATASTORE target, xmlDocPtr config, NC_EDIT_DEFOP_TYPE defop, NC_EDIT_ERROPT_TYPE errop, struct nc_err **error);
+
 #endif /* NC_DATASTORE_FILE_H_ */
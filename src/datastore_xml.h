@@ -150,6 +150,71 @@ int ncds_set_validation2(struct ncds_ds* ds, int enable, const char* relaxng,
     const char* schematron,
     int (*valid_func)(const xmlDocPtr config, struct nc_err **err));
 
+/**
+ * @ingroup store
+ * @brief Change of the configuration data made by an edit-config.
+ */
+struct ncds_change {
+	/**
+	 * @brief XMLDIFF_ADD, XMLDIFF_REM, XMLDIFF_MOD (replaced node or
+	 * changed leaf value) or XMLDIFF_REORDER (moved list instance)
+	 */
+	XMLDIFF_OP op;
+	/**
+	 * @brief Path of the node at the time of the change, list and leaf-list
+	 * instances are identified by the values of their keys or by their
+	 * value, e.g. /top/item[id='5']/val
+	 */
+	char* path;
+	/**
+	 * @brief Copy of the node before the change, NULL for XMLDIFF_ADD
+	 */
+	xmlNodePtr before;
+	/**
+	 * @brief Copy of the node after the change, NULL for XMLDIFF_REM
+	 */
+	xmlNodePtr after;
+	/**
+	 * @brief Next change, in the order the changes were applied
+	 */
+	struct ncds_change* next;
+};
+
+/**
+ * @ingroup store
+ * @brief Get the changes an edit-config would make in the datastore without
+ * changing it (dry run).
+ *
+ * To make this function available, you have to include libnetconf_xml.h.
+ *
+ * The edit is applied by libnetconf to a copy of the current content of the
+ * datastore, so it works with any datastore type. No access control is
+ * applied and the result is not validated.
+ *
+ * @param[in] id ID of the datastore to check the edit on.
+ * @param[in] target Datastore type (running, startup or candidate) to edit.
+ * @param[in] config Content of the edit-config's \<config\> element, the
+ * document is not changed.
+ * @param[in] defop Default edit-config's operation.
+ * @param[out] changes List of the changes, NULL if nothing would be changed.
+ * On error, it contains the changes made before the error was detected.
+ * Caller is supposed to free it by ncds_changes_free().
+ * @param[out] error NETCONF error structure describing why the edit-config
+ * would fail, caller is supposed to free it by nc_err_free().
+ * @return EXIT_SUCCESS if the edit-config would succeed, EXIT_FAILURE otherwise.
+ */
+int ncds_edit_dryrun(ncds_id id, NC_DATASTORE target, const xmlDocPtr config, NC_EDIT_DEFOP_TYPE defop, struct ncds_change** changes, struct nc_err** error);
+
+/**
+ * @ingroup store
+ * @brief Free the list of changes returned by ncds_edit_dryrun().
+ *
+ * To make this function available, you have to include libnetconf_xml.h.
+ *
+ * @param[in] changes List of changes to free.
+ */
+void ncds_changes_free(struct ncds_change* changes);
+
 #ifdef __cplusplus
 }
 #endif
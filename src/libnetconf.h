@@ -1278,6 +1278,12 @@
  * \brief libnetconf's functions for handling NETCONF sessions.
  */
 
+/**
+ * \defgroup reactor Session reactor
+ * \brief libnetconf's functions for serving many NETCONF sessions from a single
+ * thread using an epoll-based event loop.
+ */
+
 /**
  * \defgroup callhome Call Home
  * \brief libnetconf's functions implementing NETCONF Call Home (both SSH and
@@ -1334,6 +1340,7 @@
 #include "netconf.h"
 #include "callbacks.h"
 #include "session.h"
+#include "reactor.h"
 #include "messages.h"
 #include "error.h"
 #include "datastore.h"
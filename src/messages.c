@@ -1216,7 +1216,7 @@ static xmlNodePtr ncxml_rpc_get_cfg_copyconfig(const nc_rpc* rpc)
 	char* query = NULL;
 	xmlNodePtr retval;
 
-	if (asprintf(&query, "/%s"":rpc/%s:validate/%s:source/%s:config",
+	if (asprintf(&query, "/%s"":rpc/%s:copy-config/%s:source/%s:config",
 			NC_NS_BASE10_ID, NC_NS_BASE10_ID, NC_NS_BASE10_ID, NC_NS_BASE10_ID) == -1) {
 		ERROR("asprintf() failed (%s:%d).", __FILE__, __LINE__);
 		return (NULL);
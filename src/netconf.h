@@ -96,6 +96,18 @@ struct nc_cpblts;
  */
 struct nc_session;
 
+/**
+ * @ingroup rpc
+ * @brief Callback processing the \<rpc-reply\> to a request sent by
+ * nc_session_send_rpc_async().
+ *
+ * The callback gets the message-id of the request and the received reply,
+ * which is owned by the callback and it is supposed to be freed by
+ * nc_reply_free(). If the session is closed before the reply is received,
+ * the callback is called with the reply set to NULL.
+ */
+typedef void (*nc_reply_clb)(struct nc_session* session, const char* msgid, nc_reply* reply, void* arg);
+
 /**
  * @ingroup rpc
  * @brief NETCONF filter.
@@ -129,6 +141,17 @@ typedef enum NC_SESSION_TERM_REASON {
 	NC_SESSION_TERM_OTHER /**< terminated for some other reason */
 } NC_SESSION_TERM_REASON;
 
+/**
+ * @ingroup notifications
+ * @brief Policy applied when a NETCONF client receives a notification and the
+ * session's queue of notifications waiting for nc_session_recv_notif() is full.
+ */
+typedef enum NC_NTF_OVERFLOW {
+	NC_NTF_OVERFLOW_DROP_OLDEST, /**< drop the oldest queued notification (default) */
+	NC_NTF_OVERFLOW_DROP_NEWEST, /**< drop the received notification */
+	NC_NTF_OVERFLOW_BLOCK /**< wait until another thread takes a notification from the queue */
+} NC_NTF_OVERFLOW;
+
 /**
  * @brief Enumeration of NETCONF message types.
  * @ingroup genAPI
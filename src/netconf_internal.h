@@ -41,6 +41,7 @@
 #define NC_NETCONF_INTERNAL_H_
 
 #include <time.h>
+#include <sys/types.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <pthread.h>
@@ -164,6 +165,49 @@
  */
 #define NC_READ_SLEEP 100
 
+/**
+ * Maximal time in milliseconds to poll the socket of an SSH session without
+ * checking whether the data for the channel were not read by a thread serving
+ * another channel of the same SSH session
+ */
+#define NC_SSH_POLL_SLICE 10
+
+/**
+ * Size of the session's receive buffer, i.e. the maximum amount of data read
+ * from the transport layer by a single read operation
+ */
+#define NC_READ_BUFSIZE 65536
+
+/**
+ * Maximal size the session's receive buffer can grow to when it holds an
+ * incomplete message, the session fails when the limit is exceeded
+ */
+#define NC_READ_BUFMAX 67108864
+
+/**
+ * Size of the session's output buffer. A serialized message is sent whenever
+ * the buffer gets full, so in NETCONF 1.1 it is also the size of the chunks.
+ */
+#define NC_WRITE_BUFSIZE 65536
+
+/**
+ * Maximal size of the session's output buffer. Bigger NETCONF 1.1 chunks are
+ * sent through the buffer in more parts.
+ */
+#define NC_WRITE_BUFMAX 1048576
+
+/**
+ * @brief Maximal size of a NETCONF 1.1 chunk (RFC 6242).
+ * @ingroup internalAPI
+ */
+#define NC_V11_CHUNK_MAX 4294967295UL
+
+/**
+ * Default capacity of the session's queue of received, but not yet processed,
+ * Event Notifications.
+ */
+#define NC_NTF_QUEUE_SIZE 1024
+
 /*
  * global settings for options passed to xmlRead* functions
  */
@@ -335,6 +379,23 @@ struct nc_shared_info {
 	struct nc_apps apps;
 };
 
+/**
+ * @ingroup internalAPI
+ * @brief Request sent by nc_session_send_rpc_async() and waiting for its reply
+ */
+struct nc_pending_rpc {
+	/**< @brief message-id of the sent \<rpc\> */
+	char *msgid;
+	/**< @brief callback processing the reply, NULL if the reply is picked up by nc_session_wait_reply() */
+	nc_reply_clb callback;
+	/**< @brief user argument passed to the callback */
+	void *arg;
+	/**< @brief received reply waiting for nc_session_wait_reply() */
+	nc_reply *reply;
+	/**< @brief next request in the same hash table bucket */
+	struct nc_pending_rpc *next;
+};
+
 /**
  * @ingroup internalAPI
  * @brief NETCONF session description structure
@@ -362,6 +423,28 @@ struct nc_session {
 	int fd_output;
 	/**< @brief Transport protocol identifier */
 	NC_TRANSPORT transport;
+	/**< @brief buffer for the data read from the transport, but not yet processed */
+	char *rbuf;
+	/**< @brief allocated size of the rbuf */
+	size_t rbuf_size;
+	/**< @brief offset of the first unprocessed byte in the rbuf */
+	size_t rbuf_start;
+	/**< @brief offset behind the last valid byte in the rbuf */
+	size_t rbuf_end;
+	/**< @brief buffer for the serialized output data */
+	char *wbuf;
+	/**< @brief allocated size of the wbuf */
+	size_t wbuf_size;
+	/**< @brief maximal size of the NETCONF 1.1 chunks sent, 0 for NC_WRITE_BUFSIZE, protected by mut_send */
+	size_t chunk_size;
+	/**< @brief number of NETCONF 1.1 chunks sent */
+	unsigned long long chunks_sent;
+	/**< @brief number of bytes (including the framing) sent */
+	unsigned long long bytes_sent;
+	/**< @brief time (CLOCK_MONOTONIC) of the last message received or sent on the session */
+	struct timespec last_activity;
+	/**< @brief total time in microseconds spent waiting for the input data */
+	unsigned long long wait_time;
 #ifndef DISABLE_LIBSSH
 	/**< @brief */
 	ssh_session ssh_sess;
@@ -395,18 +478,38 @@ struct nc_session {
 	volatile uint8_t status;
 	/**< @brief thread lock for accessing session items */
 	pthread_mutex_t mut_session;
-	/**< @brief thread lock for communication channel */
+	/**< @brief thread lock for the libssh session (shared by all its channels) or the TLS session, held only for the transport calls */
 	pthread_mutex_t *mut_channel;
-	/**< @brief flag for mut_channel, partially it works as conditional variable */
-	volatile uint8_t mut_channel_flag;
-	/**< @brief thread lock for accessing queue_event */
+	/**< @brief thread lock for receiving data, it protects the rbuf */
+	pthread_mutex_t mut_recv;
+	/**< @brief thread lock for sending data, it protects the wbuf */
+	pthread_mutex_t mut_send;
+	/**< @brief thread lock for accessing ntf_ring */
 	pthread_mutex_t mut_equeue;
 	/**< @brief thread lock for accessing queue_msg */
 	pthread_mutex_t mut_mqueue;
 	/**< @brief queue for received, but not processed, NETCONF messages */
 	struct nc_msg* queue_msg;
-	/**< @brief queue for received, but not processed, NETCONF Event Notifications */
-	struct nc_msg* queue_event;
+	/**< @brief hash table (indexed by message-id) of the requests waiting for their replies, protected by mut_mqueue */
+	struct nc_pending_rpc **pending;
+	/**< @brief number of buckets in the pending hash table */
+	unsigned int pending_size;
+	/**< @brief number of requests in the pending hash table */
+	unsigned int pending_count;
+	/**< @brief ring of received, but not processed, NETCONF Event Notifications, protected by mut_equeue */
+	struct nc_msg** ntf_ring;
+	/**< @brief capacity of the ntf_ring */
+	size_t ntf_ring_size;
+	/**< @brief index of the oldest notification in the ntf_ring */
+	size_t ntf_ring_head;
+	/**< @brief number of notifications in the ntf_ring */
+	size_t ntf_ring_count;
+	/**< @brief policy applied when a notification is received and the ntf_ring is full */
+	NC_NTF_OVERFLOW ntf_overflow;
+	/**< @brief signals the space in the full ntf_ring for NC_NTF_OVERFLOW_BLOCK, initialized with the ntf_ring */
+	pthread_cond_t ntf_ring_cond;
+	/**< @brief number of notifications dropped because of the full ntf_ring */
+	unsigned long long ntf_dropped;
 	/**< @brief flag for active notification subscription on the session */
 	int ntf_active;
 	/**< @brief flag for stopping notification subscription on the session */
@@ -646,6 +749,51 @@ const char* nc_session_term_string(NC_SESSION_TERM_REASON reason);
  */
 void nc_session_close (struct nc_session* session, NC_SESSION_TERM_REASON reason);
 
+/**
+ * @brief Get the file descriptor to watch for the session's input. SSH channels
+ * of the same SSH session share the descriptor.
+ * @param[in] session Session to check.
+ * @return File descriptor, -1 if the session has no input.
+ */
+int nc_session_input_fd(const struct nc_session* session);
+
+/**
+ * @brief Check if the session's transport (libssh or OpenSSL) may hold some
+ * already received data, which do not make the input descriptor readable.
+ *
+ * nc_session_read_available() can be called without blocking when it returns
+ * non-zero.
+ *
+ * @param[in] session Session to check.
+ * @return Non-zero if the transport is supposed to be read, 0 otherwise.
+ */
+int nc_session_transport_pending(struct nc_session* session);
+
+/**
+ * @brief Move the data currently available on the session's transport into
+ * its receive buffer without waiting for more.
+ *
+ * The input descriptor is expected to be readable (or the libssh channel to
+ * have some data), otherwise a blocking descriptor could block the call.
+ *
+ * @param[in] session Session to read from.
+ * @return Number of newly buffered bytes, -1 on error or EOF. Even in such
+ * a case, the previously buffered messages can still be received.
+ */
+ssize_t nc_session_read_available(struct nc_session* session);
+
+/**
+ * @brief Check if the session's receive buffer holds a complete NETCONF
+ * message, so nc_session_recv_*() functions do not need to wait for input.
+ *
+ * @param[in] session Session to check.
+ * @param[in,out] scanned Number of bytes already checked by the previous calls,
+ * it must be set to 0 when a message is received from the buffer.
+ * @return 1 if the message is complete, 0 if it is not complete yet, -1 if
+ * the framing of the message is invalid.
+ */
+int nc_session_msg_framed(const struct nc_session* session, size_t *scanned);
+
 #ifndef DISABLE_NOTIFICATIONS
 
 /* sleep time in dispatch loops in microseconds */
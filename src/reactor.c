@@ -0,0 +1,594 @@
+/**
+ * \file reactor.c
+ * \author Radek Krejci <rkrejci@cesnet.cz>
+ * \brief Implementation of functions to serve many NETCONF sessions from a
+ * single thread.
+ *
+ * Copyright (c) 2012-2014 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * ALTERNATIVELY, provided that this notice is retained in full, this
+ * product may be distributed under the terms of the GNU General Public
+ * License (GPL) version 2 or later, in which case the provisions
+ * of the GPL apply INSTEAD OF those given above.
+ *
+ * This software is provided ``as is, and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose are disclaimed.
+ * In no event shall the company or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include "netconf_internal.h"
+#include "session.h"
+#include "messages.h"
+#include "reactor.h"
+
+extern struct nc_shared_info *nc_info;
+
+/* maximal number of events processed by a single epoll_wait() call */
+#define NC_REACTOR_EVENTS 64
+
+struct reactor_fd;
+
+/**
+ * @brief Session watched by the reactor.
+ */
+struct reactor_item {
+	struct nc_session *session; /**< @brief watched session */
+	struct reactor_fd *rfd; /**< @brief input file descriptor of the session */
+	size_t scanned; /**< @brief part of the receive buffer already checked for a complete message */
+	int backlog; /**< @brief complete message was left in the receive buffer */
+	int pending; /**< @brief data are buffered in the transport, they must be read with the backlog */
+	int removed; /**< @brief session was removed, the item is going to be freed */
+	struct reactor_item *next; /**< @brief next session with the same input file descriptor */
+	struct reactor_item *gc_next; /**< @brief next removed item */
+};
+
+/**
+ * @brief Input file descriptor registered in the epoll instance. SSH channels
+ * of a single SSH session share it.
+ */
+struct reactor_fd {
+	int fd; /**< @brief file descriptor */
+	int dead; /**< @brief no session uses the descriptor, it is going to be freed */
+	struct reactor_item *items; /**< @brief sessions using the descriptor */
+	struct reactor_fd *gc_next; /**< @brief next dead descriptor */
+};
+
+/**
+ * @brief Queued \<rpc\> for reactors without a callback.
+ */
+struct reactor_rpc {
+	struct nc_session *session;
+	nc_rpc *rpc;
+	struct reactor_rpc *next;
+};
+
+struct nc_reactor {
+	int epfd; /**< @brief epoll instance */
+	nc_reactor_rpc_clb callback; /**< @brief callback for received messages */
+	void *arg; /**< @brief callback's argument */
+	struct reactor_fd **fds; /**< @brief registered descriptors indexed by their value */
+	int fds_size; /**< @brief size of the fds array */
+	int count; /**< @brief number of watched sessions */
+	int backlog; /**< @brief number of sessions with a complete message in the receive buffer */
+	int dispatching; /**< @brief nc_reactor_dispatch() is running, freeing of items is postponed */
+	struct reactor_item *gc_items; /**< @brief removed items to free */
+	struct reactor_fd *gc_fds; /**< @brief dead descriptors to free */
+	pthread_mutex_t mut_queue; /**< @brief lock for the queue */
+	struct reactor_rpc *queue; /**< @brief queued messages */
+	struct reactor_rpc *queue_last; /**< @brief last item of the queue */
+};
+
+/**
+ * @brief Free the removed items and unused descriptors.
+ */
+static void reactor_gc(struct nc_reactor* reactor)
+{
+	struct reactor_item *item, *next, **prev;
+	struct reactor_fd *rfd;
+
+	for (item = reactor->gc_items; item != NULL; item = next) {
+		next = item->gc_next;
+		if (item->rfd->dead) {
+			/* freed together with the descriptor */
+			continue;
+		}
+		for (prev = &(item->rfd->items); *prev != item; prev = &((*prev)->next));
+		*prev = item->next;
+		free(item);
+	}
+	reactor->gc_items = NULL;
+
+	while ((rfd = reactor->gc_fds) != NULL) {
+		reactor->gc_fds = rfd->gc_next;
+		while ((item = rfd->items) != NULL) {
+			rfd->items = item->next;
+			free(item);
+		}
+		free(rfd);
+	}
+}
+
+static struct reactor_item* reactor_find(struct reactor_fd* rfd, const struct nc_session* session)
+{
+	struct reactor_item *item;
+
+	if (rfd == NULL) {
+		return (NULL);
+	}
+	for (item = rfd->items; item != NULL; item = item->next) {
+		if (item->session == session && !item->removed) {
+			return (item);
+		}
+	}
+	return (NULL);
+}
+
+static void reactor_item_remove(struct nc_reactor* reactor, struct reactor_item* item)
+{
+	struct reactor_item *iter;
+	struct reactor_fd *rfd = item->rfd;
+
+	item->removed = 1;
+	if (item->backlog) {
+		item->backlog = 0;
+		reactor->backlog--;
+	}
+	reactor->count--;
+	item->gc_next = reactor->gc_items;
+	reactor->gc_items = item;
+
+	for (iter = rfd->items; iter != NULL && iter->removed; iter = iter->next);
+	if (iter == NULL) {
+		/* the last session using the descriptor, it can be already closed */
+		epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, rfd->fd, NULL);
+		reactor->fds[rfd->fd] = NULL;
+		rfd->dead = 1;
+		rfd->gc_next = reactor->gc_fds;
+		reactor->gc_fds = rfd;
+	}
+
+	if (!reactor->dispatching) {
+		reactor_gc(reactor);
+	}
+}
+
+/**
+ * @brief Pass the received \<rpc\> (or NULL for a terminated session) to the
+ * callback or to the queue.
+ */
+static void reactor_deliver(struct nc_reactor* reactor, struct nc_session* session, nc_rpc* rpc)
+{
+	struct reactor_rpc *qrpc;
+
+	if (reactor->callback != NULL) {
+		reactor->callback(session, rpc, reactor->arg);
+		return;
+	}
+
+	if ((qrpc = malloc(sizeof(struct reactor_rpc))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		nc_rpc_free(rpc);
+		return;
+	}
+	qrpc->session = session;
+	qrpc->rpc = rpc;
+	qrpc->next = NULL;
+
+	pthread_mutex_lock(&(reactor->mut_queue));
+	if (reactor->queue_last == NULL) {
+		reactor->queue = qrpc;
+	} else {
+		reactor->queue_last->next = qrpc;
+	}
+	reactor->queue_last = qrpc;
+	pthread_mutex_unlock(&(reactor->mut_queue));
+}
+
+/**
+ * @brief Read the session's input and process all the complete messages.
+ *
+ * @param[in] reactor Reactor the session belongs to.
+ * @param[in] item Reactor's item of the session.
+ * @param[in] readable Flag if the session's input is ready to be read.
+ * @param[out] rd Number of bytes read from the input.
+ * @return Number of delivered messages.
+ */
+static int reactor_process(struct nc_reactor* reactor, struct reactor_item* item, int readable, ssize_t *rd)
+{
+	struct nc_session *session = item->session;
+	nc_rpc *rpc;
+	NC_MSG_TYPE ret;
+	int failed = 0, count = 0, framed;
+
+	*rd = 0;
+	if (session->status != NC_SESSION_STATUS_WORKING && session->status != NC_SESSION_STATUS_CLOSING) {
+		/* closed meanwhile */
+		reactor_item_remove(reactor, item);
+		reactor_deliver(reactor, session, NULL);
+		return (1);
+	}
+	if (readable) {
+		item->pending = 0;
+		if ((*rd = nc_session_read_available(session)) < 0) {
+			failed = 1;
+		}
+	}
+	if (item->backlog) {
+		item->backlog = 0;
+		reactor->backlog--;
+	}
+
+	while (!item->removed && (framed = nc_session_msg_framed(session, &(item->scanned))) != 0) {
+		if (framed < 0) {
+			/* the receiver would wait for the rest of a message that cannot come */
+			ERROR("%s: invalid message framing, dropping the session %s.", __func__, nc_session_get_id(session));
+			failed = 1;
+			break;
+		}
+		rpc = NULL;
+		ret = nc_session_recv_rpc(session, 0, &rpc);
+		if (ret == NC_MSG_WOULDBLOCK) {
+			/*
+			 * the buffered message was received by another thread waiting
+			 * on the session, only the data left in the transport matter
+			 */
+			item->scanned = 0;
+			if (!item->pending && nc_session_transport_pending(session)) {
+				item->pending = 1;
+				item->backlog = 1;
+				reactor->backlog++;
+			}
+			break;
+		}
+		item->scanned = 0;
+
+		if (ret == NC_MSG_RPC) {
+			reactor_deliver(reactor, session, rpc);
+			count++;
+		} else if (session->status != NC_SESSION_STATUS_WORKING && session->status != NC_SESSION_STATUS_CLOSING) {
+			/* the message was malformed and the session was closed */
+			reactor_item_remove(reactor, item);
+			reactor_deliver(reactor, session, NULL);
+			return (count + 1);
+		}
+		/* otherwise the message was processed internally */
+	}
+
+	if (failed && !item->removed) {
+		/* EOF or an input error, the session is dead */
+		nc_session_close(session, NC_SESSION_TERM_DROPPED);
+		if (nc_info) {
+			pthread_rwlock_wrlock(&(nc_info->lock));
+			nc_info->stats.sessions_dropped++;
+			pthread_rwlock_unlock(&(nc_info->lock));
+		}
+		reactor_item_remove(reactor, item);
+		reactor_deliver(reactor, session, NULL);
+		count++;
+	}
+
+	return (count);
+}
+
+/**
+ * @brief Process all the sessions using the readable descriptor.
+ */
+static int reactor_process_fd(struct nc_reactor* reactor, struct reactor_fd* rfd)
+{
+	struct reactor_item *item;
+	int count = 0;
+	ssize_t rd;
+#ifndef DISABLE_LIBSSH
+	int again;
+#endif
+
+	if (rfd->dead) {
+		return (0);
+	}
+
+	for (item = rfd->items; item != NULL; item = item->next) {
+		if (!item->removed) {
+			count += reactor_process(reactor, item, 1, &rd);
+		}
+	}
+
+#ifndef DISABLE_LIBSSH
+	/*
+	 * reading a channel of the SSH session can make libssh read data of the
+	 * other channels, which then do not make the descriptor readable again
+	 */
+	do {
+		again = 0;
+		for (item = rfd->items; item != NULL && rfd->items->next != NULL; item = item->next) {
+			if (!item->removed && item->session->ssh_chan != NULL) {
+				count += reactor_process(reactor, item, 1, &rd);
+				if (rd > 0) {
+					again = 1;
+				}
+			}
+		}
+	} while (again);
+#endif
+
+	return (count);
+}
+
+API struct nc_reactor* nc_reactor_new(nc_reactor_rpc_clb callback, void* arg)
+{
+	struct nc_reactor *reactor;
+
+	if ((reactor = calloc(1, sizeof(struct nc_reactor))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (NULL);
+	}
+
+	if ((reactor->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		ERROR("%s: epoll_create1() failed (%s).", __func__, strerror(errno));
+		free(reactor);
+		return (NULL);
+	}
+	reactor->callback = callback;
+	reactor->arg = arg;
+	pthread_mutex_init(&(reactor->mut_queue), NULL);
+
+	return (reactor);
+}
+
+API void nc_reactor_free(struct nc_reactor* reactor)
+{
+	struct reactor_rpc *qrpc;
+	struct reactor_item *item;
+	int i;
+
+	if (reactor == NULL) {
+		return;
+	}
+
+	/* postpone freeing until all the items are removed */
+	reactor->dispatching = 1;
+	for (i = 0; i < reactor->fds_size; i++) {
+		if (reactor->fds[i] != NULL) {
+			for (item = reactor->fds[i]->items; item != NULL; item = item->next) {
+				if (!item->removed) {
+					reactor_item_remove(reactor, item);
+				}
+			}
+		}
+	}
+	reactor_gc(reactor);
+	free(reactor->fds);
+	close(reactor->epfd);
+
+	while ((qrpc = reactor->queue) != NULL) {
+		reactor->queue = qrpc->next;
+		nc_rpc_free(qrpc->rpc);
+		free(qrpc);
+	}
+	pthread_mutex_destroy(&(reactor->mut_queue));
+
+	free(reactor);
+}
+
+API int nc_reactor_get_fd(const struct nc_reactor* reactor)
+{
+	if (reactor == NULL) {
+		return (-1);
+	}
+
+	return (reactor->epfd);
+}
+
+API int nc_reactor_count(const struct nc_reactor* reactor)
+{
+	if (reactor == NULL) {
+		return (0);
+	}
+
+	return (reactor->count);
+}
+
+API int nc_reactor_add_session(struct nc_reactor* reactor, struct nc_session* session)
+{
+	struct reactor_fd *rfd, **fds;
+	struct reactor_item *item;
+	struct epoll_event ev;
+	int fd, size;
+
+	if (reactor == NULL || session == NULL || session->status != NC_SESSION_STATUS_WORKING) {
+		ERROR("%s: invalid parameters.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	if ((fd = nc_session_input_fd(session)) < 0) {
+		ERROR("%s: the session has no input to watch.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	if (fd >= reactor->fds_size) {
+		for (size = (reactor->fds_size > 0) ? reactor->fds_size : 64; size <= fd; size *= 2);
+		if ((fds = realloc(reactor->fds, size * sizeof(struct reactor_fd*))) == NULL) {
+			ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
+			return (EXIT_FAILURE);
+		}
+		memset(&(fds[reactor->fds_size]), 0, (size - reactor->fds_size) * sizeof(struct reactor_fd*));
+		reactor->fds = fds;
+		reactor->fds_size = size;
+	}
+
+	if ((rfd = reactor->fds[fd]) == NULL) {
+		if ((rfd = calloc(1, sizeof(struct reactor_fd))) == NULL) {
+			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+			return (EXIT_FAILURE);
+		}
+		rfd->fd = fd;
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = rfd;
+		if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+			ERROR("%s: epoll_ctl() failed (%s).", __func__, strerror(errno));
+			free(rfd);
+			return (EXIT_FAILURE);
+		}
+		reactor->fds[fd] = rfd;
+	} else if (reactor_find(rfd, session) != NULL) {
+		ERROR("%s: the session is already in the reactor.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	if ((item = calloc(1, sizeof(struct reactor_item))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		if (rfd->items == NULL) {
+			epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, fd, NULL);
+			reactor->fds[fd] = NULL;
+			free(rfd);
+		}
+		return (EXIT_FAILURE);
+	}
+	item->session = session;
+	item->rfd = rfd;
+	item->next = rfd->items;
+	rfd->items = item;
+	reactor->count++;
+
+	/* data already read by the session (or libssh or OpenSSL) do not make the descriptor readable */
+	item->pending = nc_session_transport_pending(session);
+	if (item->pending || nc_session_has_pending_data(session)) {
+		item->backlog = 1;
+		reactor->backlog++;
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+API int nc_reactor_remove_session(struct nc_reactor* reactor, struct nc_session* session)
+{
+	struct reactor_item *item = NULL;
+	int fd, i;
+
+	if (reactor == NULL || session == NULL) {
+		return (EXIT_FAILURE);
+	}
+
+	/* the session can be already closed, so search the whole reactor if needed */
+	fd = nc_session_input_fd(session);
+	if (fd >= 0 && fd < reactor->fds_size) {
+		item = reactor_find(reactor->fds[fd], session);
+	}
+	for (i = 0; item == NULL && i < reactor->fds_size; i++) {
+		item = reactor_find(reactor->fds[i], session);
+	}
+
+	if (item == NULL) {
+		ERROR("%s: the session is not in the reactor.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	reactor_item_remove(reactor, item);
+	return (EXIT_SUCCESS);
+}
+
+API int nc_reactor_dispatch(struct nc_reactor* reactor, int timeout)
+{
+	struct epoll_event events[NC_REACTOR_EVENTS];
+	struct reactor_item *item;
+	ssize_t rd;
+	int i, n, count = 0;
+
+	if (reactor == NULL) {
+		return (-1);
+	}
+
+	if (reactor->backlog > 0) {
+		/* do not wait, there are messages to process */
+		timeout = 0;
+	}
+
+	n = epoll_wait(reactor->epfd, events, NC_REACTOR_EVENTS, timeout);
+	if (n == -1) {
+		if (errno == EINTR) {
+			return (0);
+		}
+		ERROR("%s: epoll_wait() failed (%s).", __func__, strerror(errno));
+		return (-1);
+	}
+
+	reactor->dispatching = 1;
+
+	/* messages left in the receive buffers by the previous dispatch */
+	for (i = 0; reactor->backlog > 0 && i < reactor->fds_size; i++) {
+		if (reactor->fds[i] == NULL) {
+			continue;
+		}
+		for (item = reactor->fds[i]->items; item != NULL; item = item->next) {
+			if (item->backlog && !item->removed) {
+				/* data buffered in the transport must be read first */
+				count += reactor_process(reactor, item, item->pending, &rd);
+			}
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		count += reactor_process_fd(reactor, (struct reactor_fd*) events[i].data.ptr);
+	}
+
+	reactor->dispatching = 0;
+	reactor_gc(reactor);
+
+	return (count);
+}
+
+API NC_MSG_TYPE nc_reactor_get_rpc(struct nc_reactor* reactor, struct nc_session** session, nc_rpc** rpc)
+{
+	struct reactor_rpc *qrpc;
+
+	if (reactor == NULL || session == NULL || rpc == NULL) {
+		return (NC_MSG_UNKNOWN);
+	}
+
+	pthread_mutex_lock(&(reactor->mut_queue));
+	if ((qrpc = reactor->queue) == NULL) {
+		pthread_mutex_unlock(&(reactor->mut_queue));
+		return (NC_MSG_WOULDBLOCK);
+	}
+	reactor->queue = qrpc->next;
+	if (reactor->queue == NULL) {
+		reactor->queue_last = NULL;
+	}
+	pthread_mutex_unlock(&(reactor->mut_queue));
+
+	*session = qrpc->session;
+	*rpc = qrpc->rpc;
+	free(qrpc);
+
+	return ((*rpc != NULL) ? NC_MSG_RPC : NC_MSG_UNKNOWN);
+}
@@ -0,0 +1,170 @@
+/**
+ * \file reactor.h
+ * \author Radek Krejci <rkrejci@cesnet.cz>
+ * \brief Functions to serve many NETCONF sessions from a single thread.
+ *
+ * Copyright (c) 2012-2014 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * ALTERNATIVELY, provided that this notice is retained in full, this
+ * product may be distributed under the terms of the GNU General Public
+ * License (GPL) version 2 or later, in which case the provisions
+ * of the GPL apply INSTEAD OF those given above.
+ *
+ * This software is provided ``as is, and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose are disclaimed.
+ * In no event shall the company or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+
+#ifndef NC_REACTOR_H_
+#define NC_REACTOR_H_
+
+#include "netconf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @ingroup reactor
+ * @brief Reactor waiting for the input on many NETCONF sessions at once.
+ */
+struct nc_reactor;
+
+/**
+ * @ingroup reactor
+ * @brief Callback for a received \<rpc\>.
+ *
+ * @param[in] session Session the \<rpc\> was received on.
+ * @param[in] rpc Received \<rpc\>, the callback is responsible for freeing it.
+ * NULL if the session was terminated. In such a case, the session is already
+ * removed from the reactor and the callback is supposed to free it.
+ * @param[in] arg Arbitrary argument passed to nc_reactor_new().
+ */
+typedef void (*nc_reactor_rpc_clb)(struct nc_session* session, nc_rpc* rpc, void* arg);
+
+/**
+ * @ingroup reactor
+ * @brief Create a new reactor.
+ *
+ * The reactor watches the input of all the added sessions using a single epoll
+ * instance. When a complete message is received on some of them, it is parsed
+ * and passed to the callback, or queued in the reactor if no callback is
+ * specified.
+ *
+ * All the reactor functions except nc_reactor_get_rpc() are supposed to be
+ * called from a single thread (including the callback).
+ *
+ * @param[in] callback Callback for the received \<rpc\>s. If NULL, \<rpc\>s
+ * are queued and they can be obtained by nc_reactor_get_rpc().
+ * @param[in] arg Arbitrary argument passed to the callback.
+ * @return Created reactor, NULL on error.
+ */
+struct nc_reactor* nc_reactor_new(nc_reactor_rpc_clb callback, void* arg);
+
+/**
+ * @ingroup reactor
+ * @brief Destroy the reactor. The sessions are not freed, the \<rpc\>s still
+ * waiting in the queue are.
+ * @param[in] reactor Reactor to destroy.
+ */
+void nc_reactor_free(struct nc_reactor* reactor);
+
+/**
+ * @ingroup reactor
+ * @brief Get the epoll file descriptor of the reactor. It signals input when
+ * some of the sessions has new data, so the reactor can be included into an
+ * application's own event loop.
+ * @param[in] reactor Reactor to use.
+ * @return File descriptor, -1 on error.
+ */
+int nc_reactor_get_fd(const struct nc_reactor* reactor);
+
+/**
+ * @ingroup reactor
+ * @brief Start watching the input of the session. The session is supposed to
+ * be established (including \<hello\> exchange) and its \<rpc\>s must not be
+ * received by nc_session_recv_rpc() outside the reactor.
+ * @param[in] reactor Reactor to use.
+ * @param[in] session Session to add.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int nc_reactor_add_session(struct nc_reactor* reactor, struct nc_session* session);
+
+/**
+ * @ingroup reactor
+ * @brief Stop watching the input of the session. It can be called also from
+ * the callback. The already queued \<rpc\>s of the session are kept in the
+ * queue.
+ * @param[in] reactor Reactor to use.
+ * @param[in] session Session to remove.
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the session is not in the reactor.
+ */
+int nc_reactor_remove_session(struct nc_reactor* reactor, struct nc_session* session);
+
+/**
+ * @ingroup reactor
+ * @brief Get the number of sessions in the reactor.
+ * @param[in] reactor Reactor to use.
+ * @return Number of sessions.
+ */
+int nc_reactor_count(const struct nc_reactor* reactor);
+
+/**
+ * @ingroup reactor
+ * @brief Wait for input on the reactor's sessions and process all the complete
+ * messages received.
+ *
+ * Each received \<rpc\> is handled by nc_session_recv_rpc(), so the requests
+ * processed internally (e.g. failed with-defaults check or NACM access denied)
+ * are replied automatically. The sessions terminated by the other side or
+ * because of an error are removed from the reactor and reported with NULL
+ * \<rpc\>.
+ *
+ * @param[in] reactor Reactor to use.
+ * @param[in] timeout Timeout in milliseconds for waiting on input, -1 for
+ * infinite waiting, 0 for processing only the input already available.
+ * @return Number of \<rpc\>s and session terminations passed to the callback
+ * (or queued), 0 on timeout, -1 on error.
+ */
+int nc_reactor_dispatch(struct nc_reactor* reactor, int timeout);
+
+/**
+ * @ingroup reactor
+ * @brief Pop the oldest queued \<rpc\> of a reactor created without a callback.
+ * Unlike the other reactor functions, it can be called from any thread.
+ * @param[in] reactor Reactor to use.
+ * @param[out] session Session the \<rpc\> was received on.
+ * @param[out] rpc Received \<rpc\>, the caller is responsible for freeing it.
+ * @return NC_MSG_RPC if \<rpc\> was returned,\n NC_MSG_UNKNOWN if the returned
+ * session was terminated and removed from the reactor (rpc is set to NULL),\n
+ * NC_MSG_WOULDBLOCK if the queue is empty.
+ */
+NC_MSG_TYPE nc_reactor_get_rpc(struct nc_reactor* reactor, struct nc_session** session, nc_rpc** rpc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NC_REACTOR_H_ */
@@ -47,6 +47,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -61,6 +62,7 @@
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
+#include <libxml/xmlsave.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
 
@@ -140,53 +142,6 @@ struct session_list_map {
 static int session_list_fd = -1;
 static struct session_list_map *session_list = NULL;
 
-#ifdef DISABLE_LIBSSH
-#ifdef ENABLE_TLS
-#define NC_WRITE(session,buf,c,ret) \
-	if (session->fd_output != -1) {ret = write (session->fd_output, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else if (session->tls){ \
-		ret = SSL_write(session->tls, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else { \
-		ret = -1; \
-	}
-#else /* not ENABLE_TLS (but DISABLE_LIBSSH) */
-#define NC_WRITE(session,buf,c,ret) \
-	if (session->fd_output != -1) {ret = write (session->fd_output, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else { \
-		ret = -1; \
-	}
-#endif /* not ENABLE_TLS */
-#else /* not DISABLE_LIBSSH */
-#ifdef ENABLE_TLS
-#define NC_WRITE(session,buf,c,ret) \
-	if(session->ssh_chan){ \
-		ret = ssh_channel_write (session->ssh_chan, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else if (session->tls){ \
-		ret = SSL_write(session->tls, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else if (session->fd_output != -1) { \
-		ret = write (session->fd_output, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else { \
-		ret = -1; \
-	}
-#else /* not ENABLE_TLS */
-#define NC_WRITE(session,buf,c,ret) \
-	if(session->ssh_chan){ \
-		ret = ssh_channel_write (session->ssh_chan, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else if (session->fd_output != -1) { \
-		ret = write (session->fd_output, (buf), strlen(buf)); \
-		if (ret > 0) {c += ret;} \
-	} else { \
-		ret = -1; \
-	}
-#endif /* not ENABLE_TLS */
-#endif /* not DISABLE_LIBSSH */
 
 int nc_session_monitoring_init(void)
 {
@@ -1208,10 +1163,96 @@ static void ncntf_dispatch_stop(struct nc_session *session)
 	pthread_mutex_unlock(&(session->mut_ntf));
 }
 
+/* initial number of buckets in the table of pending requests */
+#define NC_PENDING_MINSIZE 64
+
+static unsigned int nc_pending_hash(const char* msgid, unsigned int size)
+{
+	unsigned int h = 5381;
+
+	for (; *msgid != '\0'; msgid++) {
+		h = ((h << 5) + h) + (unsigned char)(*msgid);
+	}
+
+	/* size is always a power of two */
+	return (h & (size - 1));
+}
+
+/*
+ * Find the pending request with the given message-id. Returns the link
+ * pointing to the request in the hash table (so the caller can detach it),
+ * NULL if there is no such request. Caller must hold mut_mqueue.
+ */
+static struct nc_pending_rpc** nc_pending_lookup(struct nc_session* session, const char* msgid)
+{
+	struct nc_pending_rpc** link;
+
+	if (session->pending_count == 0) {
+		return (NULL);
+	}
+
+	for (link = &(session->pending[nc_pending_hash(msgid, session->pending_size)]); *link != NULL; link = &((*link)->next)) {
+		if (strcmp((*link)->msgid, msgid) == 0) {
+			return (link);
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * Add the request into the hash table of pending requests, the table grows
+ * to keep the buckets short. Caller must hold mut_mqueue.
+ */
+static int nc_pending_insert(struct nc_session* session, struct nc_pending_rpc* pending)
+{
+	struct nc_pending_rpc **table, *item, *next;
+	unsigned int size, i, h;
+
+	if (session->pending_count >= session->pending_size) {
+		size = (session->pending_size == 0) ? NC_PENDING_MINSIZE : 2 * session->pending_size;
+		if ((table = calloc(size, sizeof(struct nc_pending_rpc*))) == NULL) {
+			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+			return (EXIT_FAILURE);
+		}
+		for (i = 0; i < session->pending_size; i++) {
+			for (item = session->pending[i]; item != NULL; item = next) {
+				next = item->next;
+				h = nc_pending_hash(item->msgid, size);
+				item->next = table[h];
+				table[h] = item;
+			}
+		}
+		free(session->pending);
+		session->pending = table;
+		session->pending_size = size;
+	}
+
+	h = nc_pending_hash(pending->msgid, session->pending_size);
+	pending->next = session->pending[h];
+	session->pending[h] = pending;
+	session->pending_count++;
+
+	return (EXIT_SUCCESS);
+}
+
+static void nc_pending_free(struct nc_session* session, struct nc_pending_rpc* pending)
+{
+	if (pending->callback != NULL && pending->reply == NULL) {
+		/* the reply will never come, let the callback know */
+		pending->callback(session, pending->msgid, NULL, pending->arg);
+	}
+	nc_reply_free(pending->reply);
+	free(pending->msgid);
+	free(pending);
+}
+
 void nc_session_close(struct nc_session* session, NC_SESSION_TERM_REASON reason)
 {
-	int i;
+	unsigned int i;
 	struct nc_msg *qmsg, *qmsg_aux;
+	struct nc_pending_rpc *pending, **pending_table;
+	unsigned int pending_size;
 	NC_SESSION_STATUS sstatus = session->status;
 
 	/* lock session due to accessing its status and other items */
@@ -1261,10 +1302,15 @@ void nc_session_close(struct nc_session* session, NC_SESSION_TERM_REASON reason)
 		/* close NETCONF session */
 #ifndef DISABLE_LIBSSH
 		if (session->ssh_chan != NULL) {
-			DBG_LOCK("mut_channel");
-			pthread_mutex_lock(session->mut_channel);
-			DBG_UNLOCK("mut_channel");
-			pthread_mutex_unlock(session->mut_channel);
+			/* wait for the running receiving and sending */
+			DBG_LOCK("mut_recv");
+			pthread_mutex_lock(&(session->mut_recv));
+			DBG_UNLOCK("mut_recv");
+			pthread_mutex_unlock(&(session->mut_recv));
+			DBG_LOCK("mut_send");
+			pthread_mutex_lock(&(session->mut_send));
+			DBG_UNLOCK("mut_send");
+			pthread_mutex_unlock(&(session->mut_send));
 
 			DBG_LOCK("mut_channel");
 			pthread_mutex_lock(session->mut_channel);
@@ -1279,12 +1325,26 @@ void nc_session_close(struct nc_session* session, NC_SESSION_TERM_REASON reason)
 #endif
 #ifdef ENABLE_TLS
 		if (session->tls != NULL) {
+			/* wait for the running receiving and sending */
+			DBG_LOCK("mut_recv");
+			pthread_mutex_lock(&(session->mut_recv));
+			DBG_UNLOCK("mut_recv");
+			pthread_mutex_unlock(&(session->mut_recv));
+			DBG_LOCK("mut_send");
+			pthread_mutex_lock(&(session->mut_send));
+			DBG_UNLOCK("mut_send");
+			pthread_mutex_unlock(&(session->mut_send));
+
+			DBG_LOCK("mut_channel");
+			pthread_mutex_lock(session->mut_channel);
 			/* server TLS session, do not close or free */
 			if (!session->is_server) {
 				SSL_shutdown(session->tls);
 				SSL_free(session->tls);
 			}
 			session->tls = NULL;
+			DBG_UNLOCK("mut_channel");
+			pthread_mutex_unlock(session->mut_channel);
 		}
 #endif
 #ifndef DISABLE_LIBSSH
@@ -1322,13 +1382,49 @@ void nc_session_close(struct nc_session* session, NC_SESSION_TERM_REASON reason)
 		session->port = NULL;
 
 		/* remove messages from the queues */
-		for (i = 0, qmsg = session->queue_event; i < 2; i++, qmsg = session->queue_msg) {
-			while (qmsg != NULL) {
-				qmsg_aux = qmsg->next;
-				nc_msg_free(qmsg);
-				qmsg = qmsg_aux;
+		DBG_LOCK("mut_mqueue");
+		pthread_mutex_lock(&(session->mut_mqueue));
+		qmsg = session->queue_msg;
+		session->queue_msg = NULL;
+		DBG_UNLOCK("mut_mqueue");
+		pthread_mutex_unlock(&(session->mut_mqueue));
+		for (; qmsg != NULL; qmsg = qmsg_aux) {
+			qmsg_aux = qmsg->next;
+			nc_msg_free(qmsg);
+		}
+
+		DBG_LOCK("mut_equeue");
+		pthread_mutex_lock(&(session->mut_equeue));
+		for (; session->ntf_ring_count > 0; session->ntf_ring_count--) {
+			nc_msg_free(session->ntf_ring[session->ntf_ring_head]);
+			session->ntf_ring[session->ntf_ring_head] = NULL;
+			session->ntf_ring_head = (session->ntf_ring_head + 1) % session->ntf_ring_size;
+		}
+		if (session->ntf_ring != NULL) {
+			/* wake up the receivers waiting for the space in the queue */
+			pthread_cond_broadcast(&(session->ntf_ring_cond));
+		}
+		DBG_UNLOCK("mut_equeue");
+		pthread_mutex_unlock(&(session->mut_equeue));
+
+		/* cancel the requests waiting for their replies, the callbacks are
+		 * called out of the lock */
+		DBG_LOCK("mut_mqueue");
+		pthread_mutex_lock(&(session->mut_mqueue));
+		pending_table = session->pending;
+		pending_size = session->pending_size;
+		session->pending = NULL;
+		session->pending_size = 0;
+		session->pending_count = 0;
+		DBG_UNLOCK("mut_mqueue");
+		pthread_mutex_unlock(&(session->mut_mqueue));
+		for (i = 0; i < pending_size; i++) {
+			while ((pending = pending_table[i]) != NULL) {
+				pending_table[i] = pending->next;
+				nc_pending_free(session, pending);
 			}
 		}
+		free(pending_table);
 
 		/*
 		 * capabilities, session_id and shared monitoring structure are untouched
@@ -1380,8 +1476,15 @@ API void nc_session_free(struct nc_session* session)
 		nc_cpblts_free(session->capabilities);
 	}
 
+	if (session->ntf_ring != NULL) {
+		free(session->ntf_ring);
+		pthread_cond_destroy(&(session->ntf_ring_cond));
+	}
+
 	/* destroy mutexes */
 	pthread_mutex_destroy(&(session->mut_mqueue));
+	pthread_mutex_destroy(&(session->mut_recv));
+	pthread_mutex_destroy(&(session->mut_send));
 	pthread_mutex_destroy(&(session->mut_equeue));
 	pthread_mutex_destroy(&(session->mut_ntf));
 	pthread_mutex_destroy(&(session->mut_session));
@@ -1430,6 +1533,8 @@ API void nc_session_free(struct nc_session* session)
 		free(session->stats);
 	}
 
+	free(session->rbuf);
+	free(session->wbuf);
 	free (session);
 }
 
@@ -1442,17 +1547,311 @@ API NC_SESSION_STATUS nc_session_get_status (const struct nc_session* session)
 	return (session->status);
 }
 
+/**
+ * @brief Get the file descriptor to watch for the session's output events.
+ */
+static int nc_session_output_fd(const struct nc_session* session)
+{
+	if (session->transport_socket != -1) {
+		return (session->transport_socket);
+	} else if (session->fd_output != -1) {
+		return (session->fd_output);
+	}
+#ifndef DISABLE_LIBSSH
+	else if (session->ssh_chan != NULL) {
+		return (ssh_get_fd(ssh_channel_get_session(session->ssh_chan)));
+	}
+#endif
+#ifdef ENABLE_TLS
+	else if (session->tls != NULL) {
+		return (SSL_get_fd(session->tls));
+	}
+#endif
+	return (-1);
+}
+
+/**
+ * @brief Write all the given data into the session's transport.
+ *
+ * Data are written by a single writev() if the transport is a file descriptor.
+ * libssh and OpenSSL do not provide a vectored write, so the parts are written
+ * one by one. If the transport is not able to accept more data at the moment,
+ * the function blocks in poll() until it is.
+ *
+ * @param[in] session NETCONF session to write to.
+ * @param[in] iov Array of the data parts to write, it is modified during writing.
+ * @param[in] iovcnt Number of items in iov.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int nc_session_write_iov(struct nc_session* session, struct iovec *iov, int iovcnt)
+{
+	ssize_t c;
+	struct pollfd fds;
+#ifdef ENABLE_TLS
+	int r;
+#endif
+
+	while (iovcnt > 0) {
+		if (iov->iov_len == 0) {
+			iov++;
+			iovcnt--;
+			continue;
+		}
+
+#ifndef DISABLE_LIBSSH
+		if (session->ssh_chan) {
+			DBG_LOCK("mut_channel");
+			pthread_mutex_lock(session->mut_channel);
+			c = ssh_channel_write(session->ssh_chan, iov->iov_base, iov->iov_len);
+			DBG_UNLOCK("mut_channel");
+			pthread_mutex_unlock(session->mut_channel);
+			if (c == SSH_ERROR) {
+				VERB("Writing data into the communication channel failed (%s).",
+						session->ssh_sess ? ssh_get_error(session->ssh_sess) : "description not available");
+				return (EXIT_FAILURE);
+			}
+		} else
+#endif
+#ifdef ENABLE_TLS
+		if (session->tls) {
+			DBG_LOCK("mut_channel");
+			pthread_mutex_lock(session->mut_channel);
+			c = SSL_write(session->tls, iov->iov_base, iov->iov_len);
+			r = (c <= 0) ? SSL_get_error(session->tls, c) : SSL_ERROR_NONE;
+			DBG_UNLOCK("mut_channel");
+			pthread_mutex_unlock(session->mut_channel);
+			if (c <= 0) {
+				if (r == SSL_ERROR_WANT_WRITE || r == SSL_ERROR_WANT_READ) {
+					c = 0;
+				} else {
+					VERB("Writing data into the communication channel failed (SSL code %d).", r);
+					return (EXIT_FAILURE);
+				}
+			}
+		} else
+#endif
+		if (session->fd_output != -1) {
+			c = writev(session->fd_output, iov, iovcnt);
+			if (c == -1) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+					c = 0;
+				} else {
+					VERB("Writing data into the communication channel failed (%s).", strerror(errno));
+					return (EXIT_FAILURE);
+				}
+			}
+		} else {
+			ERROR("Invalid transport channel.");
+			return (EXIT_FAILURE);
+		}
+
+		session->bytes_sent += c;
+		if (c == 0) {
+			/* the transport is full, wait until it accepts more data */
+			fds.fd = nc_session_output_fd(session);
+			fds.events = POLLOUT;
+			fds.revents = 0;
+			if (fds.fd != -1 && poll(&fds, 1, -1) == -1 && errno != EINTR) {
+				ERROR("Poll on output communication file descriptor failed (%s)", strerror(errno));
+				return (EXIT_FAILURE);
+			}
+			continue;
+		}
+
+		/* skip the written data */
+		while (c > 0) {
+			if ((size_t) c >= iov->iov_len) {
+				c -= iov->iov_len;
+				iov++;
+				iovcnt--;
+			} else {
+				iov->iov_base = (char*) iov->iov_base + c;
+				iov->iov_len -= c;
+				c = 0;
+			}
+		}
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Context of the streaming output of a NETCONF message.
+ */
+struct nc_msg_writer {
+	struct nc_session *session;
+	size_t len; /* number of bytes waiting in the session's wbuf */
+	int sized; /* set if the size of the whole message is known */
+	size_t rest; /* number of bytes of the message not sent yet, if sized */
+	size_t chunk_left; /* number of bytes missing in the chunk being sent */
+	int error; /* set if writing into the transport failed */
+};
+
+/**
+ * @brief Send a part of the serialized message.
+ *
+ * In NETCONF 1.1 the data are sent as a single chunk, unless the size of the
+ * message is known. Then the chunks of the session's chunk size, which can be
+ * bigger than the output buffer, are sent in more parts. If last is set, the
+ * message end mark is sent together with the data.
+ */
+static int nc_msg_writer_send(struct nc_msg_writer *writer, const char *data, size_t len, int last)
+{
+	struct nc_session *session = writer->session;
+	struct iovec iov[3];
+	char header[SHORT_INT_LENGTH + 16];
+	size_t n;
+	int iovcnt;
+
+	do {
+		iovcnt = 0;
+		n = len;
+		if (session->version == NETCONFV11 && len > 0) {
+			if (writer->chunk_left == 0) {
+				/* start a new chunk */
+				if (writer->sized) {
+					writer->chunk_left = (writer->rest < session->chunk_size) ? writer->rest : session->chunk_size;
+				} else {
+					writer->chunk_left = len;
+				}
+				iov[iovcnt].iov_base = header;
+				iov[iovcnt].iov_len = snprintf(header, sizeof header, "\n#%zu\n", writer->chunk_left);
+				iovcnt++;
+				session->chunks_sent++;
+			}
+			if (n > writer->chunk_left) {
+				n = writer->chunk_left;
+			}
+			writer->chunk_left -= n;
+		}
+		if (writer->sized) {
+			if (n > writer->rest) {
+				ERROR("Size of the serialized message changed (%s:%d).", __FILE__, __LINE__);
+				writer->error = 1;
+				return (EXIT_FAILURE);
+			}
+			writer->rest -= n;
+		}
+		iov[iovcnt].iov_base = (void*) data;
+		iov[iovcnt].iov_len = n;
+		iovcnt++;
+		data += n;
+		len -= n;
+		if (last && len == 0) {
+			if (writer->chunk_left > 0 || (writer->sized && writer->rest > 0)) {
+				ERROR("Size of the serialized message changed (%s:%d).", __FILE__, __LINE__);
+				writer->error = 1;
+				return (EXIT_FAILURE);
+			}
+			if (session->version == NETCONFV11) {
+				iov[iovcnt].iov_base = NC_V11_END_MSG;
+				iov[iovcnt].iov_len = strlen(NC_V11_END_MSG);
+			} else { /* NETCONFV10 */
+				iov[iovcnt].iov_base = NC_V10_END_MSG;
+				iov[iovcnt].iov_len = strlen(NC_V10_END_MSG);
+			}
+			iovcnt++;
+		}
+
+		if (nc_session_write_iov(session, iov, iovcnt) != EXIT_SUCCESS) {
+			writer->error = 1;
+			return (EXIT_FAILURE);
+		}
+	} while (len > 0);
+
+	return (EXIT_SUCCESS);
+}
+
+/**
+ * @brief libxml2's output callback only counting the size of the message.
+ */
+static int nc_msg_counter_write(void *context, const char *UNUSED(buffer), int len)
+{
+	*((size_t*) context) += len;
+	return (len);
+}
+
+/**
+ * @brief libxml2's output callback collecting the serialized message into
+ * the session's output buffer, the buffer is sent whenever it gets full.
+ */
+static int nc_msg_writer_write(void *context, const char *buffer, int len)
+{
+	struct nc_msg_writer *writer = (struct nc_msg_writer*) context;
+	struct nc_session *session = writer->session;
+	size_t n, rest = len;
+
+	if (writer->error) {
+		return (-1);
+	}
+
+	while (rest > 0) {
+		if (writer->len == 0 && rest >= session->wbuf_size) {
+			/* send the whole chunk directly from the libxml2's buffer */
+			if (nc_msg_writer_send(writer, buffer, session->wbuf_size, 0) != EXIT_SUCCESS) {
+				return (-1);
+			}
+			buffer += session->wbuf_size;
+			rest -= session->wbuf_size;
+			continue;
+		}
+
+		n = session->wbuf_size - writer->len;
+		if (n > rest) {
+			n = rest;
+		}
+		memcpy(&(session->wbuf[writer->len]), buffer, n);
+		writer->len += n;
+		buffer += n;
+		rest -= n;
+
+		if (writer->len == session->wbuf_size) {
+			writer->len = 0;
+			if (nc_msg_writer_send(writer, session->wbuf, session->wbuf_size, 0) != EXIT_SUCCESS) {
+				return (-1);
+			}
+		}
+	}
+
+	return (len);
+}
+
+API int nc_session_set_chunk_size(struct nc_session* session, size_t size)
+{
+	if (session == NULL || size == 0 || size > NC_V11_CHUNK_MAX) {
+		ERROR("%s: Invalid parameters.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	/* do not change the size while a message is being sent */
+	DBG_LOCK("mut_send");
+	pthread_mutex_lock(&(session->mut_send));
+	session->chunk_size = size;
+	DBG_UNLOCK("mut_send");
+	pthread_mutex_unlock(&(session->mut_send));
+
+	return (EXIT_SUCCESS);
+}
+
+API void nc_session_get_send_stats(const struct nc_session* session, unsigned long long *chunks, unsigned long long *bytes)
+{
+	if (chunks != NULL) {
+		*chunks = (session == NULL) ? 0 : session->chunks_sent;
+	}
+	if (bytes != NULL) {
+		*bytes = (session == NULL) ? 0 : session->bytes_sent;
+	}
+}
+
 static int nc_session_send(struct nc_session* session, struct nc_msg *msg)
 {
-	ssize_t c = 0;
 	int len, status;
+	size_t size;
 	char *text;
-#ifndef DISABLE_LIBSSH
-	const char *emsg;
-#endif
-	char buf[1024];
 	struct pollfd fds;
-	int ret;
+	struct nc_msg_writer writer;
+	xmlSaveCtxtPtr savectxt;
+	int ret = EXIT_SUCCESS;
 
 	if (session->fd_output == -1 && session->transport_socket == -1
 #ifndef DISABLE_LIBSSH
@@ -1476,23 +1875,7 @@ static int nc_session_send(struct nc_session* session, struct nc_msg *msg)
 
 	/* check that we are able to write data */
 	while (1) {
-		fds.fd = -1;
-
-		if (session->transport_socket != -1) {
-			fds.fd = session->transport_socket;
-		} else if (session->fd_output != -1) {
-			fds.fd = session->fd_output;
-		}
-#ifndef DISABLE_LIBSSH
-		else if (session->ssh_chan != NULL) {
-			fds.fd = ssh_get_fd(ssh_channel_get_session(session->ssh_chan));
-		}
-#endif
-#ifdef ENABLE_TLS
-		else if (session->tls != NULL) {
-			fds.fd = SSL_get_fd(session->tls);
-		}
-#endif
+		fds.fd = nc_session_output_fd(session);
 
 		if (fds.fd == -1) {
 			ERROR("Invalid transport channel.");
@@ -1521,265 +1904,690 @@ static int nc_session_send(struct nc_session* session, struct nc_msg *msg)
 		break;
 	}
 
-	/* lock the session for sending the data */
+	if (verbose_level >= NC_VERB_DEBUG) {
+		xmlDocDumpFormatMemory (msg->doc, (xmlChar**) (&text), &len, NC_CONTENT_FORMATTED);
+		DBG("Writing message (session %s): %s", session->session_id, text);
+		free(text);
+	}
 
-	xmlDocDumpFormatMemory (msg->doc, (xmlChar**) (&text), &len, NC_CONTENT_FORMATTED);
-	DBG("Writing message (session %s): %s", session->session_id, text);
+	/* lock the session for sending the data, receiving is not blocked */
+	DBG_LOCK("mut_send");
+	pthread_mutex_lock(&(session->mut_send));
 
-	DBG_LOCK("mut_channel");
-	session->mut_channel_flag = 1;
-	pthread_mutex_lock(session->mut_channel);
-	/* if v1.1 send chunk information before message */
-	if (session->version == NETCONFV11) {
-		snprintf (buf, 1024, "\n#%d\n", (int) strlen (text));
-		c = 0;
-		do {
-			NC_WRITE(session, &(buf[c]), c, ret);
-			if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-				usleep(10);
-				continue;
-			}
-#ifndef DISABLE_LIBSSH
-			if (ret == SSH_ERROR) {
-				DBG_UNLOCK("mut_channel");
-				session->mut_channel_flag = 0;
-				pthread_mutex_unlock(session->mut_channel);
-				if (!session->ssh_chan) {
-					emsg = strerror(errno);
-				} else if (session->ssh_chan && session->ssh_sess) {
-					emsg = ssh_get_error(session->ssh_sess);
-				} else {
-					emsg = "description not available";
-				}
-				VERB("Writing data into the communication channel failed (%s).", emsg);
-				free (text);
-				return (EXIT_FAILURE);
-			}
-#endif
-			if (ret <= 0) {
-				DBG_UNLOCK("mut_channel");
-				session->mut_channel_flag = 0;
-				pthread_mutex_unlock(session->mut_channel);
-				free (text);
-				return (EXIT_FAILURE);
-			}
-		} while (c < (ssize_t) strlen (buf));
+	/* prepare the output buffer of the currently set chunk size */
+	if (session->chunk_size == 0) {
+		session->chunk_size = NC_WRITE_BUFSIZE;
 	}
-
-	/* write the message */
-	c = 0;
-	do {
-		NC_WRITE(session, &(text[c]), c, ret);
-		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-			usleep(10);
-			continue;
+	size = (session->chunk_size < NC_WRITE_BUFMAX) ? session->chunk_size : NC_WRITE_BUFMAX;
+	if (session->wbuf == NULL || session->wbuf_size != size) {
+		free(session->wbuf);
+		session->wbuf = malloc(size * sizeof(char));
+		if (session->wbuf == NULL) {
+			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+			session->wbuf_size = 0;
+			ret = EXIT_FAILURE;
+			goto unlock;
 		}
-#ifndef DISABLE_LIBSSH
-		if (ret == SSH_ERROR) {
-			DBG_UNLOCK("mut_channel");
-			session->mut_channel_flag = 0;
-			pthread_mutex_unlock(session->mut_channel);
-			if (!session->ssh_chan) {
-				emsg = strerror(errno);
-			} else if (session->ssh_chan && session->ssh_sess) {
-				emsg = ssh_get_error(session->ssh_sess);
-			} else {
-				emsg = "description not available";
-			}
-			VERB("Writing data into the communication channel failed (%s).", emsg);
-			free (text);
-			return (EXIT_FAILURE);
+		session->wbuf_size = size;
+	}
+
+	writer.session = session;
+	writer.len = 0;
+	writer.sized = 0;
+	writer.rest = 0;
+	writer.chunk_left = 0;
+	writer.error = 0;
+
+	if (session->version == NETCONFV11 && session->chunk_size > session->wbuf_size) {
+		/* the chunk header precedes its data, so the size of the message must be known in advance */
+		savectxt = xmlSaveToIO(nc_msg_counter_write, NULL, &(writer.rest), UTF8, NC_CONTENT_FORMATTED ? XML_SAVE_FORMAT : 0);
+		if (savectxt == NULL) {
+			ERROR("Unable to serialize the message (%s:%d).", __FILE__, __LINE__);
+			ret = EXIT_FAILURE;
+			goto unlock;
 		}
-#endif
-		if (ret <= 0) {
-			DBG_UNLOCK("mut_channel");
-			session->mut_channel_flag = 0;
-			pthread_mutex_unlock(session->mut_channel);
-			free (text);
-			return (EXIT_FAILURE);
+		xmlSaveDoc(savectxt, msg->doc);
+		if (xmlSaveClose(savectxt) < 0) {
+			ret = EXIT_FAILURE;
+			goto unlock;
 		}
-	} while (c < (ssize_t) strlen (text));
-	free (text);
+		writer.sized = 1;
+	}
 
-	/* close message */
-	if (session->version == NETCONFV11) {
-		text = NC_V11_END_MSG;
-	} else { /* NETCONFV10 */
-		text = NC_V10_END_MSG;
+	/*
+	 * serialize the message directly into the output buffer, its content is
+	 * sent (as a NETCONF 1.1 chunk or its part) whenever the buffer gets full
+	 */
+	savectxt = xmlSaveToIO(nc_msg_writer_write, NULL, &writer, UTF8, NC_CONTENT_FORMATTED ? XML_SAVE_FORMAT : 0);
+	if (savectxt == NULL) {
+		ERROR("Unable to serialize the message (%s:%d).", __FILE__, __LINE__);
+		ret = EXIT_FAILURE;
+		goto unlock;
 	}
-	c = 0;
-	do {
-		NC_WRITE(session, &(text[c]), c, ret);
-		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-			usleep(10);
-			continue;
-		}
-#ifndef DISABLE_LIBSSH
-		if (ret == SSH_ERROR) {
-			DBG_UNLOCK("mut_channel");
-			session->mut_channel_flag = 0;
-			pthread_mutex_unlock(session->mut_channel);
-			if (!session->ssh_chan) {
-				emsg = strerror(errno);
-			} else if (session->ssh_chan && session->ssh_sess) {
-				emsg = ssh_get_error(session->ssh_sess);
+	xmlSaveDoc(savectxt, msg->doc);
+	if (xmlSaveClose(savectxt) < 0 || writer.error) {
+		ret = EXIT_FAILURE;
+		goto unlock;
+	}
+
+	/* send the rest of the message together with the end mark */
+	if (nc_msg_writer_send(&writer, session->wbuf, writer.len, 1) != EXIT_SUCCESS) {
+		ret = EXIT_FAILURE;
+		goto unlock;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &(session->last_activity));
+
+unlock:
+	/* unlock the session's output */
+	DBG_UNLOCK("mut_send");
+	pthread_mutex_unlock(&(session->mut_send));
+
+	return (ret);
+}
+
+/**
+ * @brief Read the available data from the session's transport.
+ *
+ * @param[in] session NETCONF session to read from.
+ * @param[out] buf Buffer for the read data.
+ * @param[in] size Size of the buf, no more than size bytes is read.
+ * @return Number of read bytes,\n 0 if no data are currently available,\n -1 on
+ * error (the error message is already printed).
+ */
+static ssize_t nc_session_read_transport(struct nc_session* session, char *buf, size_t size)
+{
+	ssize_t c;
+#ifndef DISABLE_LIBSSH
+	int eof;
+#endif
+#ifdef ENABLE_TLS
+	int r;
+#endif
+
+#ifndef DISABLE_LIBSSH
+	if (session->ssh_chan) {
+		/* read via libssh */
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		/* the caller waited for the data, do not block the other channels */
+		c = ssh_channel_read_nonblocking(session->ssh_chan, buf, size, 0);
+		eof = (c == 0 && ssh_channel_is_eof(session->ssh_chan));
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+		if (c == SSH_AGAIN) {
+			return (0);
+		} else if (c == SSH_ERROR) {
+			if (session->ssh_sess != NULL) {
+				ERROR("Reading from the SSH channel failed (%zd: %s)", ssh_get_error_code(session->ssh_sess), ssh_get_error(session->ssh_sess));
 			} else {
-				emsg = "description not available";
+				ERROR("Reading from the SSH channel failed");
 			}
-			VERB("Writing data into the communication channel failed (%s).", emsg);
-			return (EXIT_FAILURE);
+			return (-1);
+		} else if (c == 0) {
+			if (eof) {
+				ERROR("Server has closed the communication socket");
+				return (-1);
+			}
+			return (0);
 		}
+	} else
 #endif
-		if (ret <= 0) {
-			DBG_UNLOCK("mut_channel");
-			session->mut_channel_flag = 0;
-			pthread_mutex_unlock(session->mut_channel);
-			return (EXIT_FAILURE);
+#ifdef ENABLE_TLS
+	if (session->tls) {
+		/* read via OpenSSL */
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		c = SSL_read(session->tls, buf, size);
+		r = (c <= 0) ? SSL_get_error(session->tls, c) : SSL_ERROR_NONE;
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+		if (c <= 0 && r) {
+			if (r == SSL_ERROR_WANT_READ) {
+				return (0);
+			} else {
+				if (r == SSL_ERROR_SYSCALL) {
+					ERROR("Reading from the TLS session failed (%s)", strerror(errno));
+				} else if (r == SSL_ERROR_SSL) {
+					ERROR("Reading from the TLS session failed (%s)", ERR_error_string(r, NULL));
+				} else {
+					ERROR("Reading from the TLS session failed (SSL code %d)", r);
+				}
+				return (-1);
+			}
+		} else if (c < 0) {
+			c = 0;
 		}
-	} while (c < (ssize_t) strlen (text));
-
-	/* unlock the session's output */
-	DBG_UNLOCK("mut_channel");
-	session->mut_channel_flag = 0;
-	pthread_mutex_unlock(session->mut_channel);
+	} else
+#endif
+	if (session->fd_input != -1) {
+		/* read via file descriptor */
+		c = read(session->fd_input, buf, size);
+		if (c == -1) {
+			if (errno == EAGAIN || errno == EINTR) {
+				return (0);
+			} else {
+				ERROR("Reading from an input file descriptor failed (%s)", strerror(errno));
+				return (-1);
+			}
+		} else if (c == 0) {
+			ERROR("EOF received (%s)", strerror(errno));
+			return (-1);
+		}
+	} else {
+		ERROR("No way to read the input, fatal error.");
+		return (-1);
+	}
 
-	return (EXIT_SUCCESS);
+	return (c);
 }
 
-static int nc_session_read_len(struct nc_session* session, size_t chunk_length, char **text, size_t *len)
+/**
+ * @brief Read the next block of data from the transport into the session's
+ * receive buffer. The data not yet processed are preserved, the buffer is
+ * enlarged if they occupy all of it.
+ *
+ * @param[in] session NETCONF session to read from.
+ * @return Number of newly buffered bytes,\n 0 if no data are currently
+ * available,\n -1 on error.
+ */
+static ssize_t nc_session_fill_rbuf(struct nc_session* session)
 {
-	char *buf;
 	ssize_t c;
-	size_t rd = 0;
-	long sleep_count = 0;
+	char *tmp;
+
+	if (session->rbuf == NULL) {
+		session->rbuf = malloc(NC_READ_BUFSIZE * sizeof(char));
+		if (session->rbuf == NULL) {
+			ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+			return (-1);
+		}
+		session->rbuf_size = NC_READ_BUFSIZE;
+		session->rbuf_start = session->rbuf_end = 0;
+	}
+
+	/* move the unprocessed data to the beginning of the buffer */
+	if (session->rbuf_start == session->rbuf_end) {
+		session->rbuf_start = session->rbuf_end = 0;
+	} else if (session->rbuf_start > 0) {
+		memmove(session->rbuf, &(session->rbuf[session->rbuf_start]), session->rbuf_end - session->rbuf_start);
+		session->rbuf_end -= session->rbuf_start;
+		session->rbuf_start = 0;
+	}
+
+	if (session->rbuf_end == session->rbuf_size) {
+		/* the whole buffer is occupied by an incomplete message, get more space */
+		if (session->rbuf_size >= NC_READ_BUFMAX) {
+			ERROR("Incomplete message exceeds the maximal size of the receive buffer (%d bytes).", NC_READ_BUFMAX);
+			return (-1);
+		}
+		tmp = realloc(session->rbuf, 2 * session->rbuf_size * sizeof(char));
+		if (tmp == NULL) {
+			ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
+			return (-1);
+		}
+		session->rbuf = tmp;
+		session->rbuf_size = 2 * session->rbuf_size;
+	}
+
+	c = nc_session_read_transport(session, &(session->rbuf[session->rbuf_end]), session->rbuf_size - session->rbuf_end);
+	if (c > 0) {
+		session->rbuf_end += c;
+	}
+	return (c);
+}
+
+/**
+ * @brief Check if there are some data already read from the transport, but not
+ * yet processed, so the next receive does not need to wait for the transport.
+ */
+static int nc_session_rbuf_pending(const struct nc_session* session)
+{
+	if (session->rbuf_start != session->rbuf_end) {
+		return (1);
+	}
 #ifdef ENABLE_TLS
-	int r;
+	if (session->tls && SSL_pending(session->tls) > 0) {
+		return (1);
+	}
 #endif
+	return (0);
+}
 
-	/* check if we can work with the session */
-	if (session->status != NC_SESSION_STATUS_WORKING &&
-			session->status != NC_SESSION_STATUS_CLOSING) {
-		return (EXIT_FAILURE);
+API int nc_session_has_pending_data(const struct nc_session* session)
+{
+	if (session == NULL) {
+		return (0);
 	}
 
-	buf = malloc ((chunk_length + 1) * sizeof(char));
-	if (buf == NULL) {
-		ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
-		*len = 0;
-		*text = NULL;
-		return (EXIT_FAILURE);
+	return (nc_session_rbuf_pending(session));
+}
+
+int nc_session_input_fd(const struct nc_session* session)
+{
+#ifndef DISABLE_LIBSSH
+	if (session->ssh_chan != NULL) {
+		return (ssh_get_fd(ssh_channel_get_session(session->ssh_chan)));
+	}
+#endif
+#ifdef ENABLE_TLS
+	if (session->tls != NULL) {
+		return (SSL_get_fd(session->tls));
 	}
+#endif
+	return (session->fd_input);
+}
+
+int nc_session_transport_pending(struct nc_session* session)
+{
+	int ret = 0;
 
-	while (rd < chunk_length) {
-		if ((READ_TIMEOUT * 1000000) / NC_READ_SLEEP == sleep_count) {
-			ERROR("Reading timeout elapsed.");
-			free(buf);
-			*len = 0;
-			*text = NULL;
-			return (EXIT_FAILURE);
-		}
 #ifndef DISABLE_LIBSSH
-		if (session->ssh_chan) {
-			/* read via libssh */
-			c = ssh_channel_read(session->ssh_chan, &(buf[rd]), chunk_length - rd, 0);
-			if (c == SSH_AGAIN) {
-				usleep (NC_READ_SLEEP);
-				++sleep_count;
-				continue;
-			} else if (c == SSH_ERROR) {
-				ERROR("Reading from the SSH channel failed (%zd: %s)", ssh_get_error_code(session->ssh_sess), ssh_get_error(session->ssh_sess));
-				free (buf);
-				*len = 0;
-				*text = NULL;
-				return (EXIT_FAILURE);
-			} else if (c == 0) {
-				if (ssh_channel_is_eof(session->ssh_chan)) {
-					ERROR("Server has closed the communication socket");
-					free (buf);
-					*len = 0;
-					*text = NULL;
-					return (EXIT_FAILURE);
-				}
-				usleep (NC_READ_SLEEP);
-				++sleep_count;
-				continue;
+	if (session->ssh_chan != NULL) {
+		/* nc_session_read_available() checks the channel itself */
+		return (1);
+	}
+#endif
+#ifdef ENABLE_TLS
+	if (session->tls != NULL) {
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		ret = (SSL_pending(session->tls) > 0);
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+	}
+#endif
+	return (ret);
+}
+
+ssize_t nc_session_read_available(struct nc_session* session)
+{
+	ssize_t c, total = 0;
+#ifndef DISABLE_LIBSSH
+	int avail;
+#endif
+
+	DBG_LOCK("mut_recv");
+	pthread_mutex_lock(&(session->mut_recv));
+
+#ifndef DISABLE_LIBSSH
+	if (session->ssh_chan != NULL) {
+		/* the socket is shared by all the channels, take only what libssh has for this one */
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		while ((avail = ssh_channel_poll(session->ssh_chan, 0)) > 0) {
+			if ((c = nc_session_fill_rbuf(session)) <= 0) {
+				break;
 			}
-		} else
+			total += c;
+		}
+		if (avail == SSH_ERROR || avail == SSH_EOF) {
+			ERROR("Input channel closed");
+			c = -1;
+		} else if (avail == 0) {
+			c = 0;
+		}
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+	} else
 #endif
 #ifdef ENABLE_TLS
-		if (session->tls) {
-			/* read via OpenSSL */
-			c = SSL_read(session->tls, &(buf[rd]), chunk_length - rd);
-			if (c <= 0 && (r = SSL_get_error(session->tls, c))) {
-				if (r == SSL_ERROR_WANT_READ) {
-					usleep(NC_READ_SLEEP);
-					++sleep_count;
-					continue;
-				} else {
-					if (r == SSL_ERROR_SYSCALL) {
-						ERROR("Reading from the TLS session failed (%s)", strerror(errno));
-					} else if (r == SSL_ERROR_SSL) {
-						ERROR("Reading from the TLS session failed (%s)", ERR_error_string(r, NULL));
-					} else {
-						ERROR("Reading from the TLS session failed (SSL code %d)", r);
-					}
-					free (buf);
-					if (len != NULL) {
-						*len = 0;
-					}
-					if (text != NULL) {
-						*text = NULL;
-					}
-					return (EXIT_FAILURE);
+	if (session->tls != NULL) {
+		/* a single record can be read without blocking, the rest is pending in OpenSSL */
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		do {
+			if ((c = nc_session_fill_rbuf(session)) > 0) {
+				total += c;
+			}
+		} while (c > 0 && SSL_pending(session->tls) > 0);
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+	} else
+#endif
+	{
+		/* a single read does not block when the descriptor is readable */
+		if ((c = nc_session_fill_rbuf(session)) > 0) {
+			total += c;
+		}
+	}
+
+	DBG_UNLOCK("mut_recv");
+	pthread_mutex_unlock(&(session->mut_recv));
+
+	return ((c < 0) ? -1 : total);
+}
+
+int nc_session_msg_framed(const struct nc_session* session, size_t *scanned)
+{
+	const char *data, *nl;
+	size_t avail, pos, hdr, taglen;
+	unsigned long chunk_length;
+	char *end;
+
+	if (session->rbuf == NULL) {
+		return (0);
+	}
+	data = &(session->rbuf[session->rbuf_start]);
+	avail = session->rbuf_end - session->rbuf_start;
+	pos = *scanned;
+
+	switch (session->version) {
+	case NETCONFV10:
+		/* the end tag can start in the already scanned part */
+		taglen = strlen(NC_V10_END_MSG);
+		pos = (pos >= taglen) ? pos - (taglen - 1) : 0;
+		if (avail > pos && memmem(&(data[pos]), avail - pos, NC_V10_END_MSG, taglen) != NULL) {
+			return (1);
+		}
+		*scanned = avail;
+		return (0);
+	case NETCONFV11:
+		while (pos < avail) {
+			/* each chunk starts with "\n#" followed by its size or "#" ending the message */
+			if (avail - pos < 2) {
+				break;
+			} else if (data[pos] != '\n' || data[pos + 1] != '#') {
+				return (-1);
+			}
+			nl = memchr(&(data[pos + 2]), '\n', avail - pos - 2);
+			if (nl == NULL) {
+				if (avail - pos > 12) {
+					/* "\n#" and 10 digits of 4294967295 without the ending "\n" */
+					return (-1);
 				}
+				break;
 			}
-		} else
+			hdr = (nl - data) + 1;
+			if (data[pos + 2] == '#') {
+				/* end of the message */
+				return ((nl == &(data[pos + 3])) ? 1 : -1);
+			}
+			if (data[pos + 2] < '1' || data[pos + 2] > '9') {
+				return (-1);
+			}
+			chunk_length = strtoul(&(data[pos + 2]), &end, 10);
+			if (end != nl || chunk_length > NC_V11_CHUNK_MAX) {
+				return (-1);
+			}
+			if (avail - hdr < chunk_length) {
+				break;
+			}
+			pos = hdr + chunk_length;
+		}
+		*scanned = pos;
+		return (0);
+	default:
+		return (1);
+	}
+}
+
+/**
+ * @brief Get number of milliseconds remaining to the given deadline.
+ *
+ * @param[in] deadline Absolute CLOCK_MONOTONIC time.
+ * @return Remaining time in milliseconds, 0 if the deadline already passed.
+ */
+static int nc_timeout_left(const struct timespec *deadline)
+{
+	struct timespec now;
+	long long diff;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	diff = (deadline->tv_sec - now.tv_sec) * 1000LL + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+	if (diff <= 0) {
+		return (0);
+	}
+	return ((int) diff);
+}
+
+/**
+ * @brief Add the time elapsed since start to the session's input waiting time.
+ */
+static void nc_session_wait_account(struct nc_session* session, const struct timespec *start)
+{
+	struct timespec now;
+	long long diff;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	diff = (now.tv_sec - start->tv_sec) * 1000000LL + (now.tv_nsec - start->tv_nsec) / 1000;
+	if (diff > 0) {
+		session->wait_time += diff;
+	}
+}
+
+#ifndef DISABLE_LIBSSH
+/**
+ * @brief Wait for data on the session's SSH channel.
+ *
+ * The libssh session is shared by all its channels, so it is accessed only
+ * with the mut_channel locked. To not block the other channels and the
+ * senders while waiting, the lock is held only to check the channel and the
+ * socket is polled without it. The data for this channel can be also read
+ * from the socket by a thread serving another channel, so the socket is
+ * polled for NC_SSH_POLL_SLICE at most before checking the channel again.
+ *
+ * @param[in] session NETCONF session with the SSH channel.
+ * @param[in] timeout Timeout in milliseconds, -1 for infinite waiting.
+ * @return The same values as ssh_channel_poll_timeout().
+ */
+static int nc_session_ssh_poll(struct nc_session* session, int timeout)
+{
+	struct pollfd fds;
+	struct timespec deadline;
+	int status, slice;
+
+	if (timeout > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (timeout % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	while (1) {
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		status = ssh_channel_poll(session->ssh_chan, 0);
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+		if (status != 0) {
+			return (status);
+		}
+
+		if (timeout == -1) {
+			slice = NC_SSH_POLL_SLICE;
+		} else if (timeout == 0 || (slice = nc_timeout_left(&deadline)) == 0) {
+			return (0);
+		} else if (slice > NC_SSH_POLL_SLICE) {
+			slice = NC_SSH_POLL_SLICE;
+		}
+
+		fds.fd = ssh_get_fd(ssh_channel_get_session(session->ssh_chan));
+		fds.events = POLLIN;
+		fds.revents = 0;
+		if (poll(&fds, 1, slice) == -1 && errno != EINTR) {
+			return (SSH_ERROR);
+		}
+	}
+}
 #endif
-		if (session->fd_input != -1) {
-			/* read via file descriptor */
-			c = read (session->fd_input, &(buf[rd]), chunk_length - rd);
-			if (c == -1) {
-				if (errno == EAGAIN) {
-					usleep (NC_READ_SLEEP);
-					++sleep_count;
+
+/**
+ * @brief Block until some input data are available on the session's transport.
+ *
+ * @param[in] session NETCONF session to wait on.
+ * @param[in] timeout Timeout in milliseconds, -1 for infinite waiting.
+ * @return 1 if the transport should be read (data available, interrupted wait
+ * or a channel event to be reported by the read),\n 0 on timeout,\n -1 on error.
+ */
+static int nc_session_wait_input(struct nc_session* session, int timeout)
+{
+	struct pollfd fds;
+	struct timespec start;
+	int status;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+#ifndef DISABLE_LIBSSH
+	if (session->ssh_chan) {
+		/* libssh has its own buffers, so ask the channel */
+		status = nc_session_ssh_poll(session, timeout);
+		nc_session_wait_account(session, &start);
+		if (status == SSH_ERROR || status == SSH_EOF) {
+			/* let the read report the problem */
+			return (1);
+		} else if (status == 0) {
+			return (0);
+		}
+		return (1);
+	} else
+#endif
+#ifdef ENABLE_TLS
+	if (session->tls) {
+		DBG_LOCK("mut_channel");
+		pthread_mutex_lock(session->mut_channel);
+		status = SSL_pending(session->tls);
+		DBG_UNLOCK("mut_channel");
+		pthread_mutex_unlock(session->mut_channel);
+		if (status > 0) {
+			/* decrypted data are already waiting in OpenSSL */
+			return (1);
+		}
+		fds.fd = SSL_get_fd(session->tls);
+	} else
+#endif
+	if (session->fd_input != -1) {
+		fds.fd = session->fd_input;
+	} else {
+		ERROR("No way to read the input, fatal error.");
+		return (-1);
+	}
+
+	fds.events = POLLIN;
+	fds.revents = 0;
+	status = poll(&fds, 1, timeout);
+	nc_session_wait_account(session, &start);
+
+	if (status == -1 && errno != EINTR) {
+		ERROR("Input channel error (%s)", strerror(errno));
+		return (-1);
+	} else if (status == 0) {
+		return (0);
+	}
+	/* data, hang-up and error are all detected by the following read */
+	return (1);
+}
+
+API unsigned long long nc_session_get_idle_time(const struct nc_session* session)
+{
+	struct timespec now;
+
+	if (session == NULL || (session->last_activity.tv_sec == 0 && session->last_activity.tv_nsec == 0)) {
+		return (0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - session->last_activity.tv_sec) * 1000ULL + (now.tv_nsec - session->last_activity.tv_nsec) / 1000000);
+}
+
+API unsigned long long nc_session_get_wait_time(const struct nc_session* session)
+{
+	if (session == NULL) {
+		return (0);
+	}
+
+	return (session->wait_time / 1000);
+}
+
+/**
+ * @brief Read a NETCONF 1.1 chunk of the given length and pass its content
+ * into the push parser.
+ *
+ * The chunk data are passed to the parser directly from the session's receive
+ * buffer, so the message is never stored as a whole text.
+ *
+ * @param[in] session NETCONF session to read from.
+ * @param[in] chunk_length Length of the chunk.
+ * @param[in] ctxt libxml2's push parser context.
+ * @param[in,out] fed Number of bytes of the message already passed to the parser,
+ * leading whitespaces of the message are skipped.
+ * @param[in,out] perror Set if the parser failed, the rest of the message is
+ * then only read, but not parsed.
+ * @return EXIT_SUCCESS or EXIT_FAILURE if reading failed.
+ */
+static int nc_session_read_chunk(struct nc_session* session, size_t chunk_length, xmlParserCtxtPtr ctxt, size_t *fed, int *perror)
+{
+	ssize_t c;
+	size_t rd = 0, avail, skip;
+	const char *data;
+	struct timespec deadline;
+	int r;
+
+	/* check if we can work with the session */
+	if (session->status != NC_SESSION_STATUS_WORKING &&
+			session->status != NC_SESSION_STATUS_CLOSING) {
+		return (EXIT_FAILURE);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += READ_TIMEOUT;
+
+	while (rd < chunk_length) {
+		if (session->rbuf_start == session->rbuf_end) {
+			/* no buffered data, read the next block from the transport */
+			c = nc_session_fill_rbuf(session);
+			if (c == 0) {
+				/* no data available now, wait for them */
+				if ((r = nc_session_wait_input(session, nc_timeout_left(&deadline))) > 0) {
 					continue;
-				} else {
-					ERROR("Reading from an input file descriptor failed (%s)", strerror(errno));
-					free (buf);
-					*len = 0;
-					*text = NULL;
-					return (EXIT_FAILURE);
+				} else if (r == 0) {
+					ERROR("Reading timeout elapsed.");
 				}
+				c = -1;
+			}
+			if (c < 0) {
+				return (EXIT_FAILURE);
 			}
-		} else {
-			ERROR("No way to read the input, fatal error.");
-			free (buf);
-			*len = 0;
-			*text = NULL;
-			return (EXIT_FAILURE);
 		}
 
-		rd += c;
+		/* process the buffered part of the chunk */
+		avail = session->rbuf_end - session->rbuf_start;
+		if (avail > chunk_length - rd) {
+			avail = chunk_length - rd;
+		}
+		data = &(session->rbuf[session->rbuf_start]);
+		session->rbuf_start += avail;
+		rd += avail;
+
+		if (*fed == 0) {
+			/* skip leading whitespaces */
+			for (skip = 0; skip < avail && isspace(data[skip]); skip++);
+			data += skip;
+			avail -= skip;
+		}
+		if (avail > 0 && !(*perror)) {
+			if (xmlParseChunk(ctxt, data, avail, 0) != 0) {
+				*perror = 1;
+			}
+			*fed += avail;
+		}
 	}
 
-	/* add terminating null byte */
-	buf[rd] = 0;
-
-	*len = rd;
-	*text = buf;
 	return (EXIT_SUCCESS);
 }
 
 static int nc_session_read_until(struct nc_session* session, const char* endtag, unsigned int limit, char **text, size_t *len)
 {
 	size_t rd = 0;
+	size_t taglen, avail, scan, msglen;
 	ssize_t c;
-	char *buf = NULL;
+	char *buf = NULL, *found;
 	size_t buflen = 0;
-	long sleep_count = 0;
-#ifdef ENABLE_TLS
+	struct timespec deadline;
 	int r;
-#endif
 
 	/* check if we can work with the session */
 	if (session->status != NC_SESSION_STATUS_WORKING &&
@@ -1790,6 +2598,7 @@ static int nc_session_read_until(struct nc_session* session, const char* endtag,
 	if (endtag == NULL) {
 		return (EXIT_FAILURE);
 	}
+	taglen = strlen(endtag);
 
 	/* set starting buffer size */
 	buflen = 1024;
@@ -1799,6 +2608,9 @@ static int nc_session_read_until(struct nc_session* session, const char* endtag,
 		return (EXIT_FAILURE);
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += READ_TIMEOUT;
+
 	for (rd = 0;;) {
 		if (limit > 0 && rd > limit) {
 			free(buf);
@@ -1806,25 +2618,19 @@ static int nc_session_read_until(struct nc_session* session, const char* endtag,
 			return (EXIT_FAILURE);
 		}
 
-		if ((READ_TIMEOUT * 1000000) / NC_READ_SLEEP == sleep_count) {
-			free(buf);
-			ERROR("Reading timeout elapsed.");
-			return (EXIT_FAILURE);
-		}
-#ifndef DISABLE_LIBSSH
-		if (session->ssh_chan) {
-			/* read via libssh */
-			c = ssh_channel_read(session->ssh_chan, &(buf[rd]), 1, 0);
-			if (c == SSH_AGAIN) {
-				usleep (NC_READ_SLEEP);
-				++sleep_count;
-				continue;
-			} else if (c == SSH_ERROR) {
-				if (session->ssh_sess != NULL) {
-					ERROR("Reading from the SSH channel failed (%zd: %s)", ssh_get_error_code(session->ssh_sess), ssh_get_error(session->ssh_sess));
-				} else {
-					ERROR("Reading from the SSH channel failed");
+		if (session->rbuf_start == session->rbuf_end) {
+			/* no buffered data, read the next block from the transport */
+			c = nc_session_fill_rbuf(session);
+			if (c == 0) {
+				/* no data available now, wait for them */
+				if ((r = nc_session_wait_input(session, nc_timeout_left(&deadline))) > 0) {
+					continue;
+				} else if (r == 0) {
+					ERROR("Reading timeout elapsed.");
 				}
+				c = -1;
+			}
+			if (c < 0) {
 				free (buf);
 				if (len != NULL) {
 					*len = 0;
@@ -1833,121 +2639,17 @@ static int nc_session_read_until(struct nc_session* session, const char* endtag,
 					*text = NULL;
 				}
 				return (EXIT_FAILURE);
-			} else if (c == 0) {
-				if (ssh_channel_is_eof (session->ssh_chan)) {
-					ERROR("Server has closed the communication socket");
-					free (buf);
-					if (len != NULL) {
-						*len = 0;
-					}
-					if (text != NULL) {
-						*text = NULL;
-					}
-					return (EXIT_FAILURE);
-				}
-				usleep (NC_READ_SLEEP);
-				++sleep_count;
-				continue;
-			}
-		} else
-#endif
-#ifdef ENABLE_TLS
-		if (session->tls) {
-			/* read via OpenSSL */
-			c = SSL_read(session->tls, &(buf[rd]), 1);
-			if (c <= 0 && (r = SSL_get_error(session->tls, c))) {
-				if (r == SSL_ERROR_WANT_READ) {
-					usleep(NC_READ_SLEEP);
-					++sleep_count;
-					continue;
-				} else {
-					if (r == SSL_ERROR_SYSCALL) {
-						ERROR("Reading from the TLS session failed (%s)", strerror(errno));
-					} else if (r == SSL_ERROR_SSL) {
-						ERROR("Reading from the TLS session failed (%s)", ERR_error_string(r, NULL));
-					} else {
-						ERROR("Reading from the TLS session failed (SSL code %d)", r);
-					}
-					free (buf);
-					if (len != NULL) {
-						*len = 0;
-					}
-					if (text != NULL) {
-						*text = NULL;
-					}
-					return (EXIT_FAILURE);
-				}
 			}
-		} else
-#endif
-		if (session->fd_input != -1) {
-			/* read via file descriptor */
-			c = read (session->fd_input, &(buf[rd]), 1);
-			if (c == -1) {
-				if (errno == EAGAIN) {
-					usleep (NC_READ_SLEEP);
-					++sleep_count;
-					continue;
-				} else {
-					ERROR("Reading from an input file descriptor failed (%s)", strerror(errno));
-					free (buf);
-					if (len != NULL) {
-						*len = 0;
-					}
-					if (text != NULL) {
-						*text = NULL;
-					}
-					return (EXIT_FAILURE);
-				}
-			} else if (c == 0) {
-				ERROR("EOF received (%s)", strerror(errno));
-				free(buf);
-				if (len != NULL ) {
-					*len = 0;
-				}
-				if (text != NULL ) {
-					*text = NULL;
-				}
-				return (EXIT_FAILURE);
-			}
-		} else {
-			ERROR("No way to read the input, fatal error.");
-			free (buf);
-			if (len != NULL) {
-				*len = 0;
-			}
-			if (text != NULL) {
-				*text = NULL;
-			}
-			return (EXIT_FAILURE);
 		}
+		avail = session->rbuf_end - session->rbuf_start;
 
-		rd += c; /* should be rd++ */
-		buf[rd] = '\0';
-
-		if ((rd) < strlen (endtag)) {
-			/* not enough data to compare with endtag */
-			continue;
-		} else {
-			/* compare with endtag */
-			if (strcmp (endtag, &(buf[rd - strlen (endtag)])) == 0) {
-				/* end tag found */
-				if (len != NULL) {
-					*len = rd;
-				}
-				if (text != NULL) {
-					*text = buf;
-				} else {
-					free(buf);
-				}
-				return (EXIT_SUCCESS);
+		/* resize buffer if needed, keep space for the terminating null byte */
+		if (rd + avail >= buflen) {
+			while (rd + avail >= buflen) {
+				buflen = 2 * buflen;
 			}
-		}
-
-		/* resize buffer if needed */
-		if (rd == (buflen-1)) {
 			/* get more memory for the text */
-			void *tmp = realloc (buf, (2 * buflen) * sizeof(char));
+			void *tmp = realloc (buf, buflen * sizeof(char));
 			if (tmp == NULL) {
 				ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
 				if (len != NULL) {
@@ -1960,7 +2662,41 @@ static int nc_session_read_until(struct nc_session* session, const char* endtag,
 				return (EXIT_FAILURE);
 			}
 			buf = tmp;
-			buflen = 2 * buflen;
+		}
+
+		/*
+		 * move all the buffered data into the text, the endtag can start
+		 * already in the previously processed part
+		 */
+		memcpy(&(buf[rd]), &(session->rbuf[session->rbuf_start]), avail);
+		session->rbuf_start += avail;
+		scan = (rd >= taglen - 1) ? rd - (taglen - 1) : 0;
+		rd += avail;
+		buf[rd] = '\0';
+
+		found = memmem(&(buf[scan]), rd - scan, endtag, taglen);
+		if (found != NULL) {
+			/* end tag found, return the data following it back to the receive buffer */
+			msglen = (found - buf) + taglen;
+			session->rbuf_start -= rd - msglen;
+			rd = msglen;
+			buf[rd] = '\0';
+
+			if (limit > 0 && rd > limit) {
+				free(buf);
+				WARN("%s: reading limit reached.", __func__);
+				return (EXIT_FAILURE);
+			}
+
+			if (len != NULL) {
+				*len = rd;
+			}
+			if (text != NULL) {
+				*text = buf;
+			} else {
+				free(buf);
+			}
+			return (EXIT_SUCCESS);
 		}
 	}
 
@@ -2011,12 +2747,14 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 	const char* id;
 	const char *emsg;
 	char *text = NULL, *tmp_text, *chunk = NULL;
-	size_t len;
-	unsigned long long int text_size = 0, total_len = 0;
+	size_t len, total_len = 0;
 	size_t chunk_length;
 	struct pollfd fds;
-	int status;
+	int status, dumplen, parse_error = 0;
+	xmlParserCtxtPtr pctxt = NULL;
+	xmlDocPtr doc = NULL;
 	unsigned long int revents;
+	struct timespec wait_start;
 	NC_MSG_TYPE msgtype;
 	xmlNodePtr root;
 
@@ -2025,26 +2763,22 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 		return (NC_MSG_UNKNOWN);
 	}
 
-	/* if there is waiting sending thread, sleep for timeout and return
-	 * with NC_MSG_WOULDBLOCK because we probably relock the mut_channel quite
-	 * fast, so we are trying to avoid starvation this way
-	 */
-	if (session->mut_channel_flag) {
-		usleep(timeout ? timeout : 1);
-		return (NC_MSG_WOULDBLOCK);
-	}
-
-	/* lock the session for receiving */
-	DBG_LOCK("mut_channel");
-	pthread_mutex_lock(session->mut_channel);
+	/* lock the session for receiving, sending is not blocked */
+	DBG_LOCK("mut_recv");
+	pthread_mutex_lock(&(session->mut_recv));
 
 	/* use while for possibility of repeating test */
 	while(1) {
 		revents = 0;
+		if (nc_session_rbuf_pending(session)) {
+			/* the rest of a previously read data is waiting for processing */
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &wait_start);
 #ifndef DISABLE_LIBSSH
 		if (session->ssh_chan != NULL) {
 			/* we are getting data from libssh's channel */
-			status = ssh_channel_poll_timeout(session->ssh_chan, timeout, 0);
+			status = nc_session_ssh_poll(session, timeout);
 			if (status > 0) {
 				revents = POLLIN;
 			}
@@ -2053,12 +2787,22 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 #ifdef ENABLE_TLS
 		if (session->tls != NULL) {
 			/* we are getting data from TLS session using OpenSSL */
-			fds.fd = SSL_get_fd(session->tls);
-			fds.events = POLLIN;
-			fds.revents = 0;
-			status = poll(&fds, 1, timeout);
+			DBG_LOCK("mut_channel");
+			pthread_mutex_lock(session->mut_channel);
+			status = SSL_pending(session->tls);
+			DBG_UNLOCK("mut_channel");
+			pthread_mutex_unlock(session->mut_channel);
+			if (status > 0) {
+				/* decrypted data are already waiting in OpenSSL */
+				revents = POLLIN;
+			} else {
+				fds.fd = SSL_get_fd(session->tls);
+				fds.events = POLLIN;
+				fds.revents = 0;
+				status = poll(&fds, 1, timeout);
 
-			revents = (unsigned long int) fds.revents;
+				revents = (unsigned long int) fds.revents;
+			}
 		} else
 #endif
 		if (session->fd_input != -1) {
@@ -2070,15 +2814,18 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 
 			revents = (unsigned long int) fds.revents;
 		} else {
+			DBG_UNLOCK("mut_recv");
+			pthread_mutex_unlock(&(session->mut_recv));
 			ERROR("Invalid session to receive data.");
 			return (NC_MSG_UNKNOWN);
 		}
+		nc_session_wait_account(session, &wait_start);
 
 		/* process the result */
 		if (status == 0) {
 			/* timed out */
-			DBG_UNLOCK("mut_channel");
-			pthread_mutex_unlock(session->mut_channel);
+			DBG_UNLOCK("mut_recv");
+			pthread_mutex_unlock(&(session->mut_recv));
 			return (NC_MSG_WOULDBLOCK);
 		} else if (((status == -1) && (errno == EINTR))
 #ifndef DISABLE_LIBSSH
@@ -2089,8 +2836,8 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 			continue;
 		} else if (status < 0) {
 			/* poll failed - something wrong happend, close this socket and wait for another request */
-			DBG_UNLOCK("mut_channel");
-			pthread_mutex_unlock(session->mut_channel);
+			DBG_UNLOCK("mut_recv");
+			pthread_mutex_unlock(&(session->mut_recv));
 #ifndef DISABLE_LIBSSH
 			if (status == SSH_EOF) {
 				emsg = "end of file";
@@ -2119,8 +2866,8 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 		/* if nothing to read and POLLHUP (EOF) or POLLERR set */
 		if ((revents & POLLHUP) || (revents & POLLERR)) {
 			/* close client's socket (it's probably already closed by client */
-			DBG_UNLOCK("mut_channel");
-			pthread_mutex_unlock(session->mut_channel);
+			DBG_UNLOCK("mut_recv");
+			pthread_mutex_unlock(&(session->mut_recv));
 			ERROR("Input channel closed");
 			nc_session_close(session, NC_SESSION_TERM_DROPPED);
 			if (nc_info) {
@@ -2144,17 +2891,19 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 		DBG("Received message (session %s): %s", session->session_id, text);
 		break;
 	case NETCONFV11:
+		/* chunks are parsed as they arrive */
+		pctxt = xmlCreatePushParserCtxt(NULL, NULL, NULL, 0, NULL);
+		if (pctxt == NULL) {
+			ERROR("Unable to create XML parser context (%s:%d).", __FILE__, __LINE__);
+			goto malformed_msg_channels_unlock;
+		}
+		xmlCtxtUseOptions(pctxt, NC_XMLREAD_OPTIONS);
+
 		do {
 			if (nc_session_read_until (session, "\n#", 2, NULL, NULL) != 0) {
-				if (total_len > 0) {
-					free (text);
-				}
 				goto malformed_msg_channels_unlock;
 			}
 			if (nc_session_read_until (session, "\n", 0, &chunk, &len) != 0) {
-				if (total_len > 0) {
-					free (text);
-				}
 				goto malformed_msg_channels_unlock;
 			}
 			if (strcmp (chunk, "#\n") == 0) {
@@ -2165,44 +2914,33 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 
 			/* convert string to the size of the following chunk */
 			chunk_length = strtoul (chunk, (char **) NULL, 10);
+			free (chunk);
+			chunk = NULL;
 			if (chunk_length == 0) {
 				ERROR("Invalid frame chunk size detected, fatal error.");
 				goto malformed_msg_channels_unlock;
 			}
-			free (chunk);
-			chunk = NULL;
 
-			/* now we have size of next chunk, so read the chunk */
-			if (nc_session_read_len (session, chunk_length, &chunk, &len) != 0) {
-				if (total_len > 0) {
-					free (text);
-				}
+			/* now we have size of next chunk, so read and parse the chunk */
+			if (nc_session_read_chunk (session, chunk_length, pctxt, &total_len, &parse_error) != 0) {
 				goto malformed_msg_channels_unlock;
 			}
+		} while (1);
 
-			/*
-			 * realloc resulting text buffer if needed (always needed now)
-			 * don't forget count terminating null byte
-			 * */
-			if (text_size < (total_len + len + 1)) {
-				char *tmp = realloc (text, total_len + len + 1);
-				if (tmp == NULL) {
-					ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
-					free(text);
-					goto malformed_msg_channels_unlock;
-				}
-				text = tmp;
-				text[total_len] = '\0';
-				text_size = total_len + len + 1;
+		if (total_len > 0) {
+			/* finish parsing */
+			if (!parse_error && xmlParseChunk(pctxt, NULL, 0, 1) != 0) {
+				parse_error = 1;
 			}
-			memcpy(text + total_len, chunk, len);
-			total_len += len;
-			text[total_len] = '\0';
-			free (chunk);
-			chunk = NULL;
-
-		} while (1);
-		DBG("Received message (session %s): %s", session->session_id, text);
+			doc = pctxt->myDoc;
+			pctxt->myDoc = NULL;
+			if (doc != NULL && (parse_error || !pctxt->wellFormed)) {
+				xmlFreeDoc(doc);
+				doc = NULL;
+			}
+		}
+		xmlFreeParserCtxt(pctxt);
+		pctxt = NULL;
 		break;
 	default:
 		ERROR("Unsupported NETCONF protocol version (%d)", session->version);
@@ -2210,35 +2948,41 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 		break;
 	}
 
-	DBG_UNLOCK("mut_channel");
-	pthread_mutex_unlock(session->mut_channel);
+	DBG_UNLOCK("mut_recv");
+	pthread_mutex_unlock(&(session->mut_recv));
 
-	if (text == NULL) {
+	if (text == NULL && total_len == 0) {
 		ERROR("Empty message received (session %s)", session->session_id);
 		goto malformed_msg;
 	}
 
-	retval = calloc (1, sizeof(struct nc_msg));
-	if (retval == NULL) {
-		ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
+	if (text != NULL) {
+		/* skip leading whitespaces */
+		tmp_text=text;
+		while (isspace(*tmp_text)) {
+			tmp_text++;
+		}
+		/* store the received message in libxml2 format */
+		doc = xmlReadDoc (BAD_CAST tmp_text, NULL, NULL, NC_XMLREAD_OPTIONS);
 		free (text);
+	}
+	if (doc == NULL) {
+		ERROR("Invalid XML data received.");
 		goto malformed_msg;
 	}
-
-	/* skip leading whitespaces */
-	tmp_text=text;
-	while (isspace(*tmp_text)) {
-		tmp_text++;
+	if (verbose_level >= NC_VERB_DEBUG && session->version == NETCONFV11) {
+		xmlDocDumpFormatMemory (doc, (xmlChar**) (&text), &dumplen, NC_CONTENT_FORMATTED);
+		DBG("Received message (session %s): %s", session->session_id, text);
+		free(text);
 	}
-	/* store the received message in libxml2 format */
-	retval->doc = xmlReadDoc (BAD_CAST tmp_text, NULL, NULL, NC_XMLREAD_OPTIONS);
-	if (retval->doc == NULL) {
-		free (retval);
-		free (text);
-		ERROR("Invalid XML data received.");
+
+	retval = calloc (1, sizeof(struct nc_msg));
+	if (retval == NULL) {
+		ERROR("Memory reallocation failed (%s:%d).", __FILE__, __LINE__);
+		xmlFreeDoc(doc);
 		goto malformed_msg;
 	}
-	free (text);
+	retval->doc = doc;
 
 	/* create xpath evaluation context */
 	if ((retval->ctxt = xmlXPathNewContext(retval->doc)) == NULL) {
@@ -2317,14 +3061,20 @@ static NC_MSG_TYPE nc_session_receive(struct nc_session* session, int timeout, s
 		retval->msgid = NULL;
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &(session->last_activity));
+
 	/* return the result */
 	*msg = retval;
 	(*msg)->session = session;
 	return (msgtype);
 
 malformed_msg_channels_unlock:
-	DBG_UNLOCK("mut_channel");
-	pthread_mutex_unlock(session->mut_channel);
+	DBG_UNLOCK("mut_recv");
+	pthread_mutex_unlock(&(session->mut_recv));
+	if (pctxt != NULL) {
+		xmlFreeDoc(pctxt->myDoc);
+		xmlFreeParserCtxt(pctxt);
+	}
 
 malformed_msg:
 	if (session->version == NETCONFV11 && session->ssh_sess == NULL) {
@@ -2370,12 +3120,246 @@ static NC_MSG_TYPE nc_session_recv_msg(struct nc_session* session, int timeout,
 	return (ret);
 }
 
+/*
+ * Pass the received reply to the pending request with the same message-id.
+ * Returns 0 if the reply was passed to the request's callback or stored for
+ * nc_session_wait_reply(), 1 if there is no request waiting for the reply.
+ */
+static int nc_session_reply_deliver(struct nc_session* session, nc_reply* reply)
+{
+	struct nc_pending_rpc **link, *pending;
+
+	if (reply->msgid == NULL) {
+		return (1);
+	}
+
+	DBG_LOCK("mut_mqueue");
+	pthread_mutex_lock(&(session->mut_mqueue));
+	if ((link = nc_pending_lookup(session, reply->msgid)) == NULL || (*link)->reply != NULL) {
+		DBG_UNLOCK("mut_mqueue");
+		pthread_mutex_unlock(&(session->mut_mqueue));
+		return (1);
+	}
+	pending = *link;
+	if (pending->callback == NULL) {
+		/* keep it for nc_session_wait_reply() */
+		pending->reply = reply;
+		DBG_UNLOCK("mut_mqueue");
+		pthread_mutex_unlock(&(session->mut_mqueue));
+		return (0);
+	}
+	*link = pending->next;
+	session->pending_count--;
+	DBG_UNLOCK("mut_mqueue");
+	pthread_mutex_unlock(&(session->mut_mqueue));
+
+	/* call the callback out of the lock, it can send another request */
+	pending->callback(session, pending->msgid, reply, pending->arg);
+	free(pending->msgid);
+	free(pending);
+
+	return (0);
+}
+
+/*
+ * If specified, use the callback for processing rpc-error. Returns 0 if the
+ * reply was processed (and freed), 1 otherwise.
+ */
+static int nc_reply_process_error(nc_reply* reply)
+{
+	struct nc_err* error;
+
+	if (nc_reply_get_type(reply) != NC_REPLY_ERROR || callbacks.process_error_reply == NULL) {
+		return (1);
+	}
+
+	/* process rpc-error msg */
+	for (error = reply->error; error != NULL; error = error->next) {
+		callbacks.process_error_reply(error->tag,
+				error->type,
+				error->severity,
+				error->apptag,
+				error->path,
+				error->message,
+				error->attribute,
+				error->element,
+				error->ns,
+				error->sid);
+	}
+	/* free the data */
+	nc_reply_free(reply);
+
+	return (0);
+}
+
+/*
+ * Change the capacity of the ring of received notifications, the oldest
+ * notifications not fitting into the new ring are dropped. The ring is
+ * allocated on the first use. Caller must hold mut_equeue.
+ */
+static int nc_ntf_ring_resize(struct nc_session* session, size_t size)
+{
+	struct nc_msg** ring;
+	size_t i;
+
+	if ((ring = calloc(size, sizeof(struct nc_msg*))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (EXIT_FAILURE);
+	}
+
+	if (session->ntf_ring == NULL) {
+		pthread_cond_init(&(session->ntf_ring_cond), NULL);
+	} else {
+		for (; session->ntf_ring_count > size; session->ntf_ring_count--) {
+			nc_msg_free(session->ntf_ring[session->ntf_ring_head]);
+			session->ntf_ring_head = (session->ntf_ring_head + 1) % session->ntf_ring_size;
+			session->ntf_dropped++;
+		}
+		for (i = 0; i < session->ntf_ring_count; i++) {
+			ring[i] = session->ntf_ring[(session->ntf_ring_head + i) % session->ntf_ring_size];
+		}
+		free(session->ntf_ring);
+		/* the ring can be bigger now */
+		pthread_cond_broadcast(&(session->ntf_ring_cond));
+	}
+
+	session->ntf_ring = ring;
+	session->ntf_ring_size = size;
+	session->ntf_ring_head = 0;
+
+	return (EXIT_SUCCESS);
+}
+
+/* add the notification into the session's queue of event notifications */
+static void nc_session_enqueue_event(struct nc_session* session, struct nc_msg* msg)
+{
+	struct nc_msg *dropped = NULL;
+
+	DBG_LOCK("mut_equeue");
+	pthread_mutex_lock(&(session->mut_equeue));
+
+	if (session->ntf_ring == NULL && nc_ntf_ring_resize(session, NC_NTF_QUEUE_SIZE) != EXIT_SUCCESS) {
+		DBG_UNLOCK("mut_equeue");
+		pthread_mutex_unlock(&(session->mut_equeue));
+		nc_msg_free(msg);
+		return;
+	}
+
+	if (session->ntf_overflow == NC_NTF_OVERFLOW_BLOCK) {
+		while (session->ntf_ring_count == session->ntf_ring_size && session->status == NC_SESSION_STATUS_WORKING) {
+			pthread_cond_wait(&(session->ntf_ring_cond), &(session->mut_equeue));
+		}
+	}
+
+	if (session->ntf_ring_count == session->ntf_ring_size) {
+		session->ntf_dropped++;
+		if (session->ntf_overflow == NC_NTF_OVERFLOW_DROP_OLDEST) {
+			dropped = session->ntf_ring[session->ntf_ring_head];
+			session->ntf_ring_head = (session->ntf_ring_head + 1) % session->ntf_ring_size;
+			session->ntf_ring_count--;
+		} else {
+			/* NC_NTF_OVERFLOW_DROP_NEWEST or the session is being closed */
+			dropped = msg;
+			msg = NULL;
+		}
+	}
+
+	if (msg != NULL) {
+		msg->next = NULL;
+		session->ntf_ring[(session->ntf_ring_head + session->ntf_ring_count) % session->ntf_ring_size] = msg;
+		session->ntf_ring_count++;
+	}
+
+	DBG_UNLOCK("mut_equeue");
+	pthread_mutex_unlock(&(session->mut_equeue));
+
+	nc_msg_free(dropped);
+}
+
+/* take the oldest notification from the session's queue of event notifications */
+static struct nc_msg* nc_session_dequeue_event(struct nc_session* session)
+{
+	struct nc_msg *msg = NULL;
+
+	DBG_LOCK("mut_equeue");
+	pthread_mutex_lock(&(session->mut_equeue));
+	if (session->ntf_ring_count > 0) {
+		msg = session->ntf_ring[session->ntf_ring_head];
+		session->ntf_ring[session->ntf_ring_head] = NULL;
+		session->ntf_ring_head = (session->ntf_ring_head + 1) % session->ntf_ring_size;
+		session->ntf_ring_count--;
+		if (session->ntf_overflow == NC_NTF_OVERFLOW_BLOCK) {
+			pthread_cond_signal(&(session->ntf_ring_cond));
+		}
+	}
+	DBG_UNLOCK("mut_equeue");
+	pthread_mutex_unlock(&(session->mut_equeue));
+
+	return (msg);
+}
+
+API int nc_session_set_notif_queue(struct nc_session* session, size_t size, NC_NTF_OVERFLOW overflow)
+{
+	int ret = EXIT_SUCCESS;
+
+	if (session == NULL || size == 0 ||
+			(overflow != NC_NTF_OVERFLOW_DROP_OLDEST && overflow != NC_NTF_OVERFLOW_DROP_NEWEST && overflow != NC_NTF_OVERFLOW_BLOCK)) {
+		ERROR("%s: Invalid parameters.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	DBG_LOCK("mut_equeue");
+	pthread_mutex_lock(&(session->mut_equeue));
+	if (session->ntf_ring == NULL || session->ntf_ring_size != size) {
+		ret = nc_ntf_ring_resize(session, size);
+	}
+	if (ret == EXIT_SUCCESS) {
+		if (session->ntf_overflow == NC_NTF_OVERFLOW_BLOCK && overflow != NC_NTF_OVERFLOW_BLOCK) {
+			/* do not leave anyone waiting for the space in the queue */
+			pthread_cond_broadcast(&(session->ntf_ring_cond));
+		}
+		session->ntf_overflow = overflow;
+	}
+	DBG_UNLOCK("mut_equeue");
+	pthread_mutex_unlock(&(session->mut_equeue));
+
+	return (ret);
+}
+
+API void nc_session_get_notif_stats(const struct nc_session* session, unsigned int *queued, unsigned long long *dropped)
+{
+	if (queued != NULL) {
+		*queued = (session == NULL) ? 0 : session->ntf_ring_count;
+	}
+	if (dropped != NULL) {
+		*dropped = (session == NULL) ? 0 : session->ntf_dropped;
+	}
+}
+
+/* add the message at the end of the session's queue of replies */
+static void nc_session_enqueue_reply(struct nc_session* session, struct nc_msg* msg)
+{
+	struct nc_msg *msg_aux;
+
+	DBG_LOCK("mut_mqueue");
+	pthread_mutex_lock(&(session->mut_mqueue));
+	msg_aux = session->queue_msg;
+	if (msg_aux == NULL) {
+		msg->next = session->queue_msg;
+		session->queue_msg = msg;
+	} else {
+		for (; msg_aux->next != NULL; msg_aux = msg_aux->next);
+		msg_aux->next = msg;
+	}
+	DBG_UNLOCK("mut_mqueue");
+	pthread_mutex_unlock(&(session->mut_mqueue));
+}
+
 #define LOCAL_RECEIVE_TIMEOUT 100
 API NC_MSG_TYPE nc_session_recv_reply(struct nc_session* session, int timeout, nc_reply** reply)
 {
-	struct nc_msg *msg_aux, *msg = NULL;
+	struct nc_msg *msg = NULL;
 	NC_MSG_TYPE ret;
-	struct nc_err* error;
 
 	/* use local timeout to avoid continual long time blocking */
 	int local_timeout;
@@ -2400,31 +3384,19 @@ try_again:
 		return (NC_MSG_REPLY);
 	}
 
-	ret = nc_session_recv_msg(session, local_timeout, &msg);
-
+	/* do not block the senders of asynchronous requests while receiving */
 	DBG_UNLOCK("mut_mqueue");
 	pthread_mutex_unlock(&(session->mut_mqueue));
 
+	ret = nc_session_recv_msg(session, local_timeout, &msg);
+
 	switch (ret) {
 	case NC_MSG_REPLY: /* regular reply received */
-		/* if specified callback for processing rpc-error, use it */
-		if (nc_reply_get_type (msg) == NC_REPLY_ERROR &&
-				callbacks.process_error_reply != NULL) {
-			/* process rpc-error msg */
-			for (error = msg->error; error != NULL; error = error->next) {
-				callbacks.process_error_reply(error->tag,
-						error->type,
-						error->severity,
-						error->apptag,
-						error->path,
-						error->message,
-						error->attribute,
-						error->element,
-						error->ns,
-						error->sid);
-			}
-			/* free the data */
-			nc_reply_free(msg);
+		if (nc_session_reply_deliver(session, msg) == 0) {
+			/* reply to a request sent by nc_session_send_rpc_async() */
+			ret = NC_MSG_NONE;
+		} else if (nc_reply_process_error(msg) == 0) {
+			/* processed by the callback for rpc-error */
 			ret = NC_MSG_NONE;
 		} else {
 			*reply = (nc_reply*)msg;
@@ -2446,19 +3418,7 @@ try_again:
 		break;
 	case NC_MSG_NOTIFICATION:
 		/* add event notification into the session's list of notification messages */
-		DBG_LOCK("mut_equeue");
-		pthread_mutex_lock(&(session->mut_equeue));
-		msg_aux = session->queue_event;
-		if (msg_aux == NULL) {
-			msg->next = session->queue_event;
-			session->queue_event = msg;
-		} else {
-			for (; msg_aux->next != NULL; msg_aux = msg_aux->next);
-			msg_aux->next = msg;
-		}
-		DBG_UNLOCK("mut_equeue");
-		pthread_mutex_unlock(&(session->mut_equeue));
-
+		nc_session_enqueue_event(session, msg);
 		break;
 	default:
 		nc_msg_free(msg);
@@ -2509,7 +3469,7 @@ API int nc_session_send_notif(struct nc_session* session, const nc_ntf* ntf)
 
 API NC_MSG_TYPE nc_session_recv_notif(struct nc_session* session, int timeout, nc_ntf** ntf)
 {
-	struct nc_msg *msg_aux, *msg=NULL;
+	struct nc_msg *msg=NULL;
 	NC_MSG_TYPE ret;
 
 	/* use local timeout to avoid continual long time blocking */
@@ -2521,17 +3481,10 @@ API NC_MSG_TYPE nc_session_recv_notif(struct nc_session* session, int timeout, n
 		local_timeout = LOCAL_RECEIVE_TIMEOUT;
 	}
 
-	DBG_LOCK("mut_equeue");
-	pthread_mutex_lock(&(session->mut_equeue));
-
 try_again:
-	if (session->queue_event != NULL) {
-		/* pop the oldest reply from the queue */
-		*ntf = (nc_reply*)(session->queue_event);
-		session->queue_event = (*ntf)->next;
-		DBG_UNLOCK("mut_equeue");
-		pthread_mutex_unlock(&(session->mut_equeue));
-		(*ntf)->next = NULL;
+	if ((msg = nc_session_dequeue_event(session)) != NULL) {
+		/* pop the oldest notification from the queue */
+		*ntf = (nc_ntf*)msg;
 		return (NC_MSG_NOTIFICATION);
 	}
 
@@ -2539,15 +3492,12 @@ try_again:
 
 	switch (ret) {
 	case NC_MSG_REPLY: /* regular reply received */
-		/* add reply into the session's list of reply messages */
-		msg_aux = session->queue_msg;
-		if (msg_aux == NULL) {
-			msg->next = session->queue_msg;
-			session->queue_msg = msg;
-		} else {
-			for (; msg_aux->next != NULL; msg_aux = msg_aux->next);
-			msg_aux->next = msg;
+		if (nc_session_reply_deliver(session, msg) == 0) {
+			/* reply to a request sent by nc_session_send_rpc_async() */
+			goto try_again;
 		}
+		/* add reply into the session's list of reply messages */
+		nc_session_enqueue_reply(session, msg);
 		break;
 	case NC_MSG_NONE:
 		/* <rpc-reply> with error information was processed
@@ -2568,9 +3518,6 @@ try_again:
 		break;
 	}
 
-	DBG_UNLOCK("mut_equeue");
-	pthread_mutex_unlock(&(session->mut_equeue));
-
 	return (ret);
 }
 
@@ -2749,10 +3696,15 @@ replyerror:
 	return (NC_MSG_NONE); /* message processed internally */
 }
 
-API const nc_msgid nc_session_send_rpc(struct nc_session* session, nc_rpc *rpc)
+/*
+ * Send the rpc, if pending is not NULL, the request is registered among the
+ * requests waiting for their replies before it is sent.
+ */
+static const nc_msgid nc_session_send_rpc_pending(struct nc_session* session, nc_rpc *rpc, struct nc_pending_rpc* pending)
 {
 	int ret;
 	char msg_id_str[16];
+	struct nc_pending_rpc **link;
 	const char* wd;
 	struct nc_msg *msg;
 	NC_OP op;
@@ -2846,6 +3798,25 @@ API const nc_msgid nc_session_send_rpc(struct nc_session* session, nc_rpc *rpc)
 			nc_msg_free (msg);
 			return (NULL);
 		}
+		if (pending != NULL) {
+			/* register the request before sending it, the reply can come at any time */
+			if ((pending->msgid = strdup(msg_id_str)) == NULL) {
+				ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+				nc_msg_free (msg);
+				return (NULL);
+			}
+			DBG_LOCK("mut_mqueue");
+			pthread_mutex_lock(&(session->mut_mqueue));
+			ret = nc_pending_insert(session, pending);
+			DBG_UNLOCK("mut_mqueue");
+			pthread_mutex_unlock(&(session->mut_mqueue));
+			if (ret != EXIT_SUCCESS) {
+				free(pending->msgid);
+				pending->msgid = NULL;
+				nc_msg_free (msg);
+				return (NULL);
+			}
+		}
 	} else {
 		/* hello message */
 		sprintf (msg_id_str, "hello");
@@ -2864,13 +3835,57 @@ API const nc_msgid nc_session_send_rpc(struct nc_session* session, nc_rpc *rpc)
 			DBG_UNLOCK("mut_session");
 			pthread_mutex_unlock(&(session->mut_session));
 		}
+		if (pending != NULL && pending->msgid != NULL) {
+			/* the request was not sent, unregister it */
+			DBG_LOCK("mut_mqueue");
+			pthread_mutex_lock(&(session->mut_mqueue));
+			if ((link = nc_pending_lookup(session, pending->msgid)) != NULL) {
+				*link = pending->next;
+				session->pending_count--;
+			}
+			DBG_UNLOCK("mut_mqueue");
+			pthread_mutex_unlock(&(session->mut_mqueue));
+			free(pending->msgid);
+			pending->msgid = NULL;
+		}
 		return (NULL);
 	} else {
+		free(rpc->msgid);
 		rpc->msgid = strdup(msg_id_str);
 		return (rpc->msgid);
 	}
 }
 
+API const nc_msgid nc_session_send_rpc(struct nc_session* session, nc_rpc *rpc)
+{
+	return (nc_session_send_rpc_pending(session, rpc, NULL));
+}
+
+API const nc_msgid nc_session_send_rpc_async(struct nc_session* session, nc_rpc *rpc, nc_reply_clb callback, void *arg)
+{
+	struct nc_pending_rpc* pending;
+	const nc_msgid retval;
+
+	if (rpc == NULL || rpc->type.rpc == NC_RPC_HELLO) {
+		ERROR("%s: Invalid parameters.", __func__);
+		return (NULL);
+	}
+
+	if ((pending = calloc(1, sizeof(struct nc_pending_rpc))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (NULL);
+	}
+	pending->callback = callback;
+	pending->arg = arg;
+
+	if ((retval = nc_session_send_rpc_pending(session, rpc, pending)) == NULL) {
+		free(pending);
+	}
+	/* otherwise the request is owned by the session's table of pending requests */
+
+	return (retval);
+}
+
 API const nc_msgid nc_session_send_reply(struct nc_session* session, const nc_rpc* rpc, const nc_reply *reply)
 {
 	int ret;
@@ -2974,103 +3989,123 @@ API int nc_msgid_compare(const nc_msgid id1, const nc_msgid id2)
 	}
 }
 
-API NC_MSG_TYPE nc_session_send_recv(struct nc_session* session, nc_rpc *rpc, nc_reply** reply)
+API NC_MSG_TYPE nc_session_wait_reply(struct nc_session* session, const nc_msgid msgid, int timeout, nc_reply** reply)
 {
-	const nc_msgid msgid;
-	NC_MSG_TYPE replytype;
-	struct nc_msg* queue = NULL, *msg, *p = NULL;
+	struct nc_pending_rpc **link, *pending;
+	struct nc_msg *msg = NULL;
+	NC_MSG_TYPE ret;
 
-	msgid = nc_session_send_rpc(session, rpc);
-	if (msgid == NULL) {
+	/* use local timeout to avoid continual long time blocking */
+	int local_timeout;
+
+	if (session == NULL || msgid == NULL || reply == NULL) {
+		ERROR("%s: Invalid parameters.", __func__);
 		return (NC_MSG_UNKNOWN);
 	}
 
+	if (timeout == 0) {
+		local_timeout = 0;
+	} else {
+		local_timeout = LOCAL_RECEIVE_TIMEOUT;
+	}
+
 	DBG_LOCK("mut_mqueue");
 	pthread_mutex_lock(&(session->mut_mqueue));
 
-	/* first, look into the session's list of previously received messages */
-	if ((queue = session->queue_msg) != NULL) {
-		/* search in the queue for the reply with required message ID */
-		for (msg = queue; msg != NULL; msg = msg->next) {
-			/* test message IDs */
-			if (nc_msgid_compare(msgid, nc_reply_get_msgid((nc_reply*) msg)) == 0) {
-				break;
-			}
-
-			/* store the predecessor */
-			p = msg;
+	while (1) {
+		if ((link = nc_pending_lookup(session, msgid)) == NULL || (*link)->callback != NULL) {
+			DBG_UNLOCK("mut_mqueue");
+			pthread_mutex_unlock(&(session->mut_mqueue));
+			ERROR("No request with message-id %s is waiting for its reply.", msgid);
+			return (NC_MSG_UNKNOWN);
 		}
+		pending = *link;
+		if (pending->reply != NULL) {
+			/* the reply is here, possibly received by someone else */
+			*link = pending->next;
+			session->pending_count--;
+			DBG_UNLOCK("mut_mqueue");
+			pthread_mutex_unlock(&(session->mut_mqueue));
 
-		if (msg != NULL) {
-			/* we have found the reply in the queue */
-			(*reply) = (nc_reply*) msg;
+			msg = pending->reply;
+			free(pending->msgid);
+			free(pending);
 
-			/* detach the reply from session's queue */
-			if (p == NULL) {
-				/* no predecessor - we detach the first item in the queue */
-				session->queue_msg = msg->next;
-			} else {
-				p->next = msg->next;
+			if (nc_reply_process_error(msg) == 0) {
+				return (NC_MSG_NONE);
 			}
-			msg->next = NULL;
-			DBG_UNLOCK("mut_mqueue");
-			pthread_mutex_unlock(&(session->mut_mqueue));
+			*reply = msg;
 			return (NC_MSG_REPLY);
-		} else {
-			/*
-			 * the queue does not contain required reply, we have to
-			 * read it from the input, but first we have to hide
-			 * session's queue from nc_session_recv_reply()
-			 */
-			session->queue_msg = NULL;
 		}
-	}
-	DBG_UNLOCK("mut_mqueue");
-	pthread_mutex_unlock(&(session->mut_mqueue));
 
-	while (1) {
-		replytype = nc_session_recv_reply(session, -1, reply);
-		if (replytype == NC_MSG_REPLY) {
-			/* compare message ID */
-			if (nc_msgid_compare(msgid, nc_reply_get_msgid(*reply)) != 0) {
-				/* reply with different message ID is expected */
-				DBG_LOCK("mut_mqueue");
-				pthread_mutex_lock(&(session->mut_mqueue));
+		/* do not block the senders and the other waiters while receiving */
+		DBG_UNLOCK("mut_mqueue");
+		pthread_mutex_unlock(&(session->mut_mqueue));
+
+		ret = nc_session_recv_msg(session, local_timeout, &msg);
+
+		switch (ret) {
+		case NC_MSG_REPLY:
+			if (nc_session_reply_deliver(session, msg) != 0) {
 				/* store this reply for the later use of someone else */
-				if (queue == NULL) {
-					queue = (struct nc_msg*) (*reply);
-				} else {
-					for (msg = queue; msg->next != NULL; msg = msg->next);
-					msg->next = (struct nc_msg*) (*reply);
-				}
-				/*The message is now owned by the queue, do not return it to the caller*/
-				*reply = NULL;
-				DBG_UNLOCK("mut_mqueue");
-				pthread_mutex_unlock(&(session->mut_mqueue));
-			} else {
-				/* we have it! */
+				nc_session_enqueue_reply(session, msg);
+			}
+			break;
+		case NC_MSG_NOTIFICATION:
+			nc_session_enqueue_event(session, msg);
+			break;
+		case NC_MSG_WOULDBLOCK:
+			if ((timeout == -1) || ((timeout > 0) && ((timeout = timeout - local_timeout) > 0))) {
 				break;
 			}
-		} else if (replytype == NC_MSG_UNKNOWN || replytype == NC_MSG_NONE) {
-			/* some error occured */
+			return (NC_MSG_WOULDBLOCK);
+		case NC_MSG_UNKNOWN:
+			nc_msg_free(msg);
+			return (NC_MSG_UNKNOWN);
+		default:
+			/* unexpected message, e.g. <hello>, drop it */
+			nc_msg_free(msg);
 			break;
 		}
-		/*
-		 * else (e.g. Notification or an unexpected reply was received)
-		 * read another message in the loop
-		 */
-	}
+		msg = NULL;
 
-	if (queue != NULL) {
 		DBG_LOCK("mut_mqueue");
 		pthread_mutex_lock(&(session->mut_mqueue));
-		/* reconnect hidden queue back to the session */
-		session->queue_msg = queue;
-		DBG_UNLOCK("mut_mqueue");
-		pthread_mutex_unlock(&(session->mut_mqueue));
+	}
+}
+
+API unsigned int nc_session_pending_count(struct nc_session* session)
+{
+	unsigned int count;
+
+	if (session == NULL) {
+		return (0);
+	}
+
+	DBG_LOCK("mut_mqueue");
+	pthread_mutex_lock(&(session->mut_mqueue));
+	count = session->pending_count;
+	DBG_UNLOCK("mut_mqueue");
+	pthread_mutex_unlock(&(session->mut_mqueue));
+
+	return (count);
+}
+
+API NC_MSG_TYPE nc_session_send_recv(struct nc_session* session, nc_rpc *rpc, nc_reply** reply)
+{
+	const nc_msgid msgid;
+
+	/*
+	 * the request waits among the asynchronous ones, so the replies to the
+	 * requests of other threads are matched in the hash table instead of
+	 * scanning the session's queue of replies
+	 */
+	msgid = nc_session_send_rpc_async(session, rpc, NULL, NULL);
+	if (msgid == NULL) {
+		return (NC_MSG_UNKNOWN);
 	}
 
-	return (replytype);
+	return (nc_session_wait_reply(session, msgid, -1, reply));
 }
 
 const char* nc_session_term_string(NC_SESSION_TERM_REASON reason)
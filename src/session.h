@@ -119,6 +119,108 @@ int nc_session_get_version(const struct nc_session* session);
  */
 int nc_session_get_eventfd(const struct nc_session* session);
 
+/**
+ * @ingroup session
+ * @brief Check if some data were already read from the session's communication
+ * channel, but they were not yet processed.
+ *
+ * libnetconf reads data from the transport layer in blocks, so a single read
+ * can get more than one NETCONF message. The rest of the data is kept inside
+ * the session and the file descriptor provided by nc_session_get_eventfd() does
+ * not signal them. Applications watching the file descriptor should call this
+ * function after receiving a message and, if it returns true, receive again
+ * without waiting for an event on the file descriptor.
+ *
+ * @param[in] session NETCONF session structure
+ * @return 1 if a received data are waiting for processing, 0 otherwise.
+ */
+int nc_session_has_pending_data(const struct nc_session* session);
+
+/**
+ * @ingroup session
+ * @brief Get the time elapsed since the last NETCONF message was received or
+ * sent on the session.
+ *
+ * @param[in] session NETCONF session structure
+ * @return Idle time of the session in milliseconds.
+ */
+unsigned long long nc_session_get_idle_time(const struct nc_session* session);
+
+/**
+ * @ingroup session
+ * @brief Get the total time the session spent blocked waiting for input data.
+ *
+ * The time includes waiting for the start of a message in the nc_session_recv_*()
+ * functions as well as waiting for the rest of a partially received message.
+ * Compared with the session's lifetime, it says how much of the time the thread
+ * serving the session was idle.
+ *
+ * @param[in] session NETCONF session structure
+ * @return Waiting time of the session in milliseconds.
+ */
+unsigned long long nc_session_get_wait_time(const struct nc_session* session);
+
+/**
+ * @ingroup session
+ * @brief Set the maximal size of the chunks used to send NETCONF 1.1 messages.
+ *
+ * A message is serialized into a buffer of the specified size and the buffer
+ * is sent as a chunk whenever it gets full, so the peer does not need to buffer
+ * the whole message. The size also limits the amount of data sent at once in
+ * NETCONF 1.0 sessions. The default value is 64 KiB. The change is applied
+ * from the next sent message.
+ *
+ * The buffer is never bigger than 1 MiB. Bigger chunks are sent through the
+ * buffer in more parts, but the message has to be serialized twice to get its
+ * size for the chunk headers.
+ *
+ * @param[in] session NETCONF session structure
+ * @param[in] size Maximal chunk size in bytes, from 1 to 4294967295 (RFC 6242).
+ * @return EXIT_SUCCESS or EXIT_FAILURE on invalid parameters.
+ */
+int nc_session_set_chunk_size(struct nc_session* session, size_t size);
+
+/**
+ * @ingroup session
+ * @brief Get the statistics of the data sent on the session.
+ *
+ * @param[in] session NETCONF session structure
+ * @param[out] chunks Number of the NETCONF 1.1 chunks sent, can be NULL.
+ * @param[out] bytes Number of bytes sent including the messages framing, can be NULL.
+ */
+void nc_session_get_send_stats(const struct nc_session* session, unsigned long long *chunks, unsigned long long *bytes);
+
+/**
+ * @ingroup notifications
+ * @brief Set the queue of the notifications received by a NETCONF client
+ * while waiting for an \<rpc-reply\>.
+ *
+ * Such notifications are queued until they are taken by nc_session_recv_notif().
+ * The default queue holds 1024 notifications and drops the oldest
+ * one when a new notification comes into the full queue. The
+ * #NC_NTF_OVERFLOW_BLOCK policy is usable only if notifications are received
+ * by another thread than the replies, otherwise the receiving thread blocks
+ * until the session is closed.
+ *
+ * @param[in] session NETCONF session structure
+ * @param[in] size Maximal number of queued notifications, the oldest ones
+ * exceeding the new size are dropped.
+ * @param[in] overflow Policy applied when a notification comes into the full queue.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int nc_session_set_notif_queue(struct nc_session* session, size_t size, NC_NTF_OVERFLOW overflow);
+
+/**
+ * @ingroup notifications
+ * @brief Get the statistics of the session's queue of received notifications.
+ *
+ * @param[in] session NETCONF session structure
+ * @param[out] queued Number of the notifications waiting in the queue, can be NULL.
+ * @param[out] dropped Number of the notifications dropped because of the full
+ * queue, can be NULL.
+ */
+void nc_session_get_notif_stats(const struct nc_session* session, unsigned int *queued, unsigned long long *dropped);
+
 /**
  * @ingroup session
  * @brief Get NETCONF session ID
@@ -359,7 +461,9 @@ NC_MSG_TYPE nc_session_recv_rpc(struct nc_session* session, int timeout, nc_rpc*
  * - #NC_MSG_HELLO - success, *reply points to the received \<hello\> message.
  * - #NC_MSG_NONE - success, but \<rpc-reply\> with error information was
  *   processed automatically using callback specified with nc_callback_error_reply()
- *   function. *reply was not changed.
+ *   function, or the \<rpc-reply\> to a request sent by nc_session_send_rpc_async()
+ *   was passed to its callback or stored for nc_session_wait_reply(). *reply
+ *   was not changed.
  * - #NC_MSG_UNKNOWN - error occurred
  * - #NC_MSG_NOTIFICATION - \<notification\> message was received and enqueued
  *   to the internal queue until the nc_session_recv_notif() function is called.
@@ -414,6 +518,63 @@ int nc_msgid_compare(const nc_msgid id1, const nc_msgid id2);
  */
 NC_MSG_TYPE nc_session_send_recv(struct nc_session* session, nc_rpc *rpc, nc_reply** reply);
 
+/**
+ * @ingroup rpc
+ * @brief Send \<rpc\> without waiting for its \<rpc-reply\>.
+ * This function is supposed to be performed only by NETCONF clients.
+ *
+ * Any number of requests can be sent on the session before their replies
+ * arrive. The replies are matched to the requests by their message-id. If
+ * the callback is specified, the reply is passed to it by the function
+ * receiving it from the session (nc_session_recv_reply(),
+ * nc_session_recv_notif(), nc_session_wait_reply() or nc_session_send_recv()).
+ * Otherwise, the reply is kept until it is picked up by nc_session_wait_reply().
+ *
+ * This function IS thread safe.
+ *
+ * @param[in] session NETCONF session to use.
+ * @param[in] rpc \<rpc\> message to send.
+ * @param[in] callback Callback processing the reply, NULL to pick up the reply
+ * by nc_session_wait_reply().
+ * @param[in] arg User argument passed to the callback.
+ * @return NULL on error,\n message-id of sent message on success.
+ */
+const nc_msgid nc_session_send_rpc_async(struct nc_session* session, nc_rpc *rpc, nc_reply_clb callback, void *arg);
+
+/**
+ * @ingroup reply
+ * @brief Receive \<rpc-reply\> to the request sent by nc_session_send_rpc_async()
+ * without a callback.
+ * This function is supposed to be performed only by NETCONF clients.
+ *
+ * Other messages received while waiting are processed the same way as by
+ * nc_session_recv_reply().
+ *
+ * @param[in] session NETCONF session to use.
+ * @param[in] msgid Message-id of the request.
+ * @param[in] timeout Timeout in milliseconds, -1 for infinite timeout, 0 for
+ * non-blocking
+ * @param[out] reply Received \<rpc-reply\>
+ * @return
+ * - #NC_MSG_REPLY - success, *reply points to the received \<rpc-reply\> message.
+ * - #NC_MSG_NONE - success, but \<rpc-reply\> with error information was
+ *   processed automatically using callback specified with nc_callback_error_reply()
+ *   function. *reply was not changed.
+ * - #NC_MSG_UNKNOWN - error occurred, or no such request is waiting for its reply
+ * - #NC_MSG_WOULDBLOCK - receiving timeouted, the reply can be received later.
+ */
+NC_MSG_TYPE nc_session_wait_reply(struct nc_session* session, const nc_msgid msgid, int timeout, nc_reply** reply);
+
+/**
+ * @ingroup rpc
+ * @brief Get the number of requests sent by nc_session_send_rpc_async() and
+ * not yet processed.
+ *
+ * @param[in] session NETCONF session to check.
+ * @return Number of the pending requests.
+ */
+unsigned int nc_session_pending_count(struct nc_session* session);
+
 #ifdef __cplusplus
 }
 #endif
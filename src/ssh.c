@@ -197,6 +197,8 @@ struct nc_session *nc_session_connect_libssh_socket(const char* username, const
 	retval->mut_channel = (pthread_mutex_t *) malloc(sizeof(pthread_mutex_t));
 	if ((r = pthread_mutex_init(retval->mut_channel, &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_mqueue), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_recv), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_send), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_equeue), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_ntf), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_session), &mattr)) != 0) {
@@ -522,6 +524,8 @@ struct nc_session *nc_session_connect_libssh_channel(struct nc_session *session)
 	}
 	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
 	if ((r = pthread_mutex_init(&(retval->mut_mqueue), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_recv), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_send), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_equeue), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_ntf), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_session), &mattr)) != 0) {
@@ -568,6 +572,8 @@ shutdown:
 	if (retval) {
 		free(retval->stats);
 		pthread_mutex_destroy(&(retval->mut_mqueue));
+		pthread_mutex_destroy(&(retval->mut_recv));
+		pthread_mutex_destroy(&(retval->mut_send));
 		pthread_mutex_destroy(&(retval->mut_equeue));
 		pthread_mutex_destroy(&(retval->mut_ntf));
 		pthread_mutex_destroy(&(retval->mut_session));
@@ -775,6 +781,8 @@ struct nc_session *nc_session_connect_ssh(const char* username, const char* host
 	if (((retval->mut_channel = calloc(1, sizeof(pthread_mutex_t))) == NULL) ||
 			(r = pthread_mutex_init(retval->mut_channel, &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_mqueue), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_recv), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_send), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_equeue), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_ntf), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_session), &mattr)) != 0) {
@@ -1009,6 +1017,8 @@ error_cleanup:
 			free(retval->mut_channel);
 		}
 		pthread_mutex_destroy(&(retval->mut_mqueue));
+		pthread_mutex_destroy(&(retval->mut_recv));
+		pthread_mutex_destroy(&(retval->mut_send));
 		pthread_mutex_destroy(&(retval->mut_equeue));
 		pthread_mutex_destroy(&(retval->mut_ntf));
 		pthread_mutex_destroy(&(retval->mut_session));
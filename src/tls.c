@@ -366,7 +366,6 @@ struct nc_session *nc_session_connect_tls_socket(const char* username, const cha
 	retval->username = strdup(username);
 	retval->groups = NULL; /* client side does not need this information */
 	retval->msgid = 1;
-	retval->queue_event = NULL;
 	retval->queue_msg = NULL;
 	retval->logintime = NULL;
 	retval->monitored = 0;
@@ -385,6 +384,8 @@ struct nc_session *nc_session_connect_tls_socket(const char* username, const cha
 	retval->mut_channel = (pthread_mutex_t *) malloc(sizeof(pthread_mutex_t));
 	if ((r = pthread_mutex_init(retval->mut_channel, &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_mqueue), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_recv), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_send), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_equeue), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_ntf), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_session), &mattr)) != 0) {
@@ -605,6 +605,8 @@ API struct nc_session* nc_session_connect_inout(int fd_in, int fd_out, const str
 	if (((retval->mut_channel = calloc(1, sizeof(pthread_mutex_t))) == NULL) ||
 			(r = pthread_mutex_init(retval->mut_channel, &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_mqueue), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_recv), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_send), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_equeue), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_ntf), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_session), &mattr)) != 0) {
@@ -648,6 +650,8 @@ error_cleanup:
 			free(retval->mut_channel);
 		}
 		pthread_mutex_destroy(&(retval->mut_mqueue));
+		pthread_mutex_destroy(&(retval->mut_recv));
+		pthread_mutex_destroy(&(retval->mut_send));
 		pthread_mutex_destroy(&(retval->mut_equeue));
 		pthread_mutex_destroy(&(retval->mut_ntf));
 		pthread_mutex_destroy(&(retval->mut_session));
@@ -865,7 +869,6 @@ struct nc_session* _nc_session_accept(const struct nc_cpblts* capabilities, cons
 	retval->ssh_chan = ssh_chan;
 #endif
 	retval->msgid = 1;
-	retval->queue_event = NULL;
 	retval->queue_msg = NULL;
 	retval->monitored = 0;
 	retval->stats->in_rpcs = 0;
@@ -881,6 +884,8 @@ struct nc_session* _nc_session_accept(const struct nc_cpblts* capabilities, cons
 	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
 	if ((r = pthread_mutex_init(retval->mut_channel, &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_mqueue), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_recv), &mattr)) != 0 ||
+			(r = pthread_mutex_init(&(retval->mut_send), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_equeue), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_ntf), &mattr)) != 0 ||
 			(r = pthread_mutex_init(&(retval->mut_session), &mattr)) != 0) {
@@ -489,6 +489,7 @@ static xmlNodePtr* fill_default(xmlDocPtr config, xmlNodePtr node, const char* n
 					value2 = xmlNodeGetContent(parents[i]);
 					if (xmlStrcmp(value, value2) == 0) {
 						/* element contains default value, remove it */
+						edit_index_remove(parents[i]);
 						xmlUnlinkNode(parents[i]);
 						xmlFreeNode(parents[i]);
 					}
@@ -0,0 +1,358 @@
+/**
+ * \file workers.c
+ * \author Radek Krejci <rkrejci@cesnet.cz>
+ * \brief Implementation of the worker pool applying NETCONF \<rpc\>s to
+ * datastores.
+ *
+ * Copyright (c) 2012-2014 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * ALTERNATIVELY, provided that this notice is retained in full, this
+ * product may be distributed under the terms of the GNU General Public
+ * License (GPL) version 2 or later, in which case the provisions
+ * of the GPL apply INSTEAD OF those given above.
+ *
+ * This software is provided ``as is, and any express or implied
+ * warranties, including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose are disclaimed.
+ * In no event shall the company or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "netconf_internal.h"
+#include "messages.h"
+#include "messages_internal.h"
+#include "error.h"
+#include "session.h"
+#include "datastore.h"
+#include "datastore/datastore_internal.h"
+
+/*
+ * number of the oldest queued jobs considered when searching for a job to run,
+ * it limits the complexity of the search if many jobs are waiting
+ */
+#define NCDS_WORKERS_LOOKAHEAD 64
+
+/* key of the write jobs which can modify any datastore */
+#define NCDS_WORKERS_ALL_DS (-1)
+
+/**
+ * @brief \<rpc\> waiting for a worker.
+ */
+struct ncds_job {
+	struct nc_session *session; /**< @brief session to reply to */
+	nc_rpc *rpc; /**< @brief request to apply */
+	int write; /**< @brief request modifies the datastore(s) */
+	ncds_id target; /**< @brief datastore modified by the write request, NCDS_WORKERS_ALL_DS if not known */
+	struct ncds_job *next; /**< @brief next job in the queue */
+};
+
+/**
+ * @brief Worker thread.
+ */
+struct ncds_worker {
+	struct ncds_workers *pool; /**< @brief pool the thread belongs to */
+	pthread_t thread; /**< @brief thread ID */
+	struct ncds_job *job; /**< @brief job being processed by the thread */
+};
+
+struct ncds_workers {
+	pthread_mutex_t lock; /**< @brief lock for all the following members */
+	pthread_cond_t cond; /**< @brief new job to run or the pool is stopping */
+	pthread_cond_t done; /**< @brief some job was finished */
+	struct ncds_job *queue; /**< @brief queued jobs */
+	struct ncds_job *queue_last; /**< @brief last item of the queue */
+	struct ncds_worker *workers; /**< @brief worker threads */
+	int count; /**< @brief number of threads */
+	int stop; /**< @brief the pool is being freed */
+};
+
+/**
+ * @brief Check if the jobs cannot be processed at the same time (or the later
+ * one cannot overtake the former one).
+ */
+static int job_conflict(const struct ncds_job* a, const struct ncds_job* b)
+{
+	if (a->session == b->session) {
+		/* requests of a session are processed in order */
+		return (1);
+	}
+	if (a->write && b->write && (a->target == NCDS_WORKERS_ALL_DS || b->target == NCDS_WORKERS_ALL_DS || a->target == b->target)) {
+		/* writes into the same datastore are processed in order */
+		return (1);
+	}
+	return (0);
+}
+
+/**
+ * @brief Remove the oldest job which can be processed right now from the
+ * queue. Caller is supposed to hold the workers lock.
+ */
+static struct ncds_job* workers_pick(struct ncds_workers* workers)
+{
+	struct ncds_job *job, *prev, *iter;
+	int i, n;
+
+	for (job = workers->queue, prev = NULL, n = 0; job != NULL && n < NCDS_WORKERS_LOOKAHEAD; prev = job, job = job->next, n++) {
+		for (i = 0; i < workers->count; i++) {
+			if (workers->workers[i].job != NULL && job_conflict(workers->workers[i].job, job)) {
+				break;
+			}
+		}
+		if (i < workers->count) {
+			continue;
+		}
+		for (iter = workers->queue; iter != job; iter = iter->next) {
+			if (job_conflict(iter, job)) {
+				break;
+			}
+		}
+		if (iter != job) {
+			continue;
+		}
+
+		/* dequeue the job */
+		if (prev == NULL) {
+			workers->queue = job->next;
+		} else {
+			prev->next = job->next;
+		}
+		if (workers->queue_last == job) {
+			workers->queue_last = prev;
+		}
+		job->next = NULL;
+		return (job);
+	}
+
+	return (NULL);
+}
+
+static void job_process(struct ncds_job* job)
+{
+	nc_reply *reply;
+	struct nc_err *e;
+
+	reply = ncds_apply_rpc2all(job->session, job->rpc, NULL);
+	if (reply == NCDS_RPC_NOT_APPLICABLE) {
+		e = nc_err_new(NC_ERR_OP_NOT_SUPPORTED);
+		reply = nc_reply_error(e);
+	} else if (reply == NULL) {
+		e = nc_err_new(NC_ERR_OP_FAILED);
+		nc_err_set(e, NC_ERR_PARAM_MSG, "Applying the request to the datastores failed.");
+		reply = nc_reply_error(e);
+	}
+
+	if (nc_session_send_reply(job->session, job->rpc, reply) == 0) {
+		ERROR("Failed to send reply (session %s).", nc_session_get_id(job->session));
+	}
+	nc_reply_free(reply);
+}
+
+static void* workers_thread(void* arg)
+{
+	struct ncds_worker *worker = (struct ncds_worker*) arg;
+	struct ncds_workers *workers = worker->pool;
+	struct ncds_job *job;
+
+	pthread_mutex_lock(&(workers->lock));
+	while (1) {
+		if ((job = workers_pick(workers)) == NULL) {
+			if (workers->stop && workers->queue == NULL) {
+				break;
+			}
+			pthread_cond_wait(&(workers->cond), &(workers->lock));
+			continue;
+		}
+		worker->job = job;
+		pthread_mutex_unlock(&(workers->lock));
+
+		job_process(job);
+
+		pthread_mutex_lock(&(workers->lock));
+		worker->job = NULL;
+		/* the finished job could block some other queued jobs */
+		pthread_cond_broadcast(&(workers->cond));
+		pthread_cond_broadcast(&(workers->done));
+
+		nc_rpc_free(job->rpc);
+		free(job);
+	}
+	pthread_mutex_unlock(&(workers->lock));
+
+	return (NULL);
+}
+
+API struct ncds_workers* ncds_workers_new(int count)
+{
+	struct ncds_workers *workers;
+	int i, r;
+
+	if (count <= 0) {
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+		if (count <= 0) {
+			count = 1;
+		}
+	}
+
+	if ((workers = calloc(1, sizeof(struct ncds_workers))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (NULL);
+	}
+	if ((workers->workers = calloc(count, sizeof(struct ncds_worker))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		free(workers);
+		return (NULL);
+	}
+	pthread_mutex_init(&(workers->lock), NULL);
+	pthread_cond_init(&(workers->cond), NULL);
+	pthread_cond_init(&(workers->done), NULL);
+
+	for (i = 0; i < count; i++) {
+		workers->workers[i].pool = workers;
+		if ((r = pthread_create(&(workers->workers[i].thread), NULL, workers_thread, &(workers->workers[i]))) != 0) {
+			ERROR("%s: creating a worker thread failed (%s).", __func__, strerror(r));
+			break;
+		}
+	}
+	workers->count = i;
+	if (workers->count == 0) {
+		ncds_workers_free(workers);
+		return (NULL);
+	}
+
+	return (workers);
+}
+
+API int ncds_workers_submit(struct ncds_workers* workers, struct nc_session* session, nc_rpc* rpc)
+{
+	struct ncds_job *job;
+	NC_RPC_TYPE type;
+
+	if (workers == NULL || session == NULL || rpc == NULL) {
+		ERROR("%s: invalid parameters.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	type = nc_rpc_get_type(rpc);
+	if (type != NC_RPC_DATASTORE_READ && type != NC_RPC_DATASTORE_WRITE) {
+		ERROR("%s: only datastore operations can be processed by the workers.", __func__);
+		return (EXIT_FAILURE);
+	}
+
+	if ((job = malloc(sizeof(struct ncds_job))) == NULL) {
+		ERROR("Memory allocation failed (%s:%d).", __FILE__, __LINE__);
+		return (EXIT_FAILURE);
+	}
+	job->session = session;
+	job->rpc = rpc;
+	job->write = (type == NC_RPC_DATASTORE_WRITE);
+	job->target = job->write ? ncds_rpc_write_target(rpc) : NCDS_WORKERS_ALL_DS;
+	job->next = NULL;
+
+	pthread_mutex_lock(&(workers->lock));
+	if (workers->queue_last == NULL) {
+		workers->queue = job;
+	} else {
+		workers->queue_last->next = job;
+	}
+	workers->queue_last = job;
+	pthread_cond_signal(&(workers->cond));
+	pthread_mutex_unlock(&(workers->lock));
+
+	return (EXIT_SUCCESS);
+}
+
+API void ncds_workers_cancel(struct ncds_workers* workers, const struct nc_session* session)
+{
+	struct ncds_job *job, *prev, *next;
+	int i;
+
+	if (workers == NULL || session == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&(workers->lock));
+
+	/* drop the queued jobs */
+	for (job = workers->queue, prev = NULL; job != NULL; job = next) {
+		next = job->next;
+		if (job->session != session) {
+			prev = job;
+			continue;
+		}
+		if (prev == NULL) {
+			workers->queue = next;
+		} else {
+			prev->next = next;
+		}
+		if (workers->queue_last == job) {
+			workers->queue_last = prev;
+		}
+		nc_rpc_free(job->rpc);
+		free(job);
+	}
+	/* the removed jobs could block some other queued jobs */
+	pthread_cond_broadcast(&(workers->cond));
+
+	/* wait for the running one */
+	do {
+		for (i = 0; i < workers->count; i++) {
+			if (workers->workers[i].job != NULL && workers->workers[i].job->session == session) {
+				pthread_cond_wait(&(workers->done), &(workers->lock));
+				break;
+			}
+		}
+	} while (i < workers->count);
+
+	pthread_mutex_unlock(&(workers->lock));
+}
+
+API void ncds_workers_free(struct ncds_workers* workers)
+{
+	int i;
+
+	if (workers == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&(workers->lock));
+	workers->stop = 1;
+	pthread_cond_broadcast(&(workers->cond));
+	pthread_mutex_unlock(&(workers->lock));
+
+	for (i = 0; i < workers->count; i++) {
+		pthread_join(workers->workers[i].thread, NULL);
+	}
+
+	pthread_cond_destroy(&(workers->done));
+	pthread_cond_destroy(&(workers->cond));
+	pthread_mutex_destroy(&(workers->lock));
+	free(workers->workers);
+	free(workers);
+}